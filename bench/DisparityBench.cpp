@@ -0,0 +1,1762 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        Disparity engine, ground filter and detector benchmark:
+                                latency percentiles, throughput, allocations and
+                                accuracy against synthetic ground truth as JSON
+*****************************************************************/
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+#include "Global.h"
+#include "Disparity.h"
+#include "GroundFilter.h"
+#include "ObjectDetector.h"
+#include "ObjectFilter.h"
+#include "SyntheticScene.h"
+#include "Tracker.h"
+#include "DetectionFactory.h"
+#include "Pipeline.h"
+
+using namespace std;
+using namespace cv;
+
+
+// Global visual setting and ticking variables (normally defined in main.h)
+bool VISUAL_ORIGINAL;
+bool VISUAL_RECTIFIED;
+bool VISUAL_DISPARITY;
+bool VISUAL_DISPARITY_NO_GROUND;
+bool VISUAL_DETECTION;
+bool VISUAL_LANE;
+bool VISUAL_MASKED_DISPARITY;
+bool VISUAL_U_V_DISPARITY;
+int start_raw, stop_raw;
+int start_rectify, stop_rectify;
+int start_disp, stop_disp;
+int start_ground_filter, stop_ground_filter;
+int start_detection, stop_detection;
+
+
+/*****************************************************************
+Structure Name: StereoFrame
+Description: one stereo pair of the corpus, gt is empty if unknown
+                         (CV_32F, disparity in pixels, <=0 for unknown), labels
+                         is empty for recorded frames
+*****************************************************************/
+
+struct StereoFrame{
+
+    string name;
+    Mat left;
+    Mat right;
+    Mat gt;
+
+    // synthetic frames only
+    Mat labels;                                     // 0 background, 1 ground, 2+ box
+    float ground_k;
+    float ground_b;
+    vector<Object_2D> objects;
+
+};
+
+
+// Forward motion of the camera between synthetic frames (m)
+static const float synthetic_step = 0.15;
+
+
+/*Funciton Name: SyntheticSequence(SyntheticScene& scene, int num)            */
+/*Description: drive forward through the scene, a new set of boxes is
+                         placed every 10 frames                                                                            */
+/*Input: SyntheticScene& scene - scene generator
+                int num - number of frames                                                                             */
+/*Output: vector<StereoFrame> frames                                                                    */
+
+static vector<StereoFrame> SyntheticSequence(SyntheticScene& scene, int num){
+
+    vector<StereoFrame> frames;
+    for(int i = 0; i < num; i++){
+        if(i%10 == 0) scene.RandomBoxes(2 + (i/10)%3, 1234 + i);
+        StereoFrame frame;
+        frame.name = "synthetic_" + to_string(i);
+        scene.Render(frame.left, frame.right);
+        frame.gt = scene.GroundTruth().clone();
+        frame.labels = scene.Labels().clone();
+        frame.ground_k = scene.GroundK();
+        frame.ground_b = scene.GroundB();
+        frame.objects = scene.Objects();
+        frames.push_back(frame);
+        scene.Step(synthetic_step);
+    }
+    return frames;
+
+}
+
+
+/*Funciton Name: IoU(Object_2D a, Object_2D b)                                                       */
+/*Description: intersection over union of two image boxes                            */
+/*Input: Object_2D a, Object_2D b - objects                                                          */
+/*Output: float iou                                                                                                                  */
+
+static float IoU(Object_2D a, Object_2D b){
+
+    float w = min(a.br.x, b.br.x) - max(a.tl.x, b.tl.x);
+    float h = min(a.br.y, b.br.y) - max(a.tl.y, b.tl.y);
+    if(w <= 0 || h <= 0) return 0;
+    float area_a = (a.br.x - a.tl.x)*(a.br.y - a.tl.y);
+    float area_b = (b.br.x - b.tl.x)*(b.br.y - b.tl.y);
+    return w*h/(area_a + area_b - w*h);
+
+}
+
+
+/*Funciton Name: LoadRecorded(string dir)                                                   */
+/*Description: load left_%04d.png / right_%04d.png (and optional
+                         disp_%04d.png, CV_8U pixels) until the first missing index     */
+/*Input: string dir - directory with extracted frames                                   */
+/*Output: vector<StereoFrame> frames                                                                    */
+
+static vector<StereoFrame> LoadRecorded(string dir){
+
+    vector<StereoFrame> frames;
+    for(int i = 0; ; i++){
+        char name[32];
+        snprintf(name, sizeof(name), "%04d.png", i);
+        StereoFrame frame;
+        frame.name = "recorded_" + string(name);
+        frame.left = imread(dir + "/left_" + name, IMREAD_GRAYSCALE);
+        frame.right = imread(dir + "/right_" + name, IMREAD_GRAYSCALE);
+        if(frame.left.empty() || frame.right.empty()) break;
+        Mat gt = imread(dir + "/disp_" + name, IMREAD_GRAYSCALE);
+        if(!gt.empty()) gt.convertTo(frame.gt, CV_32F);
+        frames.push_back(frame);
+    }
+    return frames;
+
+}
+
+
+/*****************************************************************
+Allocation counting: operator new and new[] of the bench binary are replaced
+by counting versions, every call is seen, also allocations released again
+within the measured scope; allocations of the libraries through their own
+allocators are not counted
+*****************************************************************/
+
+static atomic<long> allocations(0);
+
+
+void* operator new(size_t size){
+    allocations++;
+    void* ptr = malloc(size ? size : 1);
+    if(!ptr) throw bad_alloc();
+    return ptr;
+}
+
+
+void* operator new[](size_t size){
+    allocations++;
+    void* ptr = malloc(size ? size : 1);
+    if(!ptr) throw bad_alloc();
+    return ptr;
+}
+
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+
+
+
+/*****************************************************************
+Class Name: AllocationScope
+Description: calls of operator new and new[] since construction
+*****************************************************************/
+
+class AllocationScope{
+
+    private:
+
+        long start;
+
+    public:
+
+        AllocationScope(){ start = allocations; }
+
+
+        /*Funciton Name: Count()                                                                                     */
+        /*Description: allocations since construction                                            */
+        /*Input: void                                                                                                           */
+        /*Output: long count                                                                                                */
+
+        long Count(){ return allocations - start; }
+
+};
+
+
+
+/*Funciton Name: Ratio(double a, double b)                                                    */
+/*Description: a/b, 0 if b is not positive                                                    */
+/*Input: double a, double b - numerator and denominator                          */
+/*Output: double ratio                                                                                                */
+
+static double Ratio(double a, double b){
+
+    return b > 0 ? a/b : 0;
+
+}
+
+
+/*****************************************************************
+Class Name: LatencyStats
+Description: latency samples of one measured stage
+*****************************************************************/
+
+class LatencyStats{
+
+    private:
+
+        vector<double> samples;                 // [ms]
+
+    public:
+
+        /*Funciton Name: Add(double ms), AddSince(chrono::steady_clock::time_point start) */
+        /*Description: add a sample, given or measured from start to now                        */
+        /*Input: double ms - latency
+                        chrono::steady_clock::time_point start - start of the stage                   */
+        /*Output: void                                                                                                                                */
+
+        void Add(double ms){ samples.push_back(ms); }
+
+        void AddSince(chrono::steady_clock::time_point start){
+            Add(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+
+
+        /*Funciton Name: Reserve(size_t n)                                                                */
+        /*Description: reserve n samples, no allocation while measuring   */
+        /*Input: size_t n - number of samples                                                         */
+        /*Output: void                                                                                                           */
+
+        void Reserve(size_t n){ samples.reserve(n); }
+
+
+        /*Funciton Name: Count(), Mean(), Throughput()                                 */
+        /*Description: number of samples, mean latency, frames per second */
+        /*Input: void                                                                                                           */
+        /*Output: size_t count / double ms / double fps                                     */
+
+        size_t Count() const { return samples.size(); }
+
+        double Mean() const {
+            double sum = 0;
+            for(size_t i = 0; i < samples.size(); i++) sum += samples[i];
+            return Ratio(sum, samples.size());
+        }
+
+        double Throughput() const { return Ratio(1000.0, Mean()); }
+
+
+        /*Funciton Name: Percentile(double p)                                                      */
+        /*Description: nearest-rank percentile                                                         */
+        /*Input: double p - percentile in [0,100]                                                   */
+        /*Output: double ms, 0 without samples                                                    */
+
+        double Percentile(double p) const {
+            if(samples.empty()) return 0;
+            vector<double> sorted(samples);
+            sort(sorted.begin(), sorted.end());
+            size_t rank = (size_t)ceil(p/100.0*sorted.size());
+            return sorted[min(max(rank, (size_t)1), sorted.size()) - 1];
+        }
+
+};
+
+
+
+/*****************************************************************
+Class Name: JsonReport
+Description: JSON report of the benchmark: top-level fields and sections
+                         holding one object per measured row
+*****************************************************************/
+
+class JsonReport{
+
+    private:
+
+        stringstream json;
+        bool first_field;                                  // no field yet at the current level
+        bool first_row;                                     // no row yet in the current section
+        bool in_section;
+        bool in_row;
+
+
+        /*Funciton Name: Key(const string& key)                                                  */
+        /*Description: separator and key of the next field                                */
+        /*Input: const string& key - field name                                                     */
+        /*Output: void                                                                                                           */
+
+        void Key(const string& key){
+            if(in_row) json<<(first_field ? "" : ", ");
+            else json<<(first_field ? "" : ",")<<"\n  ";
+            json<<"\""<<key<<"\": ";
+            first_field = false;
+        }
+
+
+        /*Funciton Name: CloseRow(), CloseSection()                                          */
+        /*Description: close the open row / section                                              */
+        /*Input: void                                                                                                           */
+        /*Output: void                                                                                                           */
+
+        void CloseRow(){
+            if(in_row) json<<"}";
+            in_row = false;
+        }
+
+        void CloseSection(){
+            CloseRow();
+            if(in_section) json<<"\n  ]";
+            in_section = false;
+            first_field = false;
+        }
+
+    public:
+
+        JsonReport(){
+            json<<fixed<<setprecision(4)<<"{";
+            first_field = true;
+            first_row = true;
+            in_section = false;
+            in_row = false;
+        }
+
+
+        /*Funciton Name: Field(const string& key, value)                                   */
+        /*Description: add a field to the open row, top-level without a row */
+        /*Input: const string& key - field name
+                        value - number, bool or string                                                            */
+        /*Output: JsonReport& report - this, for chaining                                  */
+
+        template<typename T>
+        JsonReport& Field(const string& key, T value){
+            Key(key);
+            json<<value;
+            return *this;
+        }
+
+        JsonReport& Field(const string& key, bool value){
+            Key(key);
+            json<<(value ? "true" : "false");
+            return *this;
+        }
+
+        JsonReport& Field(const string& key, const string& value){
+            Key(key);
+            json<<"\""<<value<<"\"";
+            return *this;
+        }
+
+        JsonReport& Field(const string& key, const char* value){ return Field(key, string(value)); }
+
+
+        /*Funciton Name: Latency(const string& key, const LatencyStats& stats) */
+        /*Description: mean, p50, p90, p99 and max of the samples as an object */
+        /*Input: const string& key - field name
+                        const LatencyStats& stats - samples                                                      */
+        /*Output: JsonReport& report - this, for chaining                                           */
+
+        JsonReport& Latency(const string& key, const LatencyStats& stats){
+            Key(key);
+            json<<"{\"mean\": "<<stats.Mean()<<", \"p50\": "<<stats.Percentile(50)<<", \"p90\": "<<stats.Percentile(90)
+                <<", \"p99\": "<<stats.Percentile(99)<<", \"max\": "<<stats.Percentile(100)<<"}";
+            return *this;
+        }
+
+
+        /*Funciton Name: Section(const string& name)                                         */
+        /*Description: close the open section and start a new array of rows */
+        /*Input: const string& name - section name                                             */
+        /*Output: void                                                                                                           */
+
+        void Section(const string& name){
+            CloseSection();
+            Key(name);
+            json<<"[";
+            in_section = true;
+            first_row = true;
+        }
+
+
+        /*Funciton Name: Row()                                                                                     */
+        /*Description: close the open row and start a new one in the section */
+        /*Input: void                                                                                                           */
+        /*Output: JsonReport& report - this, for chaining                                  */
+
+        JsonReport& Row(){
+            CloseRow();
+            json<<(first_row ? "" : ",")<<"\n    {";
+            first_row = false;
+            first_field = true;
+            in_row = true;
+            return *this;
+        }
+
+
+        /*Funciton Name: Str()                                                                                      */
+        /*Description: close the report                                                                      */
+        /*Input: void                                                                                                           */
+        /*Output: string json                                                                                              */
+
+        string Str(){
+            CloseSection();
+            json<<"\n}\n";
+            return json.str();
+        }
+
+};
+
+
+
+/*****************************************************************
+Structure Name: DisparityScore
+Description: density and bad-pixel rates of disparity maps (CV_8U) against
+                         ground truth (CV_32F, <=0 for unknown)
+*****************************************************************/
+
+struct DisparityScore{
+
+    long gt_pixels;
+    long valid;
+    long bad_1;
+    long bad_2;
+    long bad_4;
+
+    DisparityScore(){ gt_pixels = valid = bad_1 = bad_2 = bad_4 = 0; }
+
+
+    /*Funciton Name: Add(Mat disparity, Mat gt, int first_column)                */
+    /*Description: score columns from first_column on                                       */
+    /*Input: Mat disparity - disparity map
+                    Mat gt - ground truth
+                    int first_column - first scored column                                                         */
+    /*Output: void                                                                                                                         */
+
+    void Add(Mat disparity, Mat gt, int first_column){
+        for(int v = 0; v < disparity.rows; v++){
+            const uchar* d = disparity.ptr<uchar>(v);
+            const float* truth = gt.ptr<float>(v);
+            for(int u = first_column; u < disparity.cols; u++){
+                if(truth[u] <= 0) continue;
+                gt_pixels++;
+                if(d[u] == 0) continue;
+                valid++;
+                float err = fabs(d[u] - truth[u]);
+                bad_1 += err > 1;
+                bad_2 += err > 2;
+                bad_4 += err > 4;
+            }
+        }
+    }
+
+
+    /*Funciton Name: Write(JsonReport& report)                                               */
+    /*Description: add the rates to the open row, nothing without ground truth */
+    /*Input: JsonReport& report - report                                                               */
+    /*Output: void                                                                                                                   */
+
+    void Write(JsonReport& report){
+        if(gt_pixels == 0) return;
+        report.Field("density", Ratio(valid, gt_pixels)).Field("bad_1", Ratio(bad_1, valid))
+              .Field("bad_2", Ratio(bad_2, valid)).Field("bad_4", Ratio(bad_4, valid));
+    }
+
+};
+
+
+
+/*****************************************************************
+Structure Name: GroundScore
+Description: ground pixels removed and obstacle pixels kept by a ground
+                         filter against the synthetic labels
+*****************************************************************/
+
+struct GroundScore{
+
+    long ground;
+    long ground_removed;
+    long obstacle;
+    long obstacle_kept;
+
+    GroundScore(){ ground = ground_removed = obstacle = obstacle_kept = 0; }
+
+
+    /*Funciton Name: Add(Mat disparity, Mat labels)                                         */
+    /*Description: score one filtered disparity map                                          */
+    /*Input: Mat disparity - filtered disparity map
+                    Mat labels - labels of the frame                                                                */
+    /*Output: void                                                                                                                   */
+
+    void Add(Mat disparity, Mat labels){
+        for(int v = 0; v < disparity.rows; v++){
+            const uchar* d = disparity.ptr<uchar>(v);
+            const uchar* label = labels.ptr<uchar>(v);
+            for(int u = 0; u < disparity.cols; u++){
+                if(label[u] == 1){
+                    ground++;
+                    ground_removed += d[u] == 0;
+                }
+                else if(label[u] >= 2){
+                    obstacle++;
+                    obstacle_kept += d[u] != 0;
+                }
+            }
+        }
+    }
+
+
+    /*Funciton Name: Write(JsonReport& report)                                               */
+    /*Description: add the rates to the open row                                               */
+    /*Input: JsonReport& report - report                                                               */
+    /*Output: void                                                                                                                   */
+
+    void Write(JsonReport& report){
+        report.Field("ground_removed", Ratio(ground_removed, ground)).Field("obstacle_kept", Ratio(obstacle_kept, obstacle));
+    }
+
+};
+
+
+
+/*****************************************************************
+Structure Name: DetectionScore
+Description: recall and precision of object lists against the synthetic
+                         boxes, greedy one-to-one matching at IoU 0.5
+*****************************************************************/
+
+struct DetectionScore{
+
+    long truth;
+    long detected;
+    long true_positive;
+
+    DetectionScore(){ truth = detected = true_positive = 0; }
+
+
+    /*Funciton Name: Add(const vector<Object_2D>& objects, const vector<Object_2D>& list) */
+    /*Description: match one frame                                                                                                           */
+    /*Input: const vector<Object_2D>& objects - ground truth boxes
+                    const vector<Object_2D>& list - detected boxes                                                                 */
+    /*Output: void                                                                                                                                                       */
+
+    void Add(const vector<Object_2D>& objects, const vector<Object_2D>& list){
+        vector<bool> matched(list.size(), false);
+        for(size_t i = 0; i < objects.size(); i++){
+            for(size_t j = 0; j < list.size(); j++){
+                if(matched[j] || IoU(objects[i], list[j]) < 0.5) continue;
+                matched[j] = true;
+                true_positive++;
+                break;
+            }
+        }
+        truth += objects.size();
+        detected += list.size();
+    }
+
+
+    /*Funciton Name: Write(JsonReport& report)                                               */
+    /*Description: add recall and precision to the open row                           */
+    /*Input: JsonReport& report - report                                                               */
+    /*Output: void                                                                                                                   */
+
+    void Write(JsonReport& report){
+        report.Field("recall", Ratio(true_positive, truth)).Field("precision", Ratio(true_positive, detected));
+    }
+
+};
+
+
+/*Funciton Name: SameObjects(const vector<Object_2D>& a, const vector<Object_2D>& b) */
+/*Description: same boxes and disparities in the same order                                                 */
+/*Input: const vector<Object_2D>& a, const vector<Object_2D>& b - object lists                         */
+/*Output: bool identical                                                                                                                                         */
+
+static bool SameObjects(const vector<Object_2D>& a, const vector<Object_2D>& b){
+
+    if(a.size() != b.size()) return false;
+    for(size_t i = 0; i < a.size(); i++)
+        if(a[i].tl != b[i].tl || a[i].br != b[i].br || a[i].disparity != b[i].disparity) return false;
+    return true;
+
+}
+
+
+/*Funciton Name: ObstacleDisparity(const StereoFrame& frame)                     */
+/*Description: ground-truth disparity (CV_8U) with ground and background
+                         removed                                                                                                                 */
+/*Input: const StereoFrame& frame - synthetic frame                                            */
+/*Output: Mat disparity                                                                                                                */
+
+static Mat ObstacleDisparity(const StereoFrame& frame){
+
+    Mat disparity;
+    frame.gt.convertTo(disparity, CV_8U);
+    disparity.setTo(0, frame.labels < 2);
+    return disparity;
+
+}
+
+
+/*****************************************************************
+Class Name: FixedGroundFilter
+Description: ground filter with a given ground line
+*****************************************************************/
+
+class FixedGroundFilter: public VDisparityGroundFilter{
+
+    public:
+
+        FixedGroundFilter(float k, float b, int tolerance){
+            ground_k = k;
+            ground_b = b;
+            ground_tolerance = tolerance;
+        }
+
+};
+
+
+/*Funciton Name: FilterGroundReference(Mat& disparity, float k, float b, int tolerance) */
+/*Description: per-pixel ground filter, as VDisparityGroundFilter did before
+                         the row threshold table                                                                          */
+/*Input: Mat& disparity - disparity map
+                float k, float b - ground line
+                int tolerance - ground tolerance                                                                     */
+/*Output: void                                                                                                                            */
+
+static void FilterGroundReference(Mat& disparity, float ground_k, float ground_b, int ground_tolerance){
+
+    for (int r = 0; r < disparity.rows;r++) {
+        for (int c = 0; c < disparity.cols;c++){
+            int pixel = disparity.at<uint8_t>(r, c);
+            if (r >int(ground_k*pixel+ground_b-ground_tolerance)) disparity.at<uint8_t>(r, c)=0;
+        }
+    }
+
+}
+
+
+/*Funciton Name: LegacyContour(Mat disparity, CameraModel* cm, vector<float> list_depth, string config) */
+/*Description: ContourDetector as before the slice table: inRange, threshold,
+                         20x20 erode, 30x30 dilate, Canny and findContours per depth
+                         slice                                                                                                            */
+/*Input: Mat disparity - disparity map, ground removed
+                CameraModel* cm - camera model
+                vector<float> list_depth - depth of the waypoints
+                string config - path to configuration file                                                    */
+/*Output: vector<Object_2D> list                                                                                           */
+
+static vector<Object_2D> LegacyContour(Mat disparity, CameraModel* cm, vector<float> list_depth, string config){
+
+    FileStorage fs(config, FileStorage::READ);
+    int pre_median_kernel = (int)fs["od_pre_median_kernel"], canny_threshold = (int)fs["canny_threshold"];
+    fs.release();
+    if(pre_median_kernel>0 && pre_median_kernel%2 == 1) medianBlur(disparity, disparity, pre_median_kernel);
+
+    SizeFilter sf(cm, config);
+    ConfidenceFilter cf(config);
+    NMSFilter nmsf(config);
+    vector<Object_2D> list;
+
+    int delta, delta1 = 0;
+    for(int k=0; k+1<(int)list_depth.size() && delta1!=1; k++){
+
+        delta = cm->Distance_Disparity(list_depth[k]);
+        delta1 = cm->Distance_Disparity(list_depth[k+1]);
+        if(delta == delta1) delta1 = 1;
+
+        Mat masked_disparity, canny_output;
+        inRange(disparity, delta1, delta, masked_disparity);
+        threshold(masked_disparity, masked_disparity, delta1, 255, THRESH_BINARY);
+        erode(masked_disparity, masked_disparity, getStructuringElement(MORPH_RECT, Size(20,20)));
+        dilate(masked_disparity, masked_disparity, getStructuringElement(MORPH_RECT, Size(30,30)));
+        Canny(masked_disparity, canny_output, canny_threshold, canny_threshold*2);
+        vector<vector<Point> > contours;
+        findContours(canny_output, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+
+        vector<Rect> boxes;
+        for(size_t i = 0; i < contours.size(); i++){
+            vector<Point> poly;
+            approxPolyDP(contours[i], poly, 3, true);
+            Rect box = boundingRect(poly);
+            if(cf.ConfidenceFit(masked_disparity, box)) boxes.push_back(box);
+        }
+        if(boxes.empty()) continue;
+        boxes = nmsf.FilterObjectBox(boxes);
+        for(size_t i = 0; i < boxes.size(); i++){
+            Object_2D obj;
+            obj.tl = boxes[i].tl();
+            obj.br = boxes[i].br();
+            obj.disparity = delta;
+            list.push_back(obj);
+        }
+
+    }
+
+    sf.UpdateObjectSource(&list);
+    sf.FilterObjectList();
+    return list;
+
+}
+
+
+/*Funciton Name: ScanDisparity(Mat disparity, Rect box, int type, int& count) */
+/*Description: box disparity by scanning every pixel as ObjectDetector did
+                         before the box statistics, bottom-right corner included    */
+/*Input: Mat disparity - disparity map
+                Rect box - box
+                int type - 0 median, 1 average, 2 max
+                int& count - non-zero pixels of the box                                                   */
+/*Output: int disparity, 0 if no pixel                                                                                     */
+
+static int ScanDisparity(Mat disparity, Rect box, int type, int& count){
+
+    vector<float> vec;
+    for(int r = box.y; r <= box.br().y; r++)
+        for(int c = box.x; c <= box.br().x; c++)
+            if(disparity.at<uchar>(r, c) != 0) vec.push_back(disparity.at<uchar>(r, c));
+    count = vec.size();
+    if(vec.empty()) return 0;
+
+    if(type == 0){
+        nth_element(vec.begin(), vec.begin() + vec.size()/2, vec.end());
+        return vec[vec.size()/2];
+    }
+    if(type == 1){
+        float sum = 0;
+        for(size_t k = 0; k < vec.size(); k++) sum += vec[k];
+        return int(sum/vec.size());
+    }
+    return *max_element(vec.begin(), vec.end());
+
+}
+
+
+/*Funciton Name: LegacyRANSAC(Mat v_disparity, FileStorage& fs, float& k, float& b) */
+/*Description: RANSAC ground line as RANSACGroundFilter did before the
+                         count-weighted estimator: binary points, rand(), integer k/b */
+/*Input: Mat v_disparity - thresholded v-disparity (CV_8U)
+                FileStorage& fs - configuration
+                float& k, float& b - ground line                                                                      */
+/*Output: bool accepted                                                                                                               */
+
+static bool LegacyRANSAC(Mat v_disparity, FileStorage& fs, float& k, float& b){
+
+    int num_samples = (int)fs["num_samples"], start_row = (int)fs["start_row"], max_iteration = (int)fs["max_iteration"];
+    float distance_threshold = (float)fs["distance_threshold"];
+
+    vector<Point2f> list_point;
+    for(int r=start_row; r<v_disparity.rows; r++)
+        for(int c=0; c<v_disparity.cols; c++)
+            if(v_disparity.at<uint8_t>(r,c)>0) list_point.push_back(Point2f(c,v_disparity.rows-r));
+    if((int)list_point.size()<=num_samples) return false;
+
+    LineModel ground_line;
+    int max_cost = 0;
+    for(int i=0; i<max_iteration; i++){
+        float sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0, sw = 0;
+        for(int j=0; j<num_samples; j++){
+            Point2f p = list_point[rand() % list_point.size()];
+            sx += p.x; sy += p.y; sxx += p.x*p.x; sxy += p.x*p.y; syy += p.y*p.y; sw += 1;
+        }
+        float vxx = (sxx - sx*sx / sw) / sw, vxy = (sxy - sx*sy / sw) / sw, vyy = (syy - sy*sy / sw) / sw;
+        float theta = atan2(2 * vxy, vxx - vyy) / 2;
+        LineModel line = {cos(theta), sin(theta), sx / sw, sy / sw};
+        int cost = 0;
+        for(size_t j=0; j<list_point.size(); j++)
+            cost += fabs((list_point[j].x - line.sx)*line.my - (list_point[j].y - line.sy)*line.mx) < distance_threshold;
+        if(cost>max_cost){
+            max_cost = cost;
+            ground_line = line;
+        }
+    }
+
+    int temp_k = int(ground_line.my / (ground_line.mx + 1e-6));
+    if(!isless(abs(temp_k), 10000)) return false;
+    int temp_b = int( v_disparity.rows - int(ground_line.sy - temp_k * ground_line.sx));
+    k = abs(temp_k);
+    b = temp_b;
+    return isgreater(temp_b, 0)&&isless(temp_b, 100);
+
+}
+
+
+/*****************************************************************
+Structure Name: BenchSettings
+Description: command line settings shared by the sections
+*****************************************************************/
+
+struct BenchSettings{
+
+    string config;
+    string calibration;
+    string montage;
+    string lane_config;
+    int iterations;
+    int synthetic;
+    int max_disparity;
+    float pitch;
+
+};
+
+
+/*Funciton Name: BenchEngines(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: disparity engines at full and half resolution through a single-mode
+                         scheduler, which gives resizing and a common output scale                                                 */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                                     */
+/*Output: void                                                                                                                                                                                                         */
+
+static void BenchEngines(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    const char* engines[] = {"SGBM", "BM", "ELAS"};
+    report.Section("results");
+    for(int type = 0; type < 3; type++){
+        for(int downscale = 1; downscale <= 2; downscale++){
+
+            DisparityScheduler engine;
+            engine.AddMode(settings.config, type, downscale, settings.max_disparity);
+
+            // warm up
+            for(size_t f = 0; f < corpus.size(); f++) engine.CalculateDispMap(corpus[f].left, corpus[f].right);
+
+            LatencyStats latency;
+            latency.Reserve(settings.iterations*corpus.size());
+            DisparityScore score;
+            long alloc = 0;
+            for(int it = 0; it < settings.iterations; it++){
+                for(size_t f = 0; f < corpus.size(); f++){
+
+                    AllocationScope scope;
+                    auto start = chrono::steady_clock::now();
+                    Mat disparity = engine.CalculateDispMap(corpus[f].left, corpus[f].right);
+                    latency.AddSince(start);
+                    alloc += scope.Count();
+
+                    // errors only once per frame, skipping the left strip without matches
+                    if(it == 0 && !corpus[f].gt.empty()) score.Add(disparity, corpus[f].gt, settings.max_disparity);
+
+                }
+            }
+            report.Row().Field("engine", engines[type]).Field("downscale", downscale).Latency("latency_ms", latency)
+                  .Field("throughput_fps", latency.Throughput()).Field("allocations_per_frame", Ratio(alloc, latency.Count()));
+            score.Write(report);
+
+        }
+    }
+
+}
+
+
+/*Funciton Name: BenchElasBorder(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: direct 8 bit ELAS path against the padded float path with CV_16S(x16)/8
+                         conversion it replaced, over the left border strip and the whole map                     */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                                         */
+/*Output: void                                                                                                                                                                                                             */
+
+static void BenchElasBorder(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    StereoEfficientLargeScale baseline(0, settings.max_disparity), direct(0, settings.max_disparity);
+    LatencyStats baseline_ms, direct_ms;
+    long border_pixels = 0, border_different = 0, pixels = 0, different = 0;
+    for(size_t f = 0; f < corpus.size(); f++){
+
+        Mat left = corpus[f].left, right = corpus[f].right, disp16, reference, result;
+        auto start = chrono::steady_clock::now();
+        baseline(left, right, disp16, settings.max_disparity);
+        disp16.convertTo(reference, CV_8U, 1.0/8);
+        baseline_ms.AddSince(start);
+
+        start = chrono::steady_clock::now();
+        direct.compute(left, right, result, 2.f, settings.max_disparity);
+        direct_ms.AddSince(start);
+
+        Mat diff = reference != result;
+        int border = min(settings.max_disparity, diff.cols);
+        border_pixels += diff.rows*border;
+        border_different += countNonZero(diff.colRange(0, border));
+        pixels += diff.total();
+        different += countNonZero(diff);
+
+    }
+
+    report.Section("elas_border");
+    report.Row().Field("border", settings.max_disparity).Field("baseline_ms", baseline_ms.Mean()).Field("direct_ms", direct_ms.Mean())
+          .Field("speedup", Ratio(baseline_ms.Mean(), direct_ms.Mean()))
+          .Field("left_border_identical", border_different == 0).Field("left_border_different", Ratio(border_different, border_pixels))
+          .Field("identical", different == 0).Field("different", Ratio(different, pixels));
+
+}
+
+
+/*Funciton Name: BenchElasTemporal(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: ELAS with full support matching every frame against temporal support
+                         reuse, with empty tiles searched every frame (interval 1) and every
+                         5th frame, on the consecutive frames of the corpus                                                       */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                                            */
+/*Output: void                                                                                                                                                                                                                */
+
+static void BenchElasTemporal(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    const int temporal[] = {0, 1, 1}, empty_intervals[] = {1, 1, 5};
+    double full_ms = 0;
+    report.Section("elas_temporal");
+    for(int mode = 0; mode < 3; mode++){
+
+        StereoEfficientLargeScale elas(0, settings.max_disparity);
+        elas.elas.param.temporal_support = temporal[mode];
+        elas.elas.param.temporal_empty_interval = empty_intervals[mode];
+
+        LatencyStats latency;
+        DisparityScore score;
+        for(int it = 0; it < settings.iterations; it++){
+            for(size_t f = 0; f < corpus.size(); f++){
+
+                Mat disparity;
+                auto start = chrono::steady_clock::now();
+                elas.compute(corpus[f].left, corpus[f].right, disparity, 1.f, settings.max_disparity);
+                latency.AddSince(start);
+
+                if(it == 0 && !corpus[f].gt.empty()) score.Add(disparity, corpus[f].gt, settings.max_disparity);
+
+            }
+        }
+        if(mode == 0) full_ms = latency.Mean();
+
+        report.Row().Field("temporal_support", temporal[mode] == 1).Field("empty_interval", empty_intervals[mode])
+              .Latency("latency_ms", latency).Field("speedup", Ratio(full_ms, latency.Mean()));
+        score.Write(report);
+
+    }
+
+}
+
+
+/*Funciton Name: BenchElasSubsampling(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: DisparityELAS at full resolution against the subsampled mode with
+                         edge-aware upsampling: latency, error against the full resolution
+                         map and against ground truth                                                                                                 */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                                                */
+/*Output: void                                                                                                                                                                                                                    */
+
+static void BenchElasSubsampling(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    DisparityParams params = DetectionConfig::Load(settings.config).disparity;
+    params.max_disparity = settings.max_disparity;
+    params.elas.subsampling = false;
+    DisparityELAS full(params);
+    params.elas.subsampling = true;
+    DisparityELAS half(params);
+
+    LatencyStats full_ms, half_ms;
+    DisparityScore full_score, half_score;
+    long both_valid = 0, full_valid = 0, half_valid = 0, differ_1 = 0, differ_2 = 0;
+    for(int it = 0; it < settings.iterations; it++){
+        for(size_t f = 0; f < corpus.size(); f++){
+
+            auto start = chrono::steady_clock::now();
+            Mat reference = full.CalculateDispMap(corpus[f].left, corpus[f].right);
+            full_ms.AddSince(start);
+
+            start = chrono::steady_clock::now();
+            Mat result = half.CalculateDispMap(corpus[f].left, corpus[f].right);
+            half_ms.AddSince(start);
+
+            if(it > 0) continue;
+
+            // both maps in pixels, the left strip without matches skipped
+            Mat reference_px, result_px;
+            reference.convertTo(reference_px, CV_8U, 1.0/full.LevelsPerPixel());
+            result.convertTo(result_px, CV_8U, 1.0/half.LevelsPerPixel());
+            for(int v = 0; v < reference_px.rows; v++){
+                const uchar* d_full = reference_px.ptr<uchar>(v);
+                const uchar* d_half = result_px.ptr<uchar>(v);
+                for(int u = settings.max_disparity; u < reference_px.cols; u++){
+                    full_valid += d_full[u] != 0;
+                    half_valid += d_half[u] != 0;
+                    if(d_full[u] == 0 || d_half[u] == 0) continue;
+                    both_valid++;
+                    differ_1 += abs(d_full[u] - d_half[u]) > 1;
+                    differ_2 += abs(d_full[u] - d_half[u]) > 2;
+                }
+            }
+            if(!corpus[f].gt.empty()){
+                full_score.Add(reference_px, corpus[f].gt, settings.max_disparity);
+                half_score.Add(result_px, corpus[f].gt, settings.max_disparity);
+            }
+
+        }
+    }
+
+    report.Section("elas_subsampling");
+    report.Row().Field("subsampling", false).Latency("latency_ms", full_ms);
+    full_score.Write(report);
+    report.Row().Field("subsampling", true).Latency("latency_ms", half_ms)
+          .Field("speedup", Ratio(full_ms.Mean(), half_ms.Mean()))
+          .Field("density_vs_full", Ratio(half_valid, full_valid))
+          .Field("differ_1_vs_full", Ratio(differ_1, both_valid)).Field("differ_2_vs_full", Ratio(differ_2, both_valid));
+    half_score.Write(report);
+
+}
+
+
+/*Funciton Name: BenchGroundFilters(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: online ground filters on ground-truth disparity                                                                                             */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                                          */
+/*Output: void                                                                                                                                                                                                              */
+
+static void BenchGroundFilters(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    const char* ground_filters[] = {"Hough", "RANSAC", "Peak"};
+    report.Section("ground_filters");
+    for(int type = 0; type < 3; type++){
+
+        HoughGroundFilter hgf(settings.config);
+        RANSACGroundFilter rgf(settings.config);
+        PeakGroundFilter pkgf(settings.config);
+        OnlineGroundFilter* gf = type == 0 ? (OnlineGroundFilter*)&hgf : type == 1 ? (OnlineGroundFilter*)&rgf : (OnlineGroundFilter*)&pkgf;
+
+        LatencyStats latency;
+        GroundScore score;
+        double error_k = 0, error_b = 0;
+        int frames = 0;
+        for(size_t f = 0; f < corpus.size(); f++){
+
+            if(corpus[f].labels.empty()) continue;
+            Mat disparity;
+            corpus[f].gt.convertTo(disparity, CV_8U);
+
+            auto start = chrono::steady_clock::now();
+            if(type == 0) hgf.UpdateGroundPlane(disparity);
+            else if(type == 1) rgf.UpdateGroundPlane(disparity);
+            else pkgf.UpdateGroundPlane(disparity);
+            gf->FilterGround(disparity);
+            latency.AddSince(start);
+
+            error_k += fabs(gf->GroundK() - corpus[f].ground_k);
+            error_b += fabs(gf->GroundB() - corpus[f].ground_b);
+            frames++;
+            score.Add(disparity, corpus[f].labels);
+
+        }
+
+        report.Row().Field("filter", ground_filters[type]).Latency("latency_ms", latency)
+              .Field("k_error", Ratio(error_k, frames)).Field("b_error", Ratio(error_b, frames));
+        score.Write(report);
+
+    }
+
+}
+
+
+/*Funciton Name: BenchRANSAC(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: legacy and count-weighted ground line estimators on the same v-disparity                  */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                               */
+/*Output: void                                                                                                                                                                                                   */
+
+static void BenchRANSAC(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    FileStorage fs(settings.config, FileStorage::READ);
+    RANSACGroundFilter rgf(settings.config);
+    UVDisparityHistogram histogram((int)fs["min_disparity"], (int)fs["max_disparity"]);
+
+    LatencyStats fit[2];
+    double error_k[2] = {0, 0}, error_b[2] = {0, 0};
+    int accepted[2] = {0, 0};
+    for(size_t f = 0; f < corpus.size(); f++){
+
+        if(corpus[f].labels.empty()) continue;
+        Mat disparity;
+        corpus[f].gt.convertTo(disparity, CV_8U);
+
+        histogram.Compute(disparity, false, true, (int)fs["start_row"], (int)fs["start_column"]);
+        Mat v_disparity = histogram.VView((int)fs["min_count"]);
+        float k = 0, b = 0;
+        srand(1234 + f);
+        auto start = chrono::steady_clock::now();
+        bool ok = LegacyRANSAC(v_disparity, fs, k, b);
+        fit[0].AddSince(start);
+        if(ok){
+            accepted[0]++;
+            error_k[0] += fabs(k - corpus[f].ground_k);
+            error_b[0] += fabs(b - corpus[f].ground_b);
+        }
+
+        rgf.UpdateGroundPlane(disparity);
+        start = chrono::steady_clock::now();
+        rgf.FitGroundPlane();
+        fit[1].AddSince(start);
+        accepted[1]++;
+        error_k[1] += fabs(rgf.GroundK() - corpus[f].ground_k);
+        error_b[1] += fabs(rgf.GroundB() - corpus[f].ground_b);
+
+    }
+
+    const char* names[] = {"legacy", "weighted"};
+    report.Section("ransac");
+    for(int i = 0; i < 2; i++){
+        report.Row().Field("estimator", names[i]).Field("fit_ms", fit[i].Mean())
+              .Field("accepted", Ratio(accepted[i], fit[i].Count()))
+              .Field("k_error", Ratio(error_k[i], accepted[i])).Field("b_error", Ratio(error_b[i], accepted[i]));
+    }
+
+}
+
+
+/*Funciton Name: BenchFilterGround(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus) */
+/*Description: FilterGround against the per-pixel reference, at output and raw sensor size                                                  */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                CameraModel& cm - camera model
+                const vector<StereoFrame>& corpus - corpus                                                                                                                                                       */
+/*Output: void                                                                                                                                                                                                                                           */
+
+static void BenchFilterGround(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus){
+
+    Size sizes[] = {Size(cm.OutWidth(), cm.OutHeight()), Size(cm.RawWidth(), cm.RawHeight())};
+    report.Section("filter_ground");
+    for(int s = 0; s < 2; s++){
+
+        LatencyStats reference_ms, lut_ms;
+        bool identical = true;
+        for(int it = 0; it < settings.iterations; it++){
+            for(size_t f = 0; f < corpus.size(); f++){
+
+                if(corpus[f].labels.empty()) continue;
+                Mat input, reference, result;
+                corpus[f].gt.convertTo(input, CV_8U);
+                resize(input, input, sizes[s], 0, 0, INTER_NEAREST);
+                // the ground line scales with the image height
+                float scale = (float)sizes[s].height/cm.OutHeight();
+                FixedGroundFilter gf(corpus[f].ground_k*scale, corpus[f].ground_b*scale, 3);
+
+                reference = input.clone();
+                auto start = chrono::steady_clock::now();
+                FilterGroundReference(reference, corpus[f].ground_k*scale, corpus[f].ground_b*scale, 3);
+                reference_ms.AddSince(start);
+
+                result = input.clone();
+                start = chrono::steady_clock::now();
+                gf.FilterGround(result);
+                lut_ms.AddSince(start);
+
+                identical = identical && countNonZero(reference != result) == 0;
+
+            }
+        }
+
+        report.Row().Field("width", sizes[s].width).Field("height", sizes[s].height)
+              .Field("reference_ms", reference_ms.Mean()).Field("row_threshold_ms", lut_ms.Mean())
+              .Field("speedup", Ratio(reference_ms.Mean(), lut_ms.Mean())).Field("identical", identical);
+
+    }
+
+}
+
+
+/*Funciton Name: BenchGroundPrediction(JsonReport& report, const BenchSettings& settings, CameraModel& cm) */
+/*Description: RANSAC every frame against the pose-predicted ground plane, on a
+                         pitching sequence                                                                                                                                                    */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                CameraModel& cm - camera model                                                                                                                                  */
+/*Output: void                                                                                                                                                                                          */
+
+static void BenchGroundPrediction(JsonReport& report, const BenchSettings& settings, CameraModel& cm){
+
+    FileStorage fs(settings.montage, FileStorage::READ);
+    float cam_height = (float)fs["abs_init_y"], cam_theta = settings.pitch;
+    fs.open(settings.config, FileStorage::READ);
+    int passes = max(1, (int)fs["NUM_OF_RANSAC_FILTERING"]);
+    fs.release();
+
+    vector<StereoFrame> sequence;
+    vector<float> thetas;
+    SyntheticScene pitching(&cm, settings.montage);
+    for(int i = 0; i < settings.synthetic; i++){
+        if(i%10 == 0) pitching.RandomBoxes(2 + (i/10)%3, 4321 + i);
+        thetas.push_back(settings.pitch + 2*sin(i*0.2f));
+        pitching.SetPitch(thetas.back());
+        StereoFrame frame;
+        pitching.Render(frame.left, frame.right);
+        frame.gt = pitching.GroundTruth().clone();
+        frame.labels = pitching.Labels().clone();
+        sequence.push_back(frame);
+        pitching.Step(0.15);
+    }
+
+    report.Section("ground_prediction");
+    for(int predict = 0; predict < 2; predict++){
+
+        RANSACGroundFilter rgf(settings.config);
+        PredictedGroundFilter pgf(&cm, settings.config);
+        pgf.SetPoseSource(&cam_height, &cam_theta);
+
+        LatencyStats latency;
+        GroundScore score;
+        for(size_t f = 0; f < sequence.size(); f++){
+
+            Mat disparity;
+            sequence[f].gt.convertTo(disparity, CV_8U);
+            cam_theta = thetas[f];
+
+            auto start = chrono::steady_clock::now();
+            if(predict) pgf.FilterGround(rgf, disparity, 0, passes);
+            else{
+                rgf.UpdateGroundPlane(disparity);
+                rgf.FilterGround(disparity, 0, passes);
+            }
+            latency.AddSince(start);
+            score.Add(disparity, sequence[f].labels);
+
+        }
+
+        report.Row().Field("mode", predict ? "predicted" : "every_frame").Latency("latency_ms", latency)
+              .Field("skip_ratio", predict ? pgf.SkipRatio() : 0);
+        score.Write(report);
+
+    }
+
+}
+
+
+/*Funciton Name: BenchMorphology(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: cv::erode/cv::dilate against the packed masks on obstacle masks                                            */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                                    */
+/*Output: void                                                                                                                                                                                                        */
+
+static void BenchMorphology(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    vector<Mat> masks;
+    for(size_t f = 0; f < corpus.size(); f++)
+        if(!corpus[f].labels.empty()) masks.push_back(corpus[f].labels >= 2);
+
+    int kernels[] = {5, 10, 20, 30, 60};
+    report.Section("morphology");
+    for(int i = 0; i < 5; i++){
+
+        Size kernel(kernels[i], kernels[i]);
+        Mat element = getStructuringElement(MORPH_RECT, kernel);
+        LatencyStats opencv_ms, packed_ms;
+        bool identical = true;
+        BitMask packed;
+        for(int it = 0; it < settings.iterations; it++){
+            for(size_t f = 0; f < masks.size(); f++){
+
+                Mat reference;
+                auto start = chrono::steady_clock::now();
+                erode(masks[f], reference, element);
+                dilate(reference, reference, element);
+                opencv_ms.AddSince(start);
+
+                // Packing included, as in ContourDetector
+                start = chrono::steady_clock::now();
+                packed.Create(masks[f].rows, masks[f].cols);
+                for(int r = 0; r < masks[f].rows; r++){
+                    const uchar* row = masks[f].ptr<uchar>(r);
+                    for(int c = 0; c < masks[f].cols; c++)
+                        if(row[c]) packed.Set(r, c);
+                }
+                packed.Erode(kernel);
+                packed.Dilate(kernel);
+                packed_ms.AddSince(start);
+
+                identical = identical && countNonZero(reference != packed.ToMat()) == 0;
+
+            }
+        }
+
+        report.Row().Field("kernel", kernels[i]).Field("opencv_ms", opencv_ms.Mean()).Field("packed_ms", packed_ms.Mean())
+              .Field("speedup", Ratio(opencv_ms.Mean(), packed_ms.Mean())).Field("identical", identical);
+
+    }
+
+}
+
+
+/*Funciton Name: BenchBoxStatistics(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus) */
+/*Description: box disparity and count by scanning against the box statistics, 200 random
+                         boxes per frame, statistics built once per frame                                                                                    */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                const vector<StereoFrame>& corpus - corpus                                                                                                                            */
+/*Output: void                                                                                                                                                                                                                */
+
+static void BenchBoxStatistics(JsonReport& report, const BenchSettings& settings, const vector<StereoFrame>& corpus){
+
+    const char* types[] = {"median", "average", "max"};
+    report.Section("box_statistics");
+    for(int type = 0; type < 3; type++){
+
+        LatencyStats scan_ms, stats_ms;
+        bool identical = true;
+        for(int it = 0; it < settings.iterations; it++){
+            for(size_t f = 0; f < corpus.size(); f++){
+
+                if(corpus[f].labels.empty()) continue;
+                Mat disparity = ObstacleDisparity(corpus[f]);
+
+                RNG rng(1234 + f);
+                vector<Rect> boxes;
+                for(int i = 0; i < 200; i++){
+                    int x = rng.uniform(0, disparity.cols - 1), y = rng.uniform(0, disparity.rows - 1);
+                    boxes.push_back(Rect(x, y, rng.uniform(1, disparity.cols - x), rng.uniform(1, disparity.rows - y)));
+                }
+
+                vector<int> reference(boxes.size()), reference_count(boxes.size());
+                auto start = chrono::steady_clock::now();
+                for(size_t i = 0; i < boxes.size(); i++) reference[i] = ScanDisparity(disparity, boxes[i], type, reference_count[i]);
+                scan_ms.AddSince(start);
+
+                vector<int> result(boxes.size()), result_count(boxes.size());
+                start = chrono::steady_clock::now();
+                BoxStatistics stats;
+                stats.Update(disparity, type != 1);
+                for(size_t i = 0; i < boxes.size(); i++){
+                    Rect box(boxes[i].x, boxes[i].y, boxes[i].width + 1, boxes[i].height + 1);
+                    result_count[i] = stats.Count(box);
+                    result[i] = type == 0 ? stats.Median(box) : type == 1 ? stats.Mean(box) : stats.Max(box);
+                }
+                stats_ms.AddSince(start);
+
+                identical = identical && reference == result && reference_count == result_count;
+
+            }
+        }
+
+        report.Row().Field("type", types[type]).Field("scan_ms", scan_ms.Mean()).Field("statistics_ms", stats_ms.Mean())
+              .Field("speedup", Ratio(scan_ms.Mean(), stats_ms.Mean())).Field("identical", identical);
+
+    }
+
+}
+
+
+/*Funciton Name: BenchSliceScaling(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus) */
+/*Description: ContourDetector against the number of waypoints (same lane depth) and worker
+                         threads; the list must not depend on the thread count                                                                                             */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                CameraModel& cm - camera model
+                const vector<StereoFrame>& corpus - corpus                                                                                                                                                        */
+/*Output: void                                                                                                                                                                                                                                            */
+
+static void BenchSliceScaling(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus){
+
+    FileStorage fs(settings.lane_config, FileStorage::READ);
+    float width = (float)fs["width"], min_depth = (float)fs["min_depth"], depth_step = (float)fs["depth_step"];
+    int num_of_waypoints = (int)fs["num_of_waypoints"];
+    fs.release();
+
+    const char* tmp = getenv("TMPDIR");
+    string scaled_lane = string(tmp ? tmp : "/tmp") + "/bench_lane.yml";
+    int default_threads = getNumThreads();
+
+    int waypoints[] = {6, 12, 24, 48};
+    report.Section("slice_scaling");
+    for(int w = 0; w < 4; w++){
+
+        FileStorage out(scaled_lane, FileStorage::WRITE);
+        out<<"width"<<width<<"min_depth"<<min_depth
+            <<"depth_step"<<depth_step*num_of_waypoints/waypoints[w]<<"num_of_waypoints"<<waypoints[w];
+        out.release();
+        CameraLane lane(&cm, scaled_lane);
+
+        vector<vector<Object_2D>> reference;
+        for(int threads = 1; threads <= max(1, getNumberOfCPUs()); threads *= 2){
+
+            setNumThreads(threads);
+            ContourDetector cd(&cm, &lane, settings.config);
+            LatencyStats latency;
+            bool identical = true;
+            for(int it = 0; it < settings.iterations; it++){
+                for(size_t f = 0, n = 0; f < corpus.size(); f++){
+
+                    if(corpus[f].labels.empty()) continue;
+                    Mat disparity = ObstacleDisparity(corpus[f]);
+
+                    auto start = chrono::steady_clock::now();
+                    vector<Object_2D> list = cd.DetectObject2D(disparity);
+                    latency.AddSince(start);
+
+                    if(threads == 1 && it == 0) reference.push_back(list);
+                    else identical = identical && SameObjects(reference[n], list);
+                    n++;
+
+                }
+            }
+
+            report.Row().Field("waypoints", waypoints[w]).Field("threads", threads)
+                  .Field("mean_ms", latency.Mean()).Field("identical", identical);
+
+        }
+    }
+
+    setNumThreads(default_threads);
+    remove(scaled_lane.c_str());
+
+}
+
+
+/*Funciton Name: BenchTracking(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus) */
+/*Description: full detection every N frames, tracks verified on the disparity map in
+                         between; ego-motion from the known forward step of the sequence                                                          */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                CameraModel& cm - camera model
+                const vector<StereoFrame>& corpus - corpus                                                                                                                                                 */
+/*Output: void                                                                                                                                                                                                                                     */
+
+static void BenchTracking(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus){
+
+    CameraLane lane(&cm, settings.lane_config);
+    int intervals[] = {1, 2, 5, 10};
+    report.Section("tracking");
+    for(int i = 0; i < 4; i++){
+
+        ContourDetector cd(&cm, &lane, settings.config);
+        Tracker tracker(cm.Q(), cm.OffsetX(), cm.OffsetY(), settings.config);
+        tracker.SetDetectInterval(intervals[i]);
+        Motion ego;
+        ego.position = Point3f(0, 0, 0);
+        ego.rotation.roll = ego.rotation.pitch = ego.rotation.yaw = 0;
+        tracker.SetEgoSource(&ego);
+
+        LatencyStats latency;
+        DetectionScore score;
+        for(size_t f = 0; f < corpus.size(); f++){
+
+            if(corpus[f].labels.empty()) continue;
+            Mat disparity = ObstacleDisparity(corpus[f]);
+            ego.position.z = -synthetic_step*f;
+
+            auto start = chrono::steady_clock::now();
+            tracker.Predict();
+            if(tracker.NeedDetection()) tracker.Correct(cd.DetectObject2D(disparity));
+            else tracker.Verify(disparity);
+            vector<Object_2D> list = tracker.List2D();
+            latency.AddSince(start);
+
+            score.Add(corpus[f].objects, list);
+
+        }
+
+        report.Row().Field("interval", intervals[i]).Field("duty_cycle", tracker.DutyCycle())
+              .Latency("latency_ms", latency).Field("track_ms", tracker.MeanTrackTime());
+        score.Write(report);
+
+    }
+
+}
+
+
+/*Funciton Name: BenchNMS(JsonReport& report, const BenchSettings& settings, CameraModel& cm) */
+/*Description: NMSFilter against dnn::NMSBoxes on clusters of overlapping boxes, same
+                         survivors; allocations of the lane and NMS chain once its scratch is warm */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                CameraModel& cm - camera model                                                                                                             */
+/*Output: void                                                                                                                                                                     */
+
+static void BenchNMS(JsonReport& report, const BenchSettings& settings, CameraModel& cm){
+
+    FileStorage fs(settings.config, FileStorage::READ);
+    float nms_threshold = (float)fs["NMS_threshold"];
+    fs.release();
+
+    NMSFilter nmsf(settings.config);
+    CameraLane lane(&cm, settings.lane_config);
+    lane.UpdateLane();
+    LaneFilter lf(&lane);
+    FilterChain chain;
+    chain.Add(&lf);
+    chain.SetNMS(&nmsf);
+
+    const int sizes[] = {16, 64, 256};
+    report.Section("nms");
+    for(int s = 0; s < 3; s++){
+
+        LatencyStats dnn_ms, filter_ms, chain_ms;
+        long chain_alloc = 0;
+        bool identical = true;
+        for(int it = 0; it < settings.iterations*20; it++){
+
+            RNG rng(4321 + it);
+            vector<Rect> boxes;
+            vector<Object_2D> list;
+            Rect obstacle;
+            for(int i = 0; i < sizes[s]; i++){
+                // four boxes jittered around each obstacle
+                if(i%4 == 0) obstacle = Rect(rng.uniform(10, cm.OutWidth() - 90), rng.uniform(10, cm.OutHeight() - 90), rng.uniform(10, 80), rng.uniform(10, 80));
+                boxes.push_back(Rect(obstacle.x + rng.uniform(-8, 9), obstacle.y + rng.uniform(-8, 9),
+                                                     obstacle.width + rng.uniform(-5, 6), obstacle.height + rng.uniform(-5, 6)));
+                Object_2D obj;
+                obj.tl = boxes.back().tl();
+                obj.br = boxes.back().br();
+                obj.disparity = rng.uniform(1, settings.max_disparity);
+                list.push_back(obj);
+            }
+
+            vector<float> confidences;
+            vector<int> indices;
+            auto start = chrono::steady_clock::now();
+            for(size_t i = 0; i < boxes.size(); i++) confidences.push_back(boxes[i].area()/1000.0);
+            dnn::NMSBoxes(boxes, confidences, 0.0, nms_threshold, indices);
+            dnn_ms.AddSince(start);
+
+            start = chrono::steady_clock::now();
+            vector<Rect> filtered = nmsf.FilterObjectBox(boxes);
+            filter_ms.AddSince(start);
+
+            // same survivors, the filter keeps the input order
+            vector<Rect> reference;
+            sort(indices.begin(), indices.end());
+            for(size_t i = 0; i < indices.size(); i++) reference.push_back(boxes[indices[i]]);
+            identical = identical && reference == filtered;
+
+            // list reserved as the detector's, the chain must not allocate
+            vector<Object_2D> objects;
+            objects.reserve(list.size());
+            objects.assign(list.begin(), list.end());
+            chain.UpdateObjectSource(&objects);
+            AllocationScope scope;
+            start = chrono::steady_clock::now();
+            chain.FilterObjectList();
+            chain_ms.AddSince(start);
+            if(it > 0) chain_alloc += scope.Count();
+
+        }
+
+        report.Row().Field("boxes", sizes[s]).Field("dnn_ms", dnn_ms.Mean()).Field("filter_ms", filter_ms.Mean())
+              .Field("speedup", Ratio(dnn_ms.Mean(), filter_ms.Mean())).Field("identical", identical)
+              .Field("chain_ms", chain_ms.Mean()).Field("chain_allocations", Ratio(chain_alloc, chain_ms.Count() - 1));
+
+    }
+
+}
+
+
+/*Funciton Name: BenchDetectors(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus) */
+/*Description: detectors on ground-truth disparity with ground and background removed,
+                         the contour detector also against the legacy Canny contours                                                                 */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                CameraModel& cm - camera model
+                const vector<StereoFrame>& corpus - corpus                                                                                                                                                   */
+/*Output: void                                                                                                                                                                                                                                       */
+
+static void BenchDetectors(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus){
+
+    CameraLane lane(&cm, settings.lane_config);
+    ContourDetector cd(&cm, &lane, settings.config);
+    UVDisparityDetector uvd(settings.config);
+
+    const char* detectors[] = {"ContourLegacy", "Contour", "Stixel"};
+    report.Section("detector");
+    for(int type = 0; type < 3; type++){
+
+        LatencyStats latency;
+        DetectionScore score;
+        long legacy_total = 0, legacy_matched = 0;
+        for(size_t f = 0; f < corpus.size(); f++){
+
+            if(corpus[f].labels.empty()) continue;
+            Mat disparity = ObstacleDisparity(corpus[f]);
+
+            // legacy boxes of the same frame, before the in-place median
+            vector<Object_2D> legacy;
+            if(type == 1) legacy = LegacyContour(disparity.clone(), &cm, lane.ListDepth(), settings.config);
+
+            auto start = chrono::steady_clock::now();
+            vector<Object_2D> list;
+            if(type == 0) list = LegacyContour(disparity, &cm, lane.ListDepth(), settings.config);
+            else if(type == 1) list = cd.DetectObject2D(disparity);
+            else{
+                uvd.SetGroundPlane(corpus[f].ground_k, corpus[f].ground_b);
+                list = uvd.DetectObject2D(disparity);
+            }
+            latency.AddSince(start);
+
+            score.Add(corpus[f].objects, list);
+
+            // blob boxes against the Canny contour boxes, within a pixel
+            for(size_t i = 0; i < legacy.size(); i++){
+                for(size_t j = 0; j < list.size(); j++){
+                    if(fabs(legacy[i].tl.x - list[j].tl.x) > 1 || fabs(legacy[i].tl.y - list[j].tl.y) > 1) continue;
+                    if(fabs(legacy[i].br.x - list[j].br.x) > 1 || fabs(legacy[i].br.y - list[j].br.y) > 1) continue;
+                    legacy_matched++;
+                    break;
+                }
+            }
+            legacy_total += legacy.size();
+
+        }
+
+        report.Row().Field("detector", detectors[type]).Latency("latency_ms", latency);
+        score.Write(report);
+        if(type == 1) report.Field("legacy_agreement", Ratio(legacy_matched, legacy_total));
+
+    }
+
+}
+
+
+/*Funciton Name: BenchPipelines(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus) */
+/*Description: production pipeline with its stages known at compile time against the
+                         configurable pipeline of Detection built from the same configuration;
+                         same object lists if the configuration is the production one                                                            */
+/*Input: JsonReport& report - report
+                const BenchSettings& settings - settings
+                CameraModel& cm - camera model
+                const vector<StereoFrame>& corpus - corpus                                                                                                                                                   */
+/*Output: void                                                                                                                                                                                                                                       */
+
+static void BenchPipelines(JsonReport& report, const BenchSettings& settings, CameraModel& cm, const vector<StereoFrame>& corpus){
+
+    const DetectionConfig& params = DetectionConfig::Load(settings.config);
+    const DetectionParams& selection = params.detection;
+    bool production = DetectionFactory::IsProduction(params, false);
+    CameraLane lane(&cm, settings.lane_config);
+    lane.UpdateLane();
+    int min_disparity = selection.FILTER_BACKGROUND ? cm.Distance_Disparity(lane.LaneDepth()) : 0;
+
+    ProductionPipeline fixed(DisparitySGBM(params.disparity),
+                                                      OnlineGround<RANSACGroundFilter>(RANSACGroundFilter(params.ground), selection.NUM_OF_RANSAC_FILTERING),
+                                                      ContourDetector(&cm, &lane, params.detector, params.filter), NMSFilter(params.filter));
+
+    Ptr<OnlineGroundFilter> ogf = DetectionFactory::CreateOnlineGroundFilter(params, false);
+    Ptr<ObjectFilter2D> lf = DetectionFactory::CreateLaneFilter(params, &lane, NULL);
+    Ptr<NMSFilter> nmsf = DetectionFactory::CreateNMSFilter(params);
+    FilterChain chain;
+    if(lf) chain.Add(lf.get());
+    chain.SetNMS(nmsf.get());
+    RuntimePipeline runtime(RuntimeDisparity(DetectionFactory::CreateDisparity(params), DetectionFactory::CreateScheduler(params)),
+                                                 RuntimeGround(DetectionFactory::CreateMonoGroundFilter(params, NULL), ogf,
+                                                                               ogf ? DetectionFactory::CreatePredictedGroundFilter(params, &cm) : Ptr<PredictedGroundFilter>(),
+                                                                               selection.ONLINE_GROUND_FILTER_TYPE == 1 ? selection.NUM_OF_RANSAC_FILTERING : 1),
+                                                 DetectionFactory::CreateDetector(params, &cm, &lane), chain);
+
+    // frames alternate between the pipelines, both see the same sequence
+    LatencyStats fixed_latency, runtime_latency;
+    long objects = 0;
+    bool identical = true;
+    for(int it = 0; it < settings.iterations; it++){
+        for(size_t f = 0; f < corpus.size(); f++){
+
+            auto start = chrono::steady_clock::now();
+            vector<Object_2D>& fixed_list = fixed.Update2D(corpus[f].left, corpus[f].right, min_disparity);
+            fixed_latency.AddSince(start);
+
+            start = chrono::steady_clock::now();
+            vector<Object_2D>& runtime_list = runtime.Update2D(corpus[f].left, corpus[f].right, min_disparity);
+            runtime_latency.AddSince(start);
+
+            objects += fixed_list.size();
+            identical = identical && SameObjects(fixed_list, runtime_list);
+
+        }
+    }
+
+    report.Section("pipeline");
+    report.Row().Field("pipeline", "Production").Latency("latency_ms", fixed_latency);
+    report.Row().Field("pipeline", "Runtime").Latency("latency_ms", runtime_latency)
+          .Field("speedup", Ratio(runtime_latency.Mean(), fixed_latency.Mean()))
+          .Field("production_config", production).Field("identical", identical)
+          .Field("objects_per_frame", Ratio(objects, fixed_latency.Count()));
+
+}
+
+
+int main(int argc, char** argv){
+
+    BenchSettings settings;
+    settings.config = "../config/ransac_fullsize.yml";
+    settings.calibration = "../config/t265_fullsize.yml";
+    settings.montage = "../config/montage.yml";
+    settings.lane_config = "../config/lane.yml";
+    settings.iterations = 5;
+    settings.synthetic = 30;
+    settings.max_disparity = 64;
+    settings.pitch = 0;
+    string recorded;
+    string output;
+
+    for(int i = 1; i + 1 < argc; i += 2){
+        string key = argv[i], value = argv[i+1];
+        if(key == "--config") settings.config = value;
+        else if(key == "--calibration") settings.calibration = value;
+        else if(key == "--montage") settings.montage = value;
+        else if(key == "--lane") settings.lane_config = value;
+        else if(key == "--pitch") settings.pitch = stof(value);
+        else if(key == "--recorded") recorded = value;
+        else if(key == "--out") output = value;
+        else if(key == "--iterations") settings.iterations = stoi(value);
+        else if(key == "--synthetic") settings.synthetic = stoi(value);
+        else if(key == "--max_disparity") settings.max_disparity = stoi(value);
+    }
+
+    // Corpus
+    CameraModel cm(settings.calibration);
+    SyntheticScene scene(&cm, settings.montage);
+    scene.SetPitch(settings.pitch);
+    vector<StereoFrame> corpus = SyntheticSequence(scene, settings.synthetic);
+    if(!recorded.empty()){
+        vector<StereoFrame> frames = LoadRecorded(recorded);
+        corpus.insert(corpus.end(), frames.begin(), frames.end());
+    }
+
+    JsonReport report;
+    report.Field("config", settings.config).Field("frames", corpus.size()).Field("iterations", settings.iterations);
+
+    BenchEngines(report, settings, corpus);
+    BenchElasBorder(report, settings, corpus);
+    BenchElasTemporal(report, settings, corpus);
+    BenchElasSubsampling(report, settings, corpus);
+    BenchGroundFilters(report, settings, corpus);
+    BenchRANSAC(report, settings, corpus);
+    BenchFilterGround(report, settings, cm, corpus);
+    BenchGroundPrediction(report, settings, cm);
+    BenchMorphology(report, settings, corpus);
+    BenchBoxStatistics(report, settings, corpus);
+    BenchSliceScaling(report, settings, cm, corpus);
+    BenchTracking(report, settings, cm, corpus);
+    BenchNMS(report, settings, cm);
+    BenchDetectors(report, settings, cm, corpus);
+    BenchPipelines(report, settings, cm, corpus);
+
+    if(output.empty()) cout<<report.Str();
+    else ofstream(output)<<report.Str();
+
+    return 0;
+
+}
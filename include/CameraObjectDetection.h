@@ -19,6 +19,7 @@ Description:        CameraObjectDetection
 #include "GroundFilter.h"
 #include "ObjectDetector.h"
 #include "MonoDetector.h"
+#include "SyntheticScene.h"
 
 using namespace cv;
 using namespace std;
@@ -42,18 +43,26 @@ class CameraObjectDetection{
         bool IS_MONO;                                        // 1 - use mono camera geometry
         int SAMPLE_RATE;                                  // downsample rate
         bool MONO_DETECTION;                    // 1- run mono detection algorithm
+        bool READ_FROM_SYNTHETIC;         // 1 - render frames from SyntheticScene instead of the camera
 
-        // Detection objects
+        // Synthetic source
+        float synthetic_pitch;                     // camera pitch (degree)
+        int synthetic_boxes;                        // obstacles per scene
+        float synthetic_speed;                   // forward motion per frame (m)
+
+        // Detection objects; of the camera models and lanes only the mono or
+        // the stereo one is built, the detection only to run the algorithm
         Motion abs_motion;
-        CameraModel t265;
-        MonoCameraModel mt265;
+        Ptr<CameraModel> t265;
+        Ptr<MonoCameraModel> mt265;
         RScamera rs_t265;
-        MonoLane mlane;
-        CameraLane lane;
-        Detection detector;
+        Ptr<MonoLane> mlane;
+        Ptr<CameraLane> lane;
+        Ptr<Detection> detector;
         Visualization vis;
         Transform cam_vehicle;
         MonoDetector md;
+        SyntheticScene scene;
 
         // Paths
         string PATH_STEREO_CALIBRATION;
@@ -97,6 +106,15 @@ class CameraObjectDetection{
         void RunAlgorithm(Mat left, Mat right);
 
 
+        /*Funciton Name: RunSynthetic()                                                                         */
+        /*Description: Run detection pipeline on rendered frames, which are
+                                  already rectified, and print the ground truth                */
+        /*Input: void                                                                                                               */
+        /*Output: void                                                                                                           */
+
+        void RunSynthetic();
+
+
         /*Funciton Name: PrintProcessingTime()                                                     */
         /*Description: Print processing time in the console                                 */
         /*Input: void                                                                                                               */        
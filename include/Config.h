@@ -0,0 +1,238 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        Config
+*****************************************************************/
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "ELAS/StereoEfficientLargeScale.h"
+
+using namespace std;
+using namespace cv;
+
+
+/*****************************************************************
+Structure Name: DetectionParams
+Description: pipeline selection of Detection
+*****************************************************************/
+
+struct DetectionParams{
+
+    bool FILTER_GROUND;                                      // 1 - filter ground
+    bool FILTER_BACKGROUND;                           // 1 - filter background
+    bool FILTER_LANE;                                              // 1- filter objects not on lane
+    int DISPARITY_TYPE;                                           // 0 - SGBM, 1- BM, 2 - ELAS
+    bool DISPARITY_SCHEDULER;                        // 1 - choose disparity mode per frame to meet the deadline
+    int DETECTOR_TYPE;                                          // 0 - Contour, 1 - UVdisparity
+    int GROUND_FILTER_TYPE;                              // 0 - Mono, 1 - Online
+    int ONLINE_GROUND_FILTER_TYPE;           // 0 - Hough, 1 - RANSAC, 2 - Peak
+    int NUM_OF_RANSAC_FILTERING;                // Iterations of RANSAC ground filtering
+    bool GROUND_PREDICTION;                          // 1 - predict online ground plane from pose
+    bool TRACKING;                                                 // 1 - track objects, detect only when due
+
+};
+
+
+/*****************************************************************
+Structure Name: DisparityParams
+Description: disparity engines and scheduler
+*****************************************************************/
+
+struct DisparityParams{
+
+    // Preprocessing
+    int pre_gaussian_kernel;
+    int pre_median_kernel;
+
+    // Matching
+    int max_disparity;
+    int window_size;
+    int prefilter_size;
+    int prefilter_cap;
+    int uniqueness_ratio;
+    int texture_threshold;
+
+    // SGBM: WLS filter
+    int wls_lambda;
+    int wls_sigma;
+
+    // BM: speckle filter
+    int speckle_window;
+    int speckle_range;
+
+    // ELAS: profile with overrides, range sigma of the half resolution upsampling
+    Elas::parameters elas;
+    float elas_upsample_sigma;
+
+    // Scheduler, modes as triples: type, downscale, max_disparity
+    float scheduler_deadline_ms;
+    float scheduler_upgrade_margin;
+    int scheduler_window;
+    int scheduler_probe_interval;
+    vector<int> scheduler_modes;
+
+};
+
+
+/*****************************************************************
+Structure Name: GroundParams
+Description: ground filters and ground prediction
+*****************************************************************/
+
+struct GroundParams{
+
+    int ground_tolerance;
+    int min_count;
+    int max_disparity;
+    int min_disparity;
+
+    // Hough
+    int hough_min_count;
+    int hough_min_length;
+    int hough_max_gap;
+
+    // RANSAC and peak fitting
+    int num_samples;
+    float distance_threshold;
+    int start_row;
+    int start_column;
+    int max_iteration;
+    int num_median_filter;
+    int ransac_seed;
+    float huber_delta;
+    int irls_iterations;
+
+    // Prediction from pose
+    int ground_max_age;
+    int ground_verify_step;
+    float ground_verify_tolerance;
+    float ground_verify_ratio;
+
+};
+
+
+/*****************************************************************
+Structure Name: DetectorParams
+Description: contour and stixel detectors
+*****************************************************************/
+
+struct DetectorParams{
+
+    // Depth slices without a lane
+    float min_depth;
+    float depth_step;
+    int num_of_waypoints;
+
+    // Contour
+    int DISPARITY_CALC_TYPE;                              // 0-median, 1-average, 2-max
+    int od_pre_median_kernel;
+    int median_kernel;
+    int canny_threshold;
+    int erode_kernel;
+    int dilate_kernel;
+
+    // Stixel
+    int stixel_width;
+    int stixel_min_count;
+    float stixel_smooth_penalty;
+    float stixel_jump_penalty;
+    float stixel_group_tolerance;
+    int stixel_min_group;
+    int stixel_max_gap;
+    int ground_tolerance;                                    // same key as the ground filters
+
+};
+
+
+/*****************************************************************
+Structure Name: ObjectFilterParams
+Description: NMS, confidence and size filters
+*****************************************************************/
+
+struct ObjectFilterParams{
+
+    float NMS_threshold;
+    float confidence_threshold;
+    float min_width;
+    float min_height;
+    float max_width;
+    float max_height;
+
+};
+
+
+/*****************************************************************
+Structure Name: TrackerParams
+Description: multi-object tracker
+*****************************************************************/
+
+struct TrackerParams{
+
+    int track_detect_interval;
+    float track_iou_threshold;
+    int track_max_misses;
+    int track_min_hits;
+    float track_process_noise;
+    float track_sigma_pixel;
+    float track_sigma_disparity;
+    float track_verify_confidence;
+    float track_verify_tolerance;
+
+};
+
+
+/*****************************************************************
+Class Name: DetectionConfig
+Description: detection configuration file parsed once into typed parameters,
+                         validated and shared by all components; missing keys keep
+                         0 as with FileStorage, optional keys keep their default
+*****************************************************************/
+
+class DetectionConfig{
+
+    private:
+
+        /*Funciton Name: Validate(string config)                                                            */
+        /*Description: report invalid values and replace them with usable ones */
+        /*Input: string config - path to configuration file, for the messages     */
+        /*Output: void                                                                                                               */
+
+        void Validate(string config);
+
+
+    public:
+
+        DetectionParams detection;
+        DisparityParams disparity;
+        GroundParams ground;
+        DetectorParams detector;
+        ObjectFilterParams filter;
+        TrackerParams tracker;
+
+
+        /*Funciton Name: DetectionConfig()                                                                    */
+        /*Description: Default constructor, all parameters at their default        */
+        /*Input: void                                                                                                               */
+
+        DetectionConfig();
+
+
+        /*Funciton Name: DetectionConfig(string config)                                               */
+        /*Description: Constructor from configuration file                                      */
+        /*Input: string config - path to configuration file                                          */
+
+        DetectionConfig(string config);
+
+
+        /*Funciton Name: Load(string config)                                                                  */
+        /*Description: configuration of a file, parsed on the first call only; the
+                                  reference stays valid for the whole run                          */
+        /*Input: string config - path to configuration file                                          */
+        /*Output: const DetectionConfig& configuration                                              */
+
+        static const DetectionConfig& Load(string config);
+
+};
@@ -16,11 +16,19 @@ Description:        Detection
 #include "ObjectFilter.h"
 #include "ObjectDetector.h"
 #include "MonoDetector.h"
+#include "Tracker.h"
+#include "DetectionFactory.h"
+#include "Pipeline.h"
 
 using namespace std;
 using namespace cv;
 
 
+class DetectionRunner;
+template<typename P> class PipelineRunner;
+
+
+
 /*****************************************************************
 Class Name: Detection
 Description: Create objects according to configuration and run detection
@@ -42,24 +50,22 @@ class Detection{
         CameraLane* lane;
         MonoLane* mlane;
 
-        // Disparity calculator
-        DisparitySGBM sgbm;
-        DisparityBM bm;
-        DisparityELAS elas;
+        // Components selected by the configuration, empty if not used; shared
+        // by copies of Detection
+        // Disparity, ground filter, object detector and object filter stages:
+        // only the pipeline selected by Initialize, the fixed production
+        // stages or the configurable ones
+        Ptr<DetectionRunner> runner;
 
-        // Ground filter
-        MonoGroundFilter mgf;
-        HoughGroundFilter hgf;
-        RANSACGroundFilter rgf;
+        // Ground prediction, held by the ground stage
+        Ptr<PredictedGroundFilter> pgf;
 
-        // Object detector
-        ContourDetector cd;
-        UVDisparityDetector uvd;
+        // Objct filter, chained in the filter stage
+        Ptr<NMSFilter> nmsf;
+        Ptr<ObjectFilter2D> lf;
 
-        // Objct filter
-        NMSFilter nmsf;
-        LaneFilter lf;
-        MonoLaneFilter mlf;
+        // Tracker
+        Ptr<Tracker> tracker;
         
         // Constants
         Mat Q;
@@ -72,26 +78,29 @@ class Detection{
         bool FILTER_BACKGROUND;                           // 1 - filter background
         bool FILTER_LANE;                                              // 1- filter objects not on lane  
         int DISPARITY_TYPE;                                           // 0 - SGBM, 1- BM, 2 - ELAS
+        bool DISPARITY_SCHEDULER;                        // 1 - choose disparity mode per frame to meet the deadline
         int DETECTOR_TYPE;                                          // 0 - Contour, 1 - UVdisparity
         int GROUND_FILTER_TYPE;                              // 0 - Mono, 1 - Online
-        int ONLINE_GROUND_FILTER_TYPE;           // 0 - Hough, 1 - RANSAC
+        int ONLINE_GROUND_FILTER_TYPE;           // 0 - Hough, 1 - RANSAC, 2 - Peak
         int NUM_OF_RANSAC_FILTERING;                // Iterations of RANSAC ground filtering
+        bool GROUND_PREDICTION;                          // 1 - predict online ground plane from pose
+        bool TRACKING;                                                 // 1 - track objects, detect only when due
 
 
-        /*Funciton Name: ReadParameters(string config)                                    */
-        /*Description: Read parameters from configuration file                        */
-        /*Input: string config - path to configuration file                                       */        
+        /*Funciton Name: ReadParameters(const DetectionConfig& params)        */
+        /*Description: Set control variables from parsed configuration          */
+        /*Input: const DetectionConfig& params - parsed configuration               */
         /*Output: void                                                                                                          */  
 
-        void ReadParameters(string config);
+        void ReadParameters(const DetectionConfig& params);
 
 
-        /*Funciton Name: Initialize(string config)                                                   */
-        /*Description: Initialize objects according to configuration                */
-        /*Input: string config - path to configuration file                                      */        
+        /*Funciton Name: Initialize(const DetectionConfig& params)                    */
+        /*Description: Build the objects selected by the configuration             */
+        /*Input: const DetectionConfig& params - parsed configuration              */
         /*Output: void                                                                                                          */
 
-        void Initialize(string config);
+        void Initialize(const DetectionConfig& params);
 
 
         /*Funciton Name: UpdateMinDisparity()												        */
@@ -100,6 +109,19 @@ class Detection{
         /*Output: void                                                                                                           */     
 
         void inline UpdateMinDisparity();
+
+
+        /*Funciton Name: UpdateFrame(P& pipeline, Mat left, Mat right)            */
+        /*Description: Detect 2D objects from rectified image pair with the
+                                  selected pipeline                                                                        */
+        /*Input: P& pipeline - ProductionPipeline or RuntimePipeline
+                        Mat left - left rectified image
+                        Mat right - right rectified image                                                       */
+        /*Output: void                                                                                                          */
+
+        template<typename P> void UpdateFrame(P& pipeline, Mat left, Mat right);
+
+        template<typename P> friend class PipelineRunner;
     
 
     public:
@@ -136,6 +158,58 @@ class Detection{
         void Update2D(Mat left, Mat right);
 
 
+        /*Funciton Name: SetPoseSource(float* cam_height, float* cam_theta)        */
+        /*Description: set the pose used to predict the online ground plane    */
+        /*Input: float* cam_height - camera height (m)
+                        float* cam_theta - camera pitch (degree)                                            */
+        /*Output: void                                                                                                          */
+
+        void SetPoseSource(float* cam_height, float* cam_theta);
+
+
+        /*Funciton Name: GroundSkipRatio()                                                                */
+        /*Description: fraction of frames with predicted ground plane              */
+        /*Input: void                                                                                                               */
+        /*Output: float ratio                                                                                                   */
+
+        float GroundSkipRatio();
+
+
+        /*Funciton Name: GroundEstimationTime()                                                   */
+        /*Description: ground estimation and filtering time of the last frame (ms) */
+        /*Input: void                                                                                                               */
+        /*Output: double time                                                                                                 */
+
+        double GroundEstimationTime();
+
+
+        /*Funciton Name: SetEgoSource(Motion* ego)                                                      */
+        /*Description: set the ego-motion used to predict the tracks                    */
+        /*Input: Motion* ego - pointer to the absolute motion                                  */
+        /*Output: void                                                                                                          */
+
+        void SetEgoSource(Motion* ego);
+
+
+        /*Funciton Name: TrackIDs()                                                                                 */
+        /*Description: track ID of every object of the 2D list, empty without
+                                  tracking                                                                                                */
+        /*Input: void                                                                                                               */
+        /*Output: vector<int> ids                                                                                             */
+
+        vector<int> TrackIDs();
+
+
+        /*Funciton Name: DetectionDutyCycle(), TrackTime()                                    */
+        /*Description: fraction of frames with full detection, tracking time of
+                                  the last frame (ms)                                                                        */
+        /*Input: void                                                                                                               */
+        /*Output: float ratio, double time                                                                          */
+
+        float DetectionDutyCycle();
+        double TrackTime();
+
+
         /*Funciton Name: Update3D()                                                                          */
         /*Description: Project 2D objects to 3D											               */
         /*Input: void																				                              */        
@@ -193,3 +267,66 @@ class Detection{
 
 };
 
+
+
+/*****************************************************************
+Class Name: DetectionRunner
+Description: pipeline selected by Detection::Initialize, one virtual call
+                         per frame
+*****************************************************************/
+
+class DetectionRunner{
+
+    public:
+
+        virtual ~DetectionRunner(){}
+
+
+        /*Funciton Name: Update2D(Detection& detection, Mat left, Mat right)   */
+        /*Description: Detect 2D objects from rectified image pair                 */
+        /*Input: Detection& detection - detection holding the runner
+                        Mat left - left rectified image
+                        Mat right - right rectified image                                                       */
+        /*Output: void                                                                                                          */
+
+        virtual void Update2D(Detection& detection, Mat left, Mat right) = 0;
+
+};
+
+
+
+/*****************************************************************
+Class Name: PipelineRunner
+Description: runner of a ProductionPipeline or a RuntimePipeline
+*****************************************************************/
+
+template<typename P>
+class PipelineRunner: public DetectionRunner{
+
+    private:
+
+        P pipeline;
+
+    public:
+
+        /*Funciton Name: PipelineRunner(const P& pipeline)                                  */
+        /*Description: constructor from the selected pipeline                          */
+        /*Input: const P& pipeline - ProductionPipeline or RuntimePipeline      */
+
+        PipelineRunner(const P& pipeline): pipeline(pipeline){}
+
+
+        /*Funciton Name: Update2D(Detection& detection, Mat left, Mat right)   */
+        /*Description: Detect 2D objects from rectified image pair                 */
+        /*Input: Detection& detection - detection holding the runner
+                        Mat left - left rectified image
+                        Mat right - right rectified image                                                       */
+        /*Output: void                                                                                                          */
+
+        void Update2D(Detection& detection, Mat left, Mat right){
+
+            detection.UpdateFrame(pipeline, left, right);
+
+        }
+
+};
@@ -0,0 +1,128 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        DetectionFactory
+*****************************************************************/
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "Config.h"
+#include "Lane.h"
+#include "CameraModel.h"
+#include "Disparity.h"
+#include "GroundFilter.h"
+#include "ObjectFilter.h"
+#include "ObjectDetector.h"
+#include "Tracker.h"
+
+using namespace std;
+using namespace cv;
+
+
+/*****************************************************************
+Class Name: DetectionFactory
+Description: Build the components of Detection selected by the configuration,
+                         an empty pointer for every component that is not used
+*****************************************************************/
+
+class DetectionFactory{
+
+    public:
+
+        /*Funciton Name: CreateDisparity(const DetectionConfig& params)               */
+        /*Description: disparity engine of DISPARITY_TYPE, none with the scheduler */
+        /*Input: const DetectionConfig& params - parsed configuration                */
+        /*Output: Ptr<Disparity> engine                                                                           */
+
+        static Ptr<Disparity> CreateDisparity(const DetectionConfig& params);
+
+
+        /*Funciton Name: CreateScheduler(const DetectionConfig& params)              */
+        /*Description: disparity scheduler if DISPARITY_SCHEDULER                      */
+        /*Input: const DetectionConfig& params - parsed configuration                */
+        /*Output: Ptr<DisparityScheduler> scheduler                                                     */
+
+        static Ptr<DisparityScheduler> CreateScheduler(const DetectionConfig& params);
+
+
+        /*Funciton Name: CreateMonoGroundFilter(const DetectionConfig& params, MonoCameraModel* mcm) */
+        /*Description: mono ground filter if FILTER_GROUND, GROUND_FILTER_TYPE 0 and
+                                  a mono camera                                                                                                    */
+        /*Input: const DetectionConfig& params - parsed configuration
+                        MonoCameraModel* mcm - pointer to a MonoCameraModel, NULL for stereo               */
+        /*Output: Ptr<MonoGroundFilter> filter                                                                                       */
+
+        static Ptr<MonoGroundFilter> CreateMonoGroundFilter(const DetectionConfig& params, MonoCameraModel* mcm);
+
+
+        /*Funciton Name: CreateOnlineGroundFilter(const DetectionConfig& params, bool mono) */
+        /*Description: online ground filter of ONLINE_GROUND_FILTER_TYPE if FILTER_GROUND,
+                                  always for stereo and with GROUND_FILTER_TYPE 1 for mono; RANSAC
+                                  needs NUM_OF_RANSAC_FILTERING > 0                                                         */
+        /*Input: const DetectionConfig& params - parsed configuration
+                        bool mono - mono camera                                                                                                */
+        /*Output: Ptr<OnlineGroundFilter> filter                                                                                     */
+
+        static Ptr<OnlineGroundFilter> CreateOnlineGroundFilter(const DetectionConfig& params, bool mono);
+
+
+        /*Funciton Name: CreatePredictedGroundFilter(const DetectionConfig& params, CameraModel* cm) */
+        /*Description: ground prediction if FILTER_GROUND and GROUND_PREDICTION     */
+        /*Input: const DetectionConfig& params - parsed configuration
+                        CameraModel* cm - pointer to a CameraModel                                                  */
+        /*Output: Ptr<PredictedGroundFilter> filter                                                                  */
+
+        static Ptr<PredictedGroundFilter> CreatePredictedGroundFilter(const DetectionConfig& params, CameraModel* cm);
+
+
+        /*Funciton Name: CreateDetector(const DetectionConfig& params, CameraModel* cm, Lane* lane) */
+        /*Description: object detector of DETECTOR_TYPE                                                               */
+        /*Input: const DetectionConfig& params - parsed configuration
+                        CameraModel* cm - pointer to a CameraModel
+                        Lane* lane - pointer to a Lane                                                                                    */
+        /*Output: Ptr<ObjectDetector> detector                                                                             */
+
+        static Ptr<ObjectDetector> CreateDetector(const DetectionConfig& params, CameraModel* cm, Lane* lane);
+
+
+        /*Funciton Name: CreateNMSFilter(const DetectionConfig& params)               */
+        /*Description: NMS over the detected list, the contour detector only        */
+        /*Input: const DetectionConfig& params - parsed configuration                */
+        /*Output: Ptr<NMSFilter> filter                                                                                */
+
+        static Ptr<NMSFilter> CreateNMSFilter(const DetectionConfig& params);
+
+
+        /*Funciton Name: CreateLaneFilter(const DetectionConfig& params, CameraLane* lane, MonoLane* mlane) */
+        /*Description: lane filter of the lane model if FILTER_LANE                                                      */
+        /*Input: const DetectionConfig& params - parsed configuration
+                        CameraLane* lane - pointer to lane model, NULL for mono
+                        MonoLane* mlane - pointer to monolane model, NULL for stereo                               */
+        /*Output: Ptr<ObjectFilter2D> filter                                                                                                */
+
+        static Ptr<ObjectFilter2D> CreateLaneFilter(const DetectionConfig& params, CameraLane* lane, MonoLane* mlane);
+
+
+        /*Funciton Name: CreateTracker(const DetectionConfig& params, Mat Q, int offset_x, int offset_y) */
+        /*Description: multi-object tracker if TRACKING                                                                   */
+        /*Input: const DetectionConfig& params - parsed configuration
+                        Mat Q - reprojection matrix
+                        int offset_x, int offset_y - offset of the disparity map in the image                     */
+        /*Output: Ptr<Tracker> tracker                                                                                                   */
+
+        static Ptr<Tracker> CreateTracker(const DetectionConfig& params, Mat Q, int offset_x, int offset_y);
+
+
+        /*Funciton Name: IsProduction(const DetectionConfig& params, bool mono)     */
+        /*Description: whether the configuration selects exactly the components of
+                                  ProductionPipeline: SGBM without scheduler, RANSAC ground
+                                  without prediction, contour detector and NMS only         */
+        /*Input: const DetectionConfig& params - parsed configuration
+                        bool mono - mono camera                                                                       */
+        /*Output: bool result - 1: production configuration                                      */
+
+        static bool IsProduction(const DetectionConfig& params, bool mono);
+
+};
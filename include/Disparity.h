@@ -10,6 +10,7 @@ Description:        Disparity
 #include <opencv2/ximgproc/disparity_filter.hpp>
 
 #include "CameraModel.h"
+#include "Config.h"
 #include "Utility.h"
 #include "ELAS/StereoEfficientLargeScale.h"
 
@@ -74,6 +75,32 @@ class Disparity{
         Disparity(string config);
 
 
+        /*Funciton Name: Disparity(const DisparityParams& params)                          */
+        /*Description: Constructor from parsed configuration                                */
+        /*Input: const DisparityParams& params - disparity parameters                  */
+
+        Disparity(const DisparityParams& params);
+
+
+        virtual ~Disparity(){}
+
+
+        /*Funciton Name: LevelsPerPixel()                                                               */
+        /*Description: output levels per pixel of disparity                                 */
+        /*Input: void                                                                                                                 */    
+        /*Output: float levels                                                                                                  */  
+
+        virtual float LevelsPerPixel();
+
+
+        /*Funciton Name: SetMaxDisparity(int max_disparity)                          */
+        /*Description: change the disparity range and re-initialize matchers */
+        /*Input: int max_disparity - number of disparities                                  */    
+        /*Output: void                                                                                                            */  
+
+        void SetMaxDisparity(int max_disparity);
+
+
          /*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)               */
         /*Description: virtual function to calculate disparity map                     */
         /*Input: Mat img_l - left image
@@ -128,6 +155,13 @@ class DisparitySGBM: public Disparity{
         DisparitySGBM(string config);
 
 
+        /*Funciton Name: DisparitySGBM(const DisparityParams& params)                */
+        /*Description: Constructor from parsed configuration                                */
+        /*Input: const DisparityParams& params - disparity parameters                  */
+
+        DisparitySGBM(const DisparityParams& params);
+
+
         /*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
         /*Description: calculate disparity map                                                             */
         /*Input: Mat img_l - left image
@@ -179,6 +213,13 @@ class DisparityBM: public Disparity{
         DisparityBM(string config);
 
 
+        /*Funciton Name: DisparityBM(const DisparityParams& params)                     */
+        /*Description: Constructor from parsed configuration                                */
+        /*Input: const DisparityParams& params - disparity parameters                  */
+
+        DisparityBM(const DisparityParams& params);
+
+
         /*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
         /*Description: calculate disparity map                                                             */
         /*Input: Mat img_l - left image
@@ -203,6 +244,12 @@ class DisparityELAS:public Disparity{
         // Matcher
         StereoEfficientLargeScale disp_elas;
 
+        // ELAS parameter: profile (ROBOTICS/MIDDLEBURY) plus overrides from configuration
+        Elas::parameters elas_param;
+
+        // Half resolution mode: range sigma of the edge-aware upsampling
+        float upsample_sigma;
+
         /*Funciton Name: InitMatcher()                                                                          */
         /*Description: initialize matchers                                                                       */
         /*Input: void                                                                                                                */    
@@ -211,6 +258,17 @@ class DisparityELAS:public Disparity{
         void InitMatcher();
 
 
+        /*Funciton Name: UpsampleDispMap(Mat& disp_half, Mat& guide, Mat& disp_full)   */
+        /*Description: joint bilateral upsampling of a subsampled disparity map, 
+                                 guided by the full resolution image                                         */
+        /*Input: Mat& disp_half - disparity of every 2nd pixel (CV_8U)
+                        Mat& guide - full resolution left image (CV_8U)
+                        Mat& disp_full - full resolution disparity (CV_8U)                      */    
+        /*Output: void                                                                                                            */  
+
+        void UpsampleDispMap(Mat& disp_half, Mat& guide, Mat& disp_full);
+
+
     public:
 
         /*Funciton Name: DisparityELAS()                                                                     */
@@ -227,6 +285,21 @@ class DisparityELAS:public Disparity{
         DisparityELAS(string config);
 
 
+        /*Funciton Name: DisparityELAS(const DisparityParams& params)                  */
+        /*Description: Constructor from parsed configuration                                */
+        /*Input: const DisparityParams& params - disparity parameters                  */
+
+        DisparityELAS(const DisparityParams& params);
+
+
+        /*Funciton Name: LevelsPerPixel()                                                               */
+        /*Description: ELAS output is scaled by 2 (former CV_16S(x16)/8)         */
+        /*Input: void                                                                                                                 */    
+        /*Output: float levels                                                                                                  */  
+
+        float LevelsPerPixel();
+
+
         /*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
         /*Description: calculate disparity map                                                             */
         /*Input: Mat img_l - left image
@@ -235,4 +308,132 @@ class DisparityELAS:public Disparity{
         
         Mat CalculateDispMap(Mat img_l, Mat img_r);
 
-};
\ No newline at end of file
+};
+
+
+
+/*****************************************************************
+Class Name: DisparityScheduler
+Description: Pick disparity engine, resolution and disparity range 
+                         per frame to meet an end-to-end deadline
+*****************************************************************/
+
+class DisparityScheduler{
+
+    private:
+
+        // One schedulable configuration, ordered by preference in the config
+        struct Mode{
+            int type;                                             // 0 - SGBM, 1- BM, 2 - ELAS
+            int downscale;                                  // 1 - full, 2 - half resolution
+            int max_disparity;                          // disparity range at full resolution
+            Ptr<Disparity> matcher;
+            vector<float> latency;                  // rolling window of disparity latencies [ms]
+            int next;                                             // next slot of the rolling window
+            int last_frame;                                 // frame of the last measurement, -1 before
+        };
+
+        vector<Mode> modes;
+        int current;                                              // mode of the last frame, -1 before the first
+
+        // Deadline
+        float deadline_ms;                                 // end-to-end budget of one frame
+        float upgrade_margin;                          // a better mode needs predicted latency < margin*budget
+        int window;                                               // size of the rolling latency windows
+        int probe_interval;                                // frames before a stale better mode is measured again
+        float rest_ms;                                          // smoothed latency of everything after disparity
+        float last_disp_ms;
+
+        // Statistics
+        int frames;
+        int switches;
+
+
+        /*Funciton Name: PredictLatency(const Mode& mode)                          */
+        /*Description: mean + one standard deviation of the rolling window */
+        /*Input: const Mode& mode - mode to predict                                          */    
+        /*Output: float latency [ms], 0 if the mode has not been measured  */  
+
+        float PredictLatency(const Mode& mode);
+
+
+        /*Funciton Name: ModeName(int i)                                                              */
+        /*Description: readable name of a mode for logging                            */
+        /*Input: int i - index of mode                                                                        */    
+        /*Output: string name                                                                                                 */  
+
+        string ModeName(int i);
+
+
+        /*Funciton Name: ProbeMode(int choice)                                                    */
+        /*Description: mode to measure instead of the choice: every probe_interval
+                                  frames the best mode not measured for probe_interval
+                                  frames, so that a latency spike does not lock it out     */
+        /*Input: int choice - mode chosen from the predictions                         */
+        /*Output: int mode, choice if there is nothing to probe                            */
+
+        int ProbeMode(int choice);
+
+
+    public:
+
+        /*Funciton Name: DisparityScheduler()                                                    */
+        /*Description: Default constructor                                                                     */
+        /*Input: void                                                                                                                 */  
+
+        DisparityScheduler();
+
+
+        /*Funciton Name: DisparityScheduler(string config)                            */
+        /*Description: Constructor from configuration file                                     */
+        /*Input: string config - configurateion file                                                       */   
+
+        DisparityScheduler(string config);
+
+
+        /*Funciton Name: DisparityScheduler(const DisparityParams& params)         */
+        /*Description: Constructor from parsed configuration                                */
+        /*Input: const DisparityParams& params - disparity parameters                  */
+
+        DisparityScheduler(const DisparityParams& params);
+
+
+        /*Funciton Name: AddMode(string config, int type, int downscale, int max_disparity)   */
+        /*Description: append a mode with lower preference than the existing ones  */
+        /*Input: string config - configuration file of the matcher, or
+                        const DisparityParams& params - parameters of the matcher
+                        int type - 0 - SGBM, 1- BM, 2 - ELAS
+                        int downscale - 1 - full, 2 - half resolution
+                        int max_disparity - disparity range at full resolution                  */    
+        /*Output: void                                                                                                            */  
+
+        void AddMode(string config, int type, int downscale, int max_disparity);
+        void AddMode(const DisparityParams& params, int type, int downscale, int max_disparity);
+
+
+        /*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
+        /*Description: choose a mode for this frame and calculate the 
+                                 full resolution disparity map (1 level per pixel)               */
+        /*Input: Mat img_l - left image
+                            Mat img_r - right image                                                                         */    
+        /*Output: Mat disparity                                                                                             */  
+
+        Mat CalculateDispMap(Mat img_l, Mat img_r);
+
+
+        /*Funciton Name: UpdateFrameTime(float frame_ms)                              */
+        /*Description: report the end-to-end latency of the last frame            */
+        /*Input: float frame_ms - latency of the whole frame [ms]                    */    
+        /*Output: void                                                                                                            */  
+
+        void UpdateFrameTime(float frame_ms);
+
+
+        /*Funciton Name: Switches()                                                                           */
+        /*Description: number of mode switches so far                                        */
+        /*Input: void                                                                                                                 */    
+        /*Output: int switches                                                                                                 */  
+
+        int Switches();
+
+};
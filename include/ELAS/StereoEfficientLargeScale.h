@@ -50,6 +50,13 @@ public:
 		bool    subsampling;            // saves time by only computing disparities for each 2nd pixel
 		// note: for this option D1 and D2 must be passed with size
 		//       width/2 x height/2 (rounded towards zero)
+		bool    temporal_support;       // re-use the previous frame's support points and only recheck them locally
+		int32_t temporal_search_radius; // disparity search radius around a previous support point
+		int32_t temporal_tile_size;     // tile size (in candidate grid cells) for the full search fallback
+		float   temporal_min_confirmed; // min. fraction of confirmed support points before a tile is searched fully
+		int32_t temporal_refresh;       // force a full support search after this many incremental frames
+		int32_t temporal_empty_interval;// frames between full searches of a tile without previous support points
+		int32_t temporal_new_stride;    // grid stride of the full search of unconfirmed cells in a confirmed tile
 
 		// constructor
 		parameters (setting s=ROBOTICS) {
@@ -81,6 +88,13 @@ public:
 				filter_adaptive_mean  = 1;
 				postprocess_only_left = 1;
 				subsampling           = 0;
+				temporal_support       = 0;
+				temporal_search_radius = 3;
+				temporal_tile_size     = 8;
+				temporal_min_confirmed = 0.6f;
+				temporal_refresh       = 15;
+				temporal_empty_interval = 5;
+				temporal_new_stride    = 2;
 
 				// default settings for middlebury benchmark
 				// (interpolate all missing disparities)
@@ -108,13 +122,20 @@ public:
 				filter_adaptive_mean  = 0;
 				postprocess_only_left = 0;
 				subsampling           = 0;
+				temporal_support       = 0;
+				temporal_search_radius = 3;
+				temporal_tile_size     = 8;
+				temporal_min_confirmed = 0.6f;
+				temporal_refresh       = 15;
+				temporal_empty_interval = 5;
+				temporal_new_stride    = 2;
 			}
 		}
 	};
 
 	// constructor, input: parameters  
-	Elas (parameters param) : param(param) {}
-	Elas () :param(MIDDLEBURY){}
+	Elas (parameters param) : param(param),D_can_prev_width(0),D_can_prev_height(0),support_frames_since_full(0) {}
+	Elas () :param(MIDDLEBURY),D_can_prev_width(0),D_can_prev_height(0),support_frames_since_full(0){}
 	/*void init(parameters parameter)
 	{
 	param(parameter);
@@ -129,10 +150,22 @@ public:
 	//         dims[0] = width of I1 and I2
 	//         dims[1] = height of I1 and I2
 	//         dims[2] = bytes per line (often equal to width, but allowed to differ)
+	//         note: I1 and I2 are read in place, no copy is made
 	//         note: D1 and D2 must be allocated before (bytes per line = width)
 	//               if subsampling is not active their size is width x height,
 	//               otherwise width/2 x height/2 (rounded towards zero)
 	void process (uint8_t* I1,uint8_t* I2,float* D1,float* D2,const int32_t* dims);
+
+	// matching function with direct 8 bit output of the left disparity
+	// inputs: I1, I2 and dims as above
+	//         pointer to left disparity image D1 (uint8, output) with D1_bpl bytes per line,
+	//         receives disparity*scale saturated to [0,255] (invalid pixels are 0)
+	//         border = replicated columns on each side of I1 and I2, which then
+	//         hold dims[0]-2*border columns; the replicated columns are read by
+	//         clamped indexing and left out of D1 (even if subsampling is active)
+	//         note: the right disparity is only used for the L/R consistency check
+	//               and is never postprocessed, whatever postprocess_only_left says
+	void process (uint8_t* I1,uint8_t* I2,uint8_t* D1,int32_t D1_bpl,float scale,const int32_t* dims,int32_t border=0);
 	// parameter set
 	parameters param;
 
@@ -167,12 +200,14 @@ private:
 		int32_t redun_max_dist, int32_t redun_threshold, bool vertical);
 	void addCornerSupportPoints (std::vector<support_pt> &p_support);
 	inline int16_t computeMatchingDisparity (const int32_t &u,const int32_t &v,uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image);
+	inline int16_t computeLocalMatchingDisparity (const int32_t &u,const int32_t &v,const int32_t &d_pred,
+		uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image);
 	std::vector<support_pt> computeSupportMatches (uint8_t* I1_desc,uint8_t* I2_desc);
 
 	// triangulation & grid
-	std::vector<triangle> computeDelaunayTriangulation (std::vector<support_pt> p_support,int32_t right_image);
-	void computeDisparityPlanes (std::vector<support_pt> p_support,std::vector<triangle> &tri,int32_t right_image);
-	void createGrid (std::vector<support_pt> p_support,int32_t* disparity_grid,int32_t* grid_dims,bool right_image);
+	std::vector<triangle> computeDelaunayTriangulation (const std::vector<support_pt> &p_support,int32_t right_image);
+	void computeDisparityPlanes (const std::vector<support_pt> &p_support,std::vector<triangle> &tri,int32_t right_image);
+	void createGrid (const std::vector<support_pt> &p_support,int32_t* disparity_grid,int32_t* grid_dims,bool right_image);
 
 	// matching
 	inline void updatePosteriorMinimum (__m128i* I2_block_addr,const int32_t &d,const int32_t &w,
@@ -182,9 +217,13 @@ private:
 	inline void findMatch (int32_t &u,int32_t &v,float &plane_a,float &plane_b,float &plane_c,
 		int32_t* disparity_grid,int32_t *grid_dims,uint8_t* I1_desc,uint8_t* I2_desc,
 		int32_t *P,int32_t &plane_radius,bool &valid,bool &right_image,float* D);
-	void computeDisparity (std::vector<support_pt> p_support,std::vector<triangle> tri,int32_t* disparity_grid,int32_t* grid_dims,
+	void computeDisparity (const std::vector<support_pt> &p_support,const std::vector<triangle> &tri,int32_t* disparity_grid,int32_t* grid_dims,
 		uint8_t* I1_desc,uint8_t* I2_desc,bool right_image,float* D);
 
+	// full matching pipeline behind both process() variants, border replicated
+	// columns on each side of I1 and I2
+	void match (uint8_t* I1,uint8_t* I2,float* D1,float* D2,const int32_t* dims,bool postprocess_right,int32_t border);
+
 	// L/R consistency check
 	void leftRightConsistencyCheck (float* D1,float* D2);
 
@@ -196,7 +235,16 @@ private:
 	void adaptiveMean (float* D);
 	void median (float* D);
 
-	// memory aligned input images + dimensions
+	// support point candidates of the previous frame (temporal_support)
+	std::vector<int16_t> D_can_prev;
+	int32_t D_can_prev_width,D_can_prev_height;
+	int32_t support_frames_since_full;
+	std::vector<int32_t> tile_frames_since_search; // per tile, incremental frames since its last full search
+
+	// float disparity buffers of the 8 bit process(), reused across frames
+	std::vector<float> D1_buf,D2_buf;
+
+	// input images (bytes per line bpl) + dimensions
 	uint8_t *I1,*I2;
 	int32_t width,height,bpl;
 };
@@ -209,11 +257,17 @@ protected:
 
 	int minDisparity;
 	int disparityRange;
+
 public:
 	Elas elas;
 	StereoEfficientLargeScale();
 	StereoEfficientLargeScale(int mindis, int dispRange);
 	void operator()(cv::Mat& leftim, cv::Mat& rightim, cv::Mat& leftdisp, cv::Mat& rightdisp, int border);
 	void operator()(cv::Mat& leftim, cv::Mat& rightim, cv::Mat& leftdisp, int border);
+	// direct path: the images are matched in place with border replicated
+	// columns on each side (as operator()), read by clamped indexing, and the
+	// left disparity is written as CV_8U disparity*scale into leftdisp without
+	// the padding
+	void compute(const cv::Mat& leftim, const cv::Mat& rightim, cv::Mat& leftdisp, float scale=1.f, int border=0);
 //	void StereoEfficientLargeScale::check(Mat& leftim, Mat& rightim, Mat& disp, StereoEval& eval);
 };
\ No newline at end of file
@@ -46,7 +46,9 @@ class Descriptor {
 public:
   
   // constructor creates filters
-  Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution);
+  // I holds width-2*border columns with bpl bytes per line, the descriptor
+  // covers width columns with border replicated columns on each side
+  Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution,int32_t border=0);
   
   // deconstructor releases memory
   ~Descriptor();
@@ -56,8 +58,19 @@ public:
   
 private:
 
-  // build descriptor I_desc from I_du and I_dv
-  void createDescriptor(uint8_t* I_du,uint8_t* I_dv,int32_t width,int32_t height,int32_t bpl,bool half_resolution);
+  // build descriptor I_desc from I in a single streaming pass: the 3x3 sobel
+  // responses (du,dv) are computed row by row into a 5-line ring buffer which
+  // stays in L1/L2 cache and is consumed immediately by the descriptor rows
+  void createDescriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution,int32_t border);
+
+  // compute sobel responses du (horizontal) and dv (vertical) of image row v,
+  // same rounding and saturation as filter::sobel3x3; columns within one
+  // pixel of the border read the replicated columns by clamped indexing
+  void sobelRow(const uint8_t* I,uint8_t* du,uint8_t* dv,int32_t v,int32_t width,int32_t bpl,int32_t border);
+
+  // gather the 16-byte descriptors of one image row from the 5 sobel lines
+  // centered on this row (du_rows[2]/dv_rows[2] is the center line)
+  void descriptorRow(uint8_t** du_rows,uint8_t** dv_rows,uint8_t* I_desc_line,int32_t width);
 
 };
 
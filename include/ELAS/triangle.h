@@ -281,5 +281,6 @@ struct triangulateio {
 };
 
 void triangulate(char *,triangulateio *,triangulateio *,triangulateio *);
+void triangulaterelease();
 void trifree(int *memptr);
 
@@ -6,9 +6,11 @@ Description:        GroundFilter
 
 #pragma once
 
+#include <climits>
 #include <opencv2/opencv.hpp>
 
 #include "CameraModel.h"
+#include "Config.h"
 
 using namespace std;
 using namespace cv;
@@ -30,6 +32,9 @@ class GroundFilter{
         GroundFilter();
 
 
+        virtual ~GroundFilter(){}
+
+
         /*Funciton Name:FilterGround(Mat& disparity)                                                    */                            
         /*Description: virtual function to filter ground                                                      */
         /*Input: Mat& disparity - disparity map                                                                    */    
@@ -44,7 +49,7 @@ class GroundFilter{
                         int min_disparity - minimal disparity                                                        */    
         /*Output: void                                                                                                                       */
 
-        void FilterBackground(Mat& disparity, int min_disparity);
+        static void FilterBackground(Mat& disparity, int min_disparity);
 
 };
 
@@ -62,6 +67,30 @@ class VDisparityGroundFilter: public GroundFilter{
         float ground_b;
         int ground_tolerance;
 
+        // Per-row disparity threshold of the ground line
+        vector<int> row_threshold;
+
+
+        /*Funciton Name: UpdateRowThreshold(int rows)                                               */
+        /*Description: update row_threshold from ground_k, ground_b and
+                                  ground_tolerance                                                                             */
+        /*Input: int rows - number of rows                                                                          */
+        /*Output: void                                                                                                                      */
+
+        void UpdateRowThreshold(int rows);
+
+
+        /*Funciton Name: FilterRow(uchar* row, int cols, int r, int min_disparity)     */
+        /*Description: zero ground pixels of row r and pixels below min_disparity,
+                                  row_threshold must be up to date                                                      */
+        /*Input: uchar* row - pointer to the row
+                        int cols - number of columns
+                        int r - row index
+                        int min_disparity - minimal disparity kept                                                  */
+        /*Output: void                                                                                                                      */
+
+        void FilterRow(uchar* row, int cols, int r, int min_disparity);
+
     public:
 
         /*Funciton Name: VDisparityGroundFilter()                                          		   */
@@ -71,13 +100,39 @@ class VDisparityGroundFilter: public GroundFilter{
         VDisparityGroundFilter();
 
 
+        /*Funciton Name: GroundK(), GroundB()                                                              */
+        /*Description: current ground line, row = k * disparity + b                     */
+        /*Input: void                                                                                                                      */
+        /*Output: float ground_k, float ground_b                                                                  */
+
+        float GroundK();
+        float GroundB();
+
+
+        /*Funciton Name: SetGroundPlane(float k, float b)                                              */
+        /*Description: set the ground line, e.g. from a prediction                         */
+        /*Input: float k, float b - ground line, row = k * disparity + b              */
+        /*Output: void                                                                                                                      */
+
+        void SetGroundPlane(float k, float b);
+
+
         /*Funciton Name:FilterGround(Mat& disparity)                                             */                            
-        /*Description: virtual function to filter ground                                                */
-        /*Input: Mat& disparity - disparity map                                                               */    
+        /*Description: filter ground, row-parallel with a threshold per row       */
+        /*Input: Mat& disparity - disparity map (CV_8UC1)                                    */    
         /*Output: void                                                                                                                 */        
 
         void FilterGround(Mat& disparity);
 
+
+        /*Funciton Name:FilterGround(Mat& disparity, int min_disparity)                 */                            
+        /*Description: filter ground and background in one pass                             */
+        /*Input: Mat& disparity - disparity map (CV_8UC1)
+                        int min_disparity - minimal disparity kept                                              */    
+        /*Output: void                                                                                                                 */
+
+        void FilterGround(Mat& disparity, int min_disparity);
+
 };
 
 
@@ -111,6 +166,14 @@ class MonoGroundFilter: public VDisparityGroundFilter{
         MonoGroundFilter(MonoCameraModel* mcm, string config);
 
 
+        /*Funciton Name: MonoGroundFilter(MonoCameraModel* mcm, const GroundParams& params) */
+        /*Description: constructor from parsed configuration                                 */
+        /*Input: MonoCameraModel* mcm - pointer to a MonoCameraModel
+                        const GroundParams& params - ground parameters                                   */
+
+        MonoGroundFilter(MonoCameraModel* mcm, const GroundParams& params);
+
+
         /*Funciton Name:UpdateGroundPlane()                                                            */                            
         /*Description: upadate ground_k and ground_b                                             */
         /*Input: void                                                                                                                     */    
@@ -122,6 +185,178 @@ class MonoGroundFilter: public VDisparityGroundFilter{
 
 
 
+/*****************************************************************
+Class Name: UVDisparityHistogram
+Description: U- and V-disparity histograms with 16-bit bins, computed in
+                         one pass over a trapezoid area, row stripes in parallel
+                         with partial U histograms; buffers are reused and the
+                         thresholded views are produced on request
+*****************************************************************/
+
+class UVDisparityHistogram{
+
+    private:
+
+        int min_disparity;
+        int max_disparity;
+
+        // Counts (CV_16U), U: max_disparity x cols, V: rows x max_disparity
+        Mat u_hist;
+        Mat v_hist;
+        vector<Mat> u_partial;
+        bool has_u;
+        bool has_v;
+
+        // Thresholded views (CV_8U, 0/255)
+        Mat u_view;
+        Mat v_view;
+        int u_view_count;
+        int v_view_count;
+
+
+    public:
+
+        /*Funciton Name: UVDisparityHistogram()                                                          */
+        /*Description: Default constructor                                                                            */
+        /*Input: void                                                                                                                      */
+
+        UVDisparityHistogram();
+
+
+        /*Funciton Name: UVDisparityHistogram(int min_disparity, int max_disparity) */
+        /*Description: Constructor with the counted range,
+                                  min_disparity < pixel < max_disparity                                  */
+        /*Input: int min_disparity - minimal disparity (excluded)
+                        int max_disparity - number of disparity bins                                     */
+
+        UVDisparityHistogram(int min_disparity, int max_disparity);
+
+
+        /*Funciton Name: SetRange(int min_disparity, int max_disparity)                */
+        /*Description: change the counted range                                                             */
+        /*Input: int min_disparity - minimal disparity (excluded)
+                        int max_disparity - number of disparity bins                                     */
+        /*Output: void                                                                                                                     */
+
+        void SetRange(int min_disparity, int max_disparity);
+
+
+        /*Funciton Name: Compute(const Mat& disparity, bool u, bool v, int start_row, int start_column) */
+        /*Description: count disparities of a trapezoid area from (start_row, start_column),
+                                  both histograms in the same pass                                                                           */
+        /*Input: const Mat& disparity - disparity map (CV_8UC1)
+                        bool u - calculate u-disparity
+                        bool v - calculate v-disparity
+                        int start_row - row of the top-left point
+                        int start_column - column of the top-left point                                                                */
+        /*Output: void                                                                                                                                                       */
+
+        void Compute(const Mat& disparity, bool u, bool v, int start_row=0, int start_column=0);
+
+
+        /*Funciton Name: Sweep(Mat disparity, bool u, bool v, int start_row, int start_column, RowOp op) */
+        /*Description: apply op(row pointer, row index) to every row in place, then count
+                                  the row while it is in cache, in the same pass as Compute                               */
+        /*Input: Mat disparity - disparity map (CV_8UC1), modified by op
+                        bool u - calculate u-disparity
+                        bool v - calculate v-disparity
+                        int start_row - row of the top-left point
+                        int start_column - column of the top-left point
+                        RowOp op - row operation                                                                                                   */
+        /*Output: void                                                                                                                                                       */
+
+        template<typename RowOp>
+        void Sweep(Mat disparity, bool u, bool v, int start_row, int start_column, RowOp op){
+
+            CV_Assert(disparity.type() == CV_8UC1);
+            // A bin never exceeds the number of rows (U) or columns (V)
+            CV_Assert(disparity.rows <= USHRT_MAX && disparity.cols <= USHRT_MAX);
+
+            u_view_count = -1;
+            v_view_count = -1;
+            has_u = u && max_disparity > 0;
+            has_v = v && max_disparity > 0;
+            if(has_u){
+                u_hist.create(max_disparity, disparity.cols, CV_16U);
+                u_hist.setTo(0);
+            }
+            if(has_v){
+                v_hist.create(disparity.rows, max_disparity, CV_16U);
+                v_hist.setTo(0);
+            }
+            start_row = min(max(start_row, 0), disparity.rows);
+
+            // Row stripes; V rows are disjoint, U is accumulated per stripe and reduced
+            int num_stripes = max(1, min(getNumThreads(), has_u ? disparity.rows/16 : disparity.rows));
+            if(has_u){
+                u_partial.resize(num_stripes);
+                u_partial[0] = u_hist;
+                for(int i = 1; i < num_stripes; i++){
+                    u_partial[i].create(max_disparity, disparity.cols, CV_16U);
+                    u_partial[i].setTo(0);
+                }
+            }
+
+            parallel_for_(Range(0, num_stripes), [&](const Range& range){
+
+                for(int stripe = range.start; stripe < range.end; stripe++){
+
+                    int r_begin = disparity.rows*stripe/num_stripes;
+                    int r_end = disparity.rows*(stripe + 1)/num_stripes;
+                    Mat* partial = has_u ? &u_partial[stripe] : 0;
+
+                    for(int r = r_begin; r < r_end; r++){
+
+                        uchar* row = disparity.ptr<uchar>(r);
+                        op(row, r);
+                        if(r < start_row || (!has_u && !has_v)) continue;
+
+                        int c_left = int(start_column - start_column * (r-start_row)/(disparity.rows-start_row));
+                        int c_right = disparity.cols-c_left;
+                        c_left = max(c_left, 0);
+                        c_right = min(c_right, disparity.cols);
+
+                        ushort* v_row = has_v ? v_hist.ptr<ushort>(r) : 0;
+                        for(int c = c_left; c < c_right; c++){
+                            int pixel = row[c];
+                            if(pixel <= min_disparity || pixel >= max_disparity) continue;
+                            if(has_v) v_row[pixel]++;
+                            if(has_u) partial->ptr<ushort>(pixel)[c]++;
+                        }
+
+                    }
+
+                }
+
+            });
+
+            for(int i = 1; has_u && i < num_stripes; i++) add(u_hist, u_partial[i], u_hist);
+
+        }
+
+
+        /*Funciton Name: U(), V()                                                                                         */
+        /*Description: counts of the last Compute (CV_16U)                                      */
+        /*Input: void                                                                                                                      */
+        /*Output: Mat u_hist, Mat v_hist                                                                              */
+
+        Mat U();
+        Mat V();
+
+
+        /*Funciton Name: UView(int min_count), VView(int min_count)                       */
+        /*Description: 255 where count > min_count, computed once per Compute
+                                  and min_count, valid until the next Compute                          */
+        /*Input: int min_count - minimal count                                                                 */
+        /*Output: Mat u_view, Mat v_view (CV_8U)                                                           */
+
+        Mat UView(int min_count);
+        Mat VView(int min_count);
+
+};
+
+
+
 /*****************************************************************
 Class Name: OnlineGroundFilter
 Description: ground plane is calculated from v-disparity online
@@ -138,12 +373,13 @@ class OnlineGroundFilter: public VDisparityGroundFilter{
         int min_disparity;
         
         // Projected disparity maps
-        Mat v_disparity;
-        Mat u_disparity;
+        UVDisparityHistogram histogram;
+        int uv_start_row;
+        int uv_start_column;
 
 
         /*Funciton Name: CalcUVdisp(Mat disparity, bool u, bool v, int start_row, int start_column)      */
-        /*Description: update u_disparity and v_disparity from disparity map,
+        /*Description: update the u- and v-disparity histograms from disparity map,
                                         a trapezoid area from (start_row, start_column)                                                              */
         /*Input: Mat disparity - disparity map
                         bool u - calculate u-disparity
@@ -170,8 +406,15 @@ class OnlineGroundFilter: public VDisparityGroundFilter{
         OnlineGroundFilter(string config);
 
 
+        /*Funciton Name: OnlineGroundFilter(const GroundParams& params)                 */
+        /*Description: constructor from parsed configuration                                 */
+        /*Input: const GroundParams& params - ground parameters                            */
+
+        OnlineGroundFilter(const GroundParams& params);
+
+
         /*Funciton Name: Udisparity(Mat disparity, int min_disp, int max_disp, int min_count)              */
-        /*Description: calculate and return u-disparity                                                                                                 */
+        /*Description: calculate and return u-disparity, valid until the next call                         */
         /*Input: Mat disparity - disparity map
                         int min_disp - minimal disparity
                         int max_disp - maximal disparity
@@ -182,7 +425,7 @@ class OnlineGroundFilter: public VDisparityGroundFilter{
 
 
         /*Funciton Name: Vdisparity(Mat disparity, int min_disp, int max_disp, int min_count)              */
-        /*Description: calculate and return v-disparity                                                                                                 */
+        /*Description: calculate and return v-disparity, valid until the next call                          */
         /*Input: Mat disparity - disparity map
                         int min_disp - minimal disparity
                         int max_disp - maximal disparity
@@ -191,6 +434,37 @@ class OnlineGroundFilter: public VDisparityGroundFilter{
 
         Mat Vdisparity(Mat disparity, int min_disp, int max_disp, int min_count);
 
+
+        /*Funciton Name: FitGroundPlane()                                                                           */
+        /*Description: update ground_k and ground_b from the current v-disparity */
+        /*Input: void                                                                                                                      */
+        /*Output: void                                                                                                                  */
+
+        virtual void FitGroundPlane();
+
+
+        /*Funciton Name: UpdateGroundPlane(Mat disparity)                                          */
+        /*Description: update ground_k and ground_b from disparity map      */
+        /*Input: Mat disparity - diaprity map                                                                     */
+        /*Output: void                                                                                                                  */
+
+        virtual void UpdateGroundPlane(Mat disparity);
+
+
+        using VDisparityGroundFilter::FilterGround;
+
+
+        /*Funciton Name: FilterGround(Mat& disparity, int min_disparity, int iterations)  */
+        /*Description: iterated ground filtering after UpdateGroundPlane: every pass
+                                  removes ground and accumulates the v-disparity for the next
+                                  fit, the last pass also removes pixels below min_disparity  */
+        /*Input: Mat& disparity - disparity map
+                        int min_disparity - minimal disparity kept
+                        int iterations - number of filtering passes                                                  */
+        /*Output: void                                                                                                                             */
+
+        void FilterGround(Mat& disparity, int min_disparity, int iterations);
+
 };
 
 
@@ -226,12 +500,19 @@ class HoughGroundFilter: public OnlineGroundFilter{
         HoughGroundFilter(string config);
 
 
-        /*Funciton Name: UpdateGroundPlane(Mat disparity)           		              */
-        /*Description: update ground_k and ground_b from disparity map      */
-        /*Input: Mat disparity - diaprity map                                                                     */  
+        /*Funciton Name: HoughGroundFilter(const GroundParams& params)                  */
+        /*Description: constructor from parsed configuration                                 */
+        /*Input: const GroundParams& params - ground parameters                            */
+
+        HoughGroundFilter(const GroundParams& params);
+
+
+        /*Funciton Name: FitGroundPlane()                                                                           */
+        /*Description: update ground_k and ground_b from the current v-disparity */
+        /*Input: void                                                                                                                      */
         /*Output: void                                                                                                                  */
 
-        void UpdateGroundPlane(Mat disparity);
+        void FitGroundPlane();
 
 };
 
@@ -251,36 +532,46 @@ class RANSACGroundFilter: public OnlineGroundFilter{
         int start_row;
         int start_column;
         int max_iteration;
+        int seed;
 
         float last_ground_k;
         float last_ground_b;
 
         int num_median_filter;
 
-        vector<Point2i> list_point;
-        vector<Point2i> list_sample_point;
-        vector<Point2i> list_inliers;
+        // v-disparity points (structure of arrays), x - disparity, y - row,
+        // w - count of the bin; cumulative weights for sampling
+        vector<float> point_x;
+        vector<float> point_y;
+        vector<float> point_w;
+        vector<float> point_cumulative;
+        float total_weight;
+
+        // Samples of the current hypothesis
+        vector<int> list_sample;
 
         LineModel ground_line;
 
+        // Random generator owned by the filter, reseeded every fit
+        RNG rng;
+
         // MedianFilter for ground_k and ground_b   
         MedianFilter mfk;
         MedianFilter mfb;
 
-        // int num_data;
-        int num_inliers;
-        int max_cost;
+        // Score of the best hypothesis (sum of inlier counts)
+        float max_cost;
 
 
         /*Funciton Name: UpdateList()                                                             		              */
-        /*Description: update list_point from v_disparity                                            */
+        /*Description: update the point arrays from the v-disparity counts           */
         /*Input: void                                                                                                                      */  
         /*Output: void                                                                                                                  */
         void UpdateList();
 
 
         /*Funciton Name: GetRandomSamples()                                                                      */
-        /*Description: get samples from list_point and save to list_sample_point    */
+        /*Description: draw num_samples points, weighted by count, to list_sample */
         /*Input: void                                                                                                                               */  
         /*Output: void                                                                                                                           */        
 
@@ -288,28 +579,30 @@ class RANSACGroundFilter: public OnlineGroundFilter{
 
 
         /*Funciton Name: ComputeLine()                                                                                     */
-        /*Description: compute a line from list_sample_point                                           */
+        /*Description: compute a line from list_sample (principal axis)                      */
         /*Input: void                                                                                                                               */  
         /*Output: LineModel line                                                                                                      */       
 
         LineModel ComputeLine();
 
 
-        /*Funciton Name: ComputeCost(LineModel line)                                                      */
-        /*Description: find inliers for a given line and count newly added inliers       */
-        /*Input: void                                                                                                                               */  
-        /*Output: LineModel line                                                                                                      */
+        /*Funciton Name: ComputeCost(LineModel line, float best)                                 */
+        /*Description: sum of inlier counts of a line, stops as soon as the line
+                                  can no longer beat best                                                                             */
+        /*Input: LineModel line - line with unit direction
+                        float best - score to beat                                                                                    */  
+        /*Output: float cost                                                                                                                  */
 
-        int ComputeCost(LineModel line);
+        float ComputeCost(LineModel line, float best);
 
 
-        /*Funciton Name: ComputeDistance(LineModel line, Point p)                            */
-        /*Description: compute point to line distance                                                            */
-        /*Input: LineModel line - line
-                        Point p - point                                                                                                           */  
-        /*Output: float distance                                                                                                        */        
+        /*Funciton Name: RefitLine(LineModel line, float& k, float& b)                          */
+        /*Description: weighted least squares row = k * disparity + b on the inliers of line */
+        /*Input: LineModel line - line with unit direction
+                        float& k, float& b - fitted line                                                                      */  
+        /*Output: bool success                                                                                                            */
 
-        float ComputeDistance(LineModel line, Point p);
+        bool RefitLine(LineModel line, float& k, float& b);
 
 
     public:
@@ -328,6 +621,13 @@ class RANSACGroundFilter: public OnlineGroundFilter{
         RANSACGroundFilter(string config);
 
 
+        /*Funciton Name: RANSACGroundFilter(const GroundParams& params)                 */
+        /*Description: constructor from parsed configuration                                 */
+        /*Input: const GroundParams& params - ground parameters                            */
+
+        RANSACGroundFilter(const GroundParams& params);
+
+
         /*Funciton Name: UpdateGroundPlane(Mat disparity)           		              */
         /*Description: update ground_k and ground_b from disparity map      */
         /*Input: Mat disparity - diaprity map                                                                     */  
@@ -335,4 +635,222 @@ class RANSACGroundFilter: public OnlineGroundFilter{
         
         void UpdateGroundPlane(Mat disparity);
 
-};
\ No newline at end of file
+
+        /*Funciton Name: FitGroundPlane()                                                                           */
+        /*Description: update ground_k and ground_b from the current v-disparity */
+        /*Input: void                                                                                                                      */
+        /*Output: void                                                                                                                  */
+
+        void FitGroundPlane();
+
+};
+
+
+
+/*****************************************************************
+Class Name: PeakGroundFilter
+Description: ground line fitted to the per-row peaks of the v-disparity
+                         with iteratively reweighted least squares (Huber)
+*****************************************************************/
+
+class PeakGroundFilter: public OnlineGroundFilter{
+
+    private:
+
+        int start_row;
+        int start_column;
+        float huber_delta;                       // residual (disparity) beyond which a peak is down-weighted
+        int irls_iterations;
+
+        int num_median_filter;
+
+        // Row peaks, x - disparity, y - row, w - count of the peak
+        vector<float> peak_x;
+        vector<float> peak_y;
+        vector<float> peak_w;
+
+        // MedianFilter for ground_k and ground_b
+        MedianFilter mfk;
+        MedianFilter mfb;
+
+
+        /*Funciton Name: UpdatePeaks()                                                                             */
+        /*Description: collect the argmax disparity of every v-disparity row,
+                                  refined to sub-pixel by a parabola through the neighbours */
+        /*Input: void                                                                                                                      */
+        /*Output: void                                                                                                                  */
+
+        void UpdatePeaks();
+
+
+        /*Funciton Name: FitLine(float& k, float& b)                                                      */
+        /*Description: Huber IRLS disparity = a * row + c on the peaks, the peaks
+                                  are noisy in disparity only; k = 1 / a, b = - c / a                */
+        /*Input: float& k, float& b - fitted line                                                                */
+        /*Output: bool success                                                                                                     */
+
+        bool FitLine(float& k, float& b);
+
+
+    public:
+
+        /*Funciton Name: PeakGroundFilter()                                                                     */
+        /*Description: Default constructor                                                                            */
+        /*Input: void                                                                                                                      */
+
+        PeakGroundFilter();
+
+
+        /*Funciton Name: PeakGroundFilter(string config)                                             */
+        /*Description: constructor from configuration file                                     */
+        /*Input: string config - path to configuration file                                        */
+
+        PeakGroundFilter(string config);
+
+
+        /*Funciton Name: PeakGroundFilter(const GroundParams& params)                      */
+        /*Description: constructor from parsed configuration                                 */
+        /*Input: const GroundParams& params - ground parameters                            */
+
+        PeakGroundFilter(const GroundParams& params);
+
+
+        /*Funciton Name: UpdateGroundPlane(Mat disparity)                                          */
+        /*Description: update ground_k and ground_b from disparity map      */
+        /*Input: Mat disparity - diaprity map                                                                     */
+        /*Output: void                                                                                                                  */
+
+        void UpdateGroundPlane(Mat disparity);
+
+
+        /*Funciton Name: FitGroundPlane()                                                                           */
+        /*Description: update ground_k and ground_b from the current v-disparity */
+        /*Input: void                                                                                                                      */
+        /*Output: void                                                                                                                  */
+
+        void FitGroundPlane();
+
+};
+
+
+
+/*****************************************************************
+Class Name: PredictedGroundFilter
+Description: ground line predicted from the camera pose, verified on a
+                         sparse sample of the disparity map; the online filter
+                         runs only if the check fails or the estimate is too old
+*****************************************************************/
+
+class PredictedGroundFilter{
+
+    private:
+
+        float f;
+
+        // Pose source, camera height (m) and pitch (degree)
+        float* cam_height;
+        float* cam_theta;
+
+        // Last full estimate
+        bool valid;
+        float ref_k;
+        float ref_b;
+        float ref_height;
+        float ref_theta;
+        float ref_ratio;
+        int age;
+        Mat unfiltered;                             // disparity of the last full estimate before filtering
+
+        // Parameters
+        int max_age;                                // frames before a full estimate is forced
+        int verify_step;                          // row and column stride of the check
+        float verify_tolerance;             // disparity tolerance of a ground pixel
+        float verify_ratio;                     // accepted fraction of the reference ratio
+
+        // Statistics
+        long num_frames;
+        long num_skipped;
+        bool last_skipped;
+        double last_time;
+
+
+        /*Funciton Name: Verify(Mat disparity, float k, float b)                                   */
+        /*Description: fraction of sampled valid pixels below the horizon that lie
+                                  on the ground line                                                                             */
+        /*Input: Mat disparity - disparity map
+                        float k, float b - ground line                                                                   */
+        /*Output: float ratio                                                                                                            */
+
+        float Verify(Mat disparity, float k, float b);
+
+
+    public:
+
+        /*Funciton Name: PredictedGroundFilter()                                                          */
+        /*Description: Default constructor                                                                            */
+        /*Input: void                                                                                                                      */
+
+        PredictedGroundFilter();
+
+
+        /*Funciton Name: PredictedGroundFilter(CameraModel* cm, string config)    */
+        /*Description: constructor with camera model and configuration file      */
+        /*Input: CameraModel* cm - pointer to a CameraModel
+                        string config - path to configuration file                                                */
+
+        PredictedGroundFilter(CameraModel* cm, string config);
+
+
+        /*Funciton Name: PredictedGroundFilter(CameraModel* cm, const GroundParams& params) */
+        /*Description: constructor from parsed configuration                                 */
+        /*Input: CameraModel* cm - pointer to a CameraModel
+                        const GroundParams& params - ground parameters                                   */
+
+        PredictedGroundFilter(CameraModel* cm, const GroundParams& params);
+
+
+        /*Funciton Name: SetPoseSource(float* cam_height, float* cam_theta)        */
+        /*Description: set the pose source, without it every frame is estimated */
+        /*Input: float* cam_height - camera height (m)
+                        float* cam_theta - camera pitch (degree)                                            */
+        /*Output: void                                                                                                                      */
+
+        void SetPoseSource(float* cam_height, float* cam_theta);
+
+
+        /*Funciton Name: FilterGround(OnlineGroundFilter& filter, Mat& disparity, int min_disparity, int iterations) */
+        /*Description: filter ground with the predicted line if it passes the check,
+                                  otherwise UpdateGroundPlane and iterated FilterGround of filter                      */
+        /*Input: OnlineGroundFilter& filter - online ground filter
+                        Mat& disparity - disparity map
+                        int min_disparity - minimal disparity kept
+                        int iterations - number of filtering passes of a full estimate                                  */
+        /*Output: void                                                                                                                                                     */
+
+        void FilterGround(OnlineGroundFilter& filter, Mat& disparity, int min_disparity, int iterations);
+
+
+        /*Funciton Name: SkipRatio()                                                                                   */
+        /*Description: fraction of frames without full estimate                              */
+        /*Input: void                                                                                                                      */
+        /*Output: float ratio                                                                                                           */
+
+        float SkipRatio();
+
+
+        /*Funciton Name: Skipped()                                                                                      */
+        /*Description: whether the last frame used the prediction                          */
+        /*Input: void                                                                                                                      */
+        /*Output: bool skipped                                                                                                      */
+
+        bool Skipped();
+
+
+        /*Funciton Name: EstimationTime()                                                                        */
+        /*Description: ground estimation and filtering time of the last frame (ms) */
+        /*Input: void                                                                                                                      */
+        /*Output: double time                                                                                                         */
+
+        double EstimationTime();
+
+};
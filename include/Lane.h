@@ -150,9 +150,9 @@ class CameraLane: public Lane{
         /*Funciton Name: Width(int n)				    	                     	   	 			          */
         /*Description: Return the n-th width in image representation           */
         /*Input: int n - index of way point                                                                   */        
-        /*Output: vector<int> width                                                                              */  
+        /*Output: const vector<int>& width                                                                   */  
 
-        vector<int> Width(int n);
+        const vector<int>& Width(int n);
 
 
         /*Funciton Name: PrintWidths()   					      	         	   	 			           */
@@ -222,9 +222,9 @@ class MonoLane: public CameraLane{
         /*Funciton Name: VisOneLine(int n)			    	              	   	 			            */
         /*Description: Return n-th line in image representation                       */
         /*Input: int n - index of way point                                                                   */        
-        /*Output: vector<Point2i> line                                                                         */  
+        /*Output: const vector<Point2i>& line                                                              */  
 
-        vector<Point2i> VisOneLine(int n);
+        const vector<Point2i>& VisOneLine(int n);
 
 
         /*Funciton Name: MonoCamModel()   					           	   	 			           */
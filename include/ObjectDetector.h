@@ -12,6 +12,7 @@ Description:        ObjectDetector
 #include "CameraModel.h"
 #include "Lane.h"
 #include "GroundFilter.h"
+#include "ObjectFilter.h"
 
 using namespace cv;
 using namespace std;
@@ -32,16 +33,29 @@ class ObjectDetector{
         int out_cx;
         int out_cy;
 
-        /*Funciton Name: CalculateDisparity(Mat img, Rect box)                      */
-        /*Description: Calculate the disparity from given box                             
+        // Statistics of the disparity map of the current frame
+        BoxStatistics box_stats;
+
+
+        /*Funciton Name: UpdateBoxStatistics(Mat img)                                             */
+        /*Description: build the box statistics of a new disparity map, the tile
+                                  histograms only if DISPARITY_CALC_TYPE needs them           */
+        /*Input: Mat img - disparity map                                                                         */
+        /*Output: void                                                                                                           */
+
+        void UpdateBoxStatistics(Mat img);
+
+
+        /*Funciton Name: CalculateDisparity(Rect box)                                               */
+        /*Description: Calculate the disparity from given box of the disparity map
+                                    of UpdateBoxStatistics, bottom-right corner included
                                     DISPARITY_CALC_TYPE:  0 - median
                                                                                         1 - average
                                                                                         2 - max                                          */
-        /*Input: Mat img - disparity map
-                        Rect box - calculated area                                                                   */   
-        /*Output: int disparity value                                                                                */
+        /*Input: Rect box - calculated area                                                                   */   
+        /*Output: int disparity value, 0 if no pixel                                                   */
 
-        int CalculateDisparity(Mat img, Rect box);
+        int CalculateDisparity(Rect box);
 
 
         /*Funciton Name: RotateObject2D(float angle)                                         */
@@ -68,6 +82,9 @@ class ObjectDetector{
         ObjectDetector(CameraModel* cm);
 
 
+        virtual ~ObjectDetector(){}
+
+
         /*Funciton Name: List2D()                                          			                                  */
         /*Description: Return current 2D object list                                                 */
         /*Input: void                                                                                                               */   
@@ -83,13 +100,70 @@ class ObjectDetector{
 
         virtual vector<Object_2D> DetectObject2D(Mat disparity)=0;
 
+
+        /*Funciton Name: SetGroundPlane(float k, float b)                                      */
+        /*Description: ground line of the next frames, ignored by detectors
+                                  that do not use it                                                                        */
+        /*Input: float k, float b - ground line, row = k * disparity + b              */
+        /*Output: void                                                                                                           */
+
+        virtual void SetGroundPlane(float k, float b){}
+
+};
+
+
+
+/*****************************************************************
+Structure Name: SliceRun
+Description: horizontal run of pixels of one depth slice
+*****************************************************************/
+
+struct SliceRun{
+
+    int row;
+    int start;
+    int end;                    // exclusive
+    int slice;
+
+};
+
+
+
+/*****************************************************************
+Structure Name: SliceBlob
+Description: connected pixels of one depth slice with statistics
+*****************************************************************/
+
+struct SliceBlob{
+
+    int slice;
+    Rect box;
+    int area;                   // non-zero pixels
+
+};
+
+
+
+/*****************************************************************
+Structure Name: SliceScratch
+Description: labeling buffers of one worker, kept between frames
+*****************************************************************/
+
+struct SliceScratch{
+
+    vector<Range> row_runs;
+    vector<SliceRun> runs;
+    vector<int> parent;
+    vector<int> run_blob;
+    vector<SliceBlob> blobs;
+
 };
 
 
 
 /*****************************************************************
 Class Name: ContourDetector
-Description: Detect object from contour
+Description: Detect object from depth slices of the disparity map
 *****************************************************************/
 
 class ContourDetector: public ObjectDetector{
@@ -104,24 +178,90 @@ class ContourDetector: public ObjectDetector{
         int median_kernel;
         int min_disparity;
         int canny_threshold;
-        string config;
         vector<float> list_depth;
 
-        /*Funciton Name: Generate2DList(Mat&src, vector<Rect> boxes)      */
-        /*Description: Generate 2D list from dispariy map and boxes              */
-        /*Input: Mat src - disparity map                                                            
-                        vector<Rect> boxes - detected boxes                                            */   
+        // Filters of the detected boxes, built with the detector
+        SizeFilter sf;
+        ConfidenceFilter cf;
+        NMSFilter nmsf;
+
+        // Erosion and dilation of the slices
+        int erode_kernel;
+        int dilate_kernel;
+
+        // Disparity to slice code (2k - slice k, 2k+1 - slices k and k+1,
+        // 0 - no slice)
+        Mat slice_table;
+        int num_slices;
+
+        // Slice buffers, kept between frames: slice code per pixel and
+        // one packed mask per slice
+        Mat slices;
+        vector<BitMask> masks;
+
+        // Per worker labeling buffers and per slice results, kept between frames
+        vector<SliceScratch> scratch;
+        vector<vector<Rect>> slice_candidates;          // boxes above the confidence
+        vector<vector<Rect>> slice_boxes;                  // boxes after NMS
+
+
+        /*Funciton Name: UpdateSliceTable()                                                                 */
+        /*Description: slice code of every disparity from the depth list, slice k
+                                  holds disparities in [D(depth[k+1]), D(depth[k])]             */
+        /*Input: void                                                                                                               */
+        /*Output: void                                                                                                           */
+
+        void UpdateSliceTable();
+
+
+        /*Funciton Name: SplitSlices(Mat disparity)                                                      */
+        /*Description: quantize disparity to slices and scatter the pixels to the
+                                  packed masks of their slices in one pass                           */
+        /*Input: Mat disparity - disparity map                                                            */
+        /*Output: void                                                                                                           */
+
+        void SplitSlices(Mat disparity);
+
+
+        /*Funciton Name: LabelMask(const BitMask& mask, int slice, SliceScratch& buffers) */
+        /*Description: label 8-connected pixels of a packed mask in one pass
+                                  over its runs, to buffers.blobs                                                          */
+        /*Input: const BitMask& mask - mask of one slice
+                        int slice - slice index
+                        SliceScratch& buffers - labeling buffers of the worker                      */
+        /*Output: void                                                                                                           */
+
+        void LabelMask(const BitMask& mask, int slice, SliceScratch& buffers);
+
+
+        /*Funciton Name: DetectSlice(int k, SliceScratch& buffers, ConfidenceFilter& cf, NMSFilter& nmsf) */
+        /*Description: erode, dilate and label the mask of slice k, keep the boxes
+                                  above the confidence and filter them by NMS; touches
+                                  only the mask and results of slice k                                             */
+        /*Input: int k - slice, 0 to num_slices - 1
+                        SliceScratch& buffers - labeling buffers of the worker
+                        ConfidenceFilter& cf - confidence filter
+                        NMSFilter& nmsf - NMS filter                                                                  */
+        /*Output: void                                                                                                           */
+
+        void DetectSlice(int k, SliceScratch& buffers, ConfidenceFilter& cf, NMSFilter& nmsf);
+
+
+        /*Funciton Name: Generate2DList(vector<Rect> boxes)                         */
+        /*Description: Generate 2D list from box statistics and boxes            */
+        /*Input: vector<Rect> boxes - detected boxes                                            */   
         /*Output: void                                                                                                           */  
 
-        void Generate2DList(Mat&src, vector<Rect> boxes);
+        void Generate2DList(vector<Rect> boxes);
 
 
-        /*Funciton Name: InitiateParameter(string config)                                  */
-        /*Description: Read parameter from configuration file                          */
-        /*Input: string config - path to configuration file                                       */   
+        /*Funciton Name: InitiateParameter(const DetectorParams& params, const ObjectFilterParams& filter) */
+        /*Description: Set parameters and filters from parsed configuration             */
+        /*Input: const DetectorParams& params - detector parameters
+                        const ObjectFilterParams& filter - filter parameters                          */
         /*Output: void                                                                                                           */
 
-        void InitiateParameter(string config);
+        void InitiateParameter(const DetectorParams& params, const ObjectFilterParams& filter);
 
 
     public:
@@ -150,6 +290,25 @@ class ContourDetector: public ObjectDetector{
         ContourDetector(CameraModel* cm, Lane* lane, string config);
 
 
+        /*Funciton Name: ContourDetector(CameraModel* cm, const DetectorParams& params, const ObjectFilterParams& filter) */
+        /*Description: Constructor from CameraModel and parsed configuration                           */
+        /*Input: CameraModel* cm - pointer to a CameraModel
+                        const DetectorParams& params - detector parameters
+                        const ObjectFilterParams& filter - filter parameters                                    */
+
+        ContourDetector(CameraModel* cm, const DetectorParams& params, const ObjectFilterParams& filter);
+
+
+        /*Funciton Name: ContourDetector(CameraModel* cm, Lane* lane, const DetectorParams& params, const ObjectFilterParams& filter) */
+        /*Description: Constructor from CameraModel, Lane and parsed configuration                   */
+        /*Input: CameraModel* cm - pointer to a CameraModel
+                        Lane* lane - pointer to a Lane
+                        const DetectorParams& params - detector parameters
+                        const ObjectFilterParams& filter - filter parameters                                    */
+
+        ContourDetector(CameraModel* cm, Lane* lane, const DetectorParams& params, const ObjectFilterParams& filter);
+
+
         /*Funciton Name: DetectObject2D(Mat disparity)	                                  */
         /*Description: Detect object from dispariy                                                   */
         /*Input: Mat disparity - disparity map                                                            */   
@@ -163,16 +322,76 @@ class ContourDetector: public ObjectDetector{
 
 /*****************************************************************
 Class Name: UVDisparityDetector
-Description: Detect object from UV-Disparity (experimental, incomplete)
+Description: Detect object from stixels: a u-disparity per column band, the
+                         band disparities chosen by dynamic programming along the
+                         columns, neighbouring stixels grouped into objects
 *****************************************************************/
 
-class UVDisparityDetector{
+class UVDisparityDetector: public ObjectDetector{
 
     private:
 
-        OnlineGroundFilter ogf;
-        Mat u_disp, v_disp;
-        int uvd_min_count;
+        // Parameters
+        int stixel_width;                               // columns per band
+        int stixel_min_count;                       // support of an obstacle disparity in a band
+        float stixel_smooth_penalty;          // per disparity step between bands
+        float stixel_jump_penalty;              // cap of the step penalty, also obstacle start/end
+        float stixel_group_tolerance;       // disparity step inside one object
+        int stixel_min_group;                       // minimal bands of an object
+        int stixel_max_gap;                            // rows without support inside a stixel
+
+        // Ground line, row = ground_k * disparity + ground_b
+        float ground_k;
+        float ground_b;
+        int ground_tolerance;
+
+        // Count per band and disparity (bands x 256), last row above the
+        // ground per disparity
+        int num_bands;
+        vector<int> count;
+        vector<int> limit;
+
+        // Dynamic programming: value and predecessor per band and disparity
+        vector<float> value;
+        vector<short> from;
+
+        vector<Stixel> stixels;
+
+
+        /*Funciton Name: Accumulate(Mat disparity)                                                  */
+        /*Description: u-disparity of every band above the ground line                  */
+        /*Input: Mat disparity - disparity map                                                            */
+        /*Output: void                                                                                                           */
+
+        void Accumulate(Mat disparity);
+
+
+        /*Funciton Name: Segment(Mat disparity)                                                          */
+        /*Description: choose one disparity per band (0 - free) maximizing the
+                                  support minus the steps between bands, and build stixels */
+        /*Input: Mat disparity - disparity map                                                            */
+        /*Output: void                                                                                                           */
+
+        void Segment(Mat disparity);
+
+
+        /*Funciton Name: Extent(Mat disparity, Stixel& stixel, int d)                             */
+        /*Description: rows of the stixel, the run of rows at disparity d +-1 with
+                                  the most pixels, gaps up to stixel_max_gap rows are bridged */
+        /*Input: Mat disparity - disparity map
+                        Stixel& stixel - stixel with column and width, top and bottom set
+                        int d - disparity of the band                                                                    */
+        /*Output: bool found                                                                                                 */
+
+        bool Extent(Mat disparity, Stixel& stixel, int d);
+
+
+        /*Funciton Name: Group()                                                                                  */
+        /*Description: group neighbouring stixels of similar disparity to objects */
+        /*Input: void                                                                                                               */
+        /*Output: void                                                                                                           */
+
+        void Group();
 
 
     public:
@@ -191,6 +410,22 @@ class UVDisparityDetector{
         UVDisparityDetector(string config);
 
 
+        /*Funciton Name: UVDisparityDetector(const DetectorParams& params)      */
+        /*Description: Constructor from parsed configuration                               */
+        /*Input: const DetectorParams& params - detector parameters                 */
+
+        UVDisparityDetector(const DetectorParams& params);
+
+
+        /*Funciton Name: SetGroundPlane(float k, float b)                                      */
+        /*Description: ground line of the next frames, pixels on the ground are
+                                  ignored and stixels end on the ground; k <= 0 disables     */
+        /*Input: float k, float b - ground line, row = k * disparity + b              */
+        /*Output: void                                                                                                           */
+
+        void SetGroundPlane(float k, float b);
+
+
         /*Funciton Name: DetectObject2D(Mat disparity)	                                  */
         /*Description: Detect object from dispariy                                                   */
         /*Input: Mat disparity - disparity map                                                            */   
@@ -198,4 +433,12 @@ class UVDisparityDetector{
 
         vector<Object_2D> DetectObject2D(Mat disparity);
 
-};
\ No newline at end of file
+
+        /*Funciton Name: Stixels()                                                                                */
+        /*Description: Return the stixels of the last frame                                 */
+        /*Input: void                                                                                                               */
+        /*Output: vector<Stixel> stixels                                                                       */
+
+        vector<Stixel> Stixels();
+
+};
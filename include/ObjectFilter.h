@@ -11,6 +11,7 @@ Description:        ObjectFilter
 #include"Utility.h"
 #include"CameraModel.h"
 #include"Lane.h"
+#include"Config.h"
 
 using namespace cv;
 using namespace std;
@@ -32,6 +33,9 @@ class ObjectFilter{
         ObjectFilter();
 
 
+        virtual ~ObjectFilter(){}
+
+
         /*Funciton Name:FilterObjectList()                                                                  */                            
         /*Description: virtual function to filter object                                              */
         /*Input: void                                                                                                               */    
@@ -70,6 +74,23 @@ class ObjectFilter2D: public ObjectFilter{
 
         void UpdateObjectSource(vector<Object_2D>* source);
 
+
+        /*Funciton Name: Fit(const Object_2D& obj)                                                     */
+        /*Description: Return whether an object is kept, the predicate of the filter */
+        /*Input: const Object_2D& obj - 2D object                                                         */
+        /*Output: bool result - 1: keep                                                                            */
+
+        virtual bool Fit(const Object_2D& obj);
+
+
+        /*Funciton Name:FilterObjectList()                                                                  */
+        /*Description: Keep the objects that fit, compacted in place in one pass,
+                                  the order is kept and the list never reallocates              */
+        /*Input: void                                                                                                               */
+        /*Output: void                                                                                                           */
+
+        virtual void FilterObjectList();
+
 };
 
 
@@ -84,7 +105,27 @@ class NMSFilter: public ObjectFilter2D{
     private:
 
         float NMS_threshold;
-    
+
+        // Scratch of FilterObjectList, kept between frames
+        vector<Rect> boxes;
+        vector<float> scores;
+        vector<int> order;
+        vector<uchar> keep;
+
+
+        /*Funciton Name: Suppress(const vector<Rect>& boxes, const vector<float>& scores,
+                                                    vector<int>& order, vector<uchar>& keep)                    */
+        /*Description: greedy NMS: boxes visited by descending score (ties by index)
+                                  are kept unless they overlap a kept box above NMS_threshold;
+                                  boxes of score 0 are dropped, as by dnn::NMSBoxes           */
+        /*Input: const vector<Rect>& boxes - boxes
+                        const vector<float>& scores - score of each box
+                        vector<int>& order - scratch of the visiting order
+                        vector<uchar>& keep - 1: box kept                                                          */
+        /*Output: void                                                                                                               */
+
+        void Suppress(const vector<Rect>& boxes, const vector<float>& scores, vector<int>& order, vector<uchar>& keep) const;
+
     public:
 
         /*Funciton Name: NMSFilter()                                          						            */
@@ -101,8 +142,16 @@ class NMSFilter: public ObjectFilter2D{
         NMSFilter(string config);
 
 
+        /*Funciton Name: NMSFilter(const ObjectFilterParams& params)          */
+        /*Description: Constructor from parsed configuration                             */
+        /*Input: const ObjectFilterParams& params - filter parameters              */
+
+        NMSFilter(const ObjectFilterParams& params);
+
+
         /*Funciton Name:FilterObjectList()                                                                  */                            
-        /*Description: Filter object using NMS                                                            */
+        /*Description: Filter object using NMS, larger disparity has priority, the
+                                  list is compacted in place in its original order            */
         /*Input: void                                                                                                               */    
         /*Output: void                                                                                                           */        
 
@@ -110,7 +159,8 @@ class NMSFilter: public ObjectFilter2D{
 
 
         /*Funciton Name:FilterObjectBox(vector<Rect> boxes)                         */                            
-        /*Description: Filter list of boxes using NMS                                                */
+        /*Description: Filter list of boxes using NMS, larger area has priority,
+                                  the order is kept; safe to call from several threads      */
         /*Input: vector<Rect> boxes - list of original boxes                                   */    
         /*Output: vector<Rect> filtered boxes                                                            */        
 
@@ -157,6 +207,13 @@ class ConfidenceFilter: public ObjectFilter2D{
         ConfidenceFilter(string config);
 
 
+        /*Funciton Name: ConfidenceFilter(const ObjectFilterParams& params)  */
+        /*Description: Constructor from parsed configuration                             */
+        /*Input: const ObjectFilterParams& params - filter parameters              */
+
+        ConfidenceFilter(const ObjectFilterParams& params);
+
+
         /*Funciton Name: ConfidenceFit(Mat disparity, Rect box)   	                                                      */
         /*Description: Return whether confidence of the box is above confidence_threshold   */
         /*Input: Mat disparity - disparity map 
@@ -166,6 +223,16 @@ class ConfidenceFilter: public ObjectFilter2D{
         bool ConfidenceFit(Mat disparity, Rect box);
 
 
+        /*Funciton Name: ConfidenceFit(const BitMask& mask, Rect box)                                         */
+        /*Description: Return whether confidence of the box is above confidence_threshold, set
+                                  pixels of a packed mask counted by popcount                                                  */
+        /*Input: const BitMask& mask - packed mask
+                        Rect box - area to be calculated                                                                                               */
+        /*Output: bool result - 1: above threshold                                                                                           */
+
+        bool ConfidenceFit(const BitMask& mask, Rect box);
+
+
         /*Funciton Name: FilterObjectList()   	                                                            */
         /*Description: Filter object list by confidence, not implemented       */
         /*Input: void                                                                                                               */  
@@ -214,20 +281,29 @@ class SizeFilter: public ObjectFilter2D{
 
         SizeFilter(CameraModel* cm, string config);
 
-        /*Funciton Name:FilterObjectList()                                                                  */                            
-        /*Description: Filter object by size                                                                    */
-        /*Input: void                                                                                                               */    
-        /*Output: void                                                                                                           */       
 
-        void FilterObjectList();
+        /*Funciton Name: SizeFilter(CameraModel* cm, const ObjectFilterParams& params) */
+        /*Description: Constructor from cameramodel and parsed configuration        */
+        /*Input: CameraModel* cm - pointer to a CameraModel
+                        const ObjectFilterParams& params - filter parameters                */
+
+        SizeFilter(CameraModel* cm, const ObjectFilterParams& params);
+
+
+        /*Funciton Name: Fit(const Object_2D& obj)                                                     */
+        /*Description: Keep objects of relevant size                                                   */
+        /*Input: const Object_2D& obj - 2D object                                                         */
+        /*Output: bool result - 1: keep                                                                            */
+
+        bool Fit(const Object_2D& obj);
 
- 
-        /*Funciton Name: SizeFit(Object_2D obj)   	                                                     */
+
+        /*Funciton Name: SizeFit(const Object_2D& obj)   	                                          */
         /*Description: Return whether size of 2D object is relevant                       */
-        /*Input: Object_2D obj - 2D object                                                                        */  
-        /*Output: bool result - 1: size is relevant                                                            */       
+        /*Input: const Object_2D& obj - 2D object                                                         */
+        /*Output: bool result - 1: size is relevant                                                            */
 
-        bool SizeFit(Object_2D obj);
+        bool SizeFit(const Object_2D& obj);
 
 };
 
@@ -260,21 +336,21 @@ class LaneFilter: public ObjectFilter2D{
         LaneFilter(CameraLane* clane);
 
 
-        /*Funciton Name: IsOverlay(Object_2D obj, vector<int> line)                  */
+        /*Funciton Name: IsOverlay(const Object_2D& obj, const vector<int>& line)   */
         /*Description: Return whether a 2D overlays with a line(2 points)         */
-        /*Input: Object_2D obj - 2D object
-                        vector<int> line - lane representation                                               */  
+        /*Input: const Object_2D& obj - 2D object
+                        const vector<int>& line - lane representation                                 */
         /*Output: bool result - 1: is overlay with line                                                    */
 
-        bool IsOverlay(Object_2D obj, vector<int> line);
+        bool IsOverlay(const Object_2D& obj, const vector<int>& line);
 
 
-        /*Funciton Name:FilterObjectList()                                                                  */                            
-        /*Description: Filter object by lane                                                                    */
-        /*Input: void                                                                                                               */    
-        /*Output: void                                                                                                           */
+        /*Funciton Name: Fit(const Object_2D& obj)                                                     */
+        /*Description: Keep objects overlaying the lane at their depth                */
+        /*Input: const Object_2D& obj - 2D object                                                         */
+        /*Output: bool result - 1: keep                                                                            */
 
-        void FilterObjectList();
+        bool Fit(const Object_2D& obj);
 
 };
 
@@ -292,13 +368,13 @@ class MonoLaneFilter: public LaneFilter{
         MonoLane* mlane;
         float max_pos_from_ground;
 
-        /*Funciton Name: :IsOnGround(Object_2D obj, int ground_u)                                        */
+        /*Funciton Name: :IsOnGround(const Object_2D& obj, int ground_u)                        */
         /*Description: Return whether a 2D object floats above max_pos_from_ground   */
-        /*Input: Object_2D obj - 2D object
+        /*Input: const Object_2D& obj - 2D object
                         int ground_u - ground line at the depth of the object                                        */  
         /*Output: bool result - 1: is on the ground                                                                                 */
 
-        bool IsOnGround(Object_2D obj, int ground_u);
+        bool IsOnGround(const Object_2D& obj, int ground_u);
     
     public:
 
@@ -315,11 +391,77 @@ class MonoLaneFilter: public LaneFilter{
         MonoLaneFilter(MonoLane* mlane);
 
 
-        /*Funciton Name:FilterObjectList()                                                                  */                            
-        /*Description: Filter object by lane                                                                    */
-        /*Input: void                                                                                                               */    
+        /*Funciton Name: Fit(const Object_2D& obj)                                                     */
+        /*Description: Keep objects overlaying the lane and standing on the ground */
+        /*Input: const Object_2D& obj - 2D object                                                         */
+        /*Output: bool result - 1: keep                                                                            */
+
+        bool Fit(const Object_2D& obj);
+
+};
+
+
+
+/*****************************************************************
+Class Name: FilterChain
+Description: Composition of object filters: the predicates of all filters
+                         in one compaction pass over the list, then NMS over the
+                         survivors; the filters are not owned
+*****************************************************************/
+
+class FilterChain: public ObjectFilter2D{
+
+    private:
+
+        vector<ObjectFilter2D*> filters;
+        NMSFilter* nmsf;
+
+    public:
+
+        /*Funciton Name: FilterChain()                                                                              */
+        /*Description: Default constructor, empty chain                                            */
+        /*Input: void                                                                                                               */
+
+        FilterChain();
+
+
+        /*Funciton Name: Add(ObjectFilter2D* filter)                                                    */
+        /*Description: Append the predicate of a filter                                              */
+        /*Input: ObjectFilter2D* filter - pointer to a filter                                          */
+        /*Output: void                                                                                                               */
+
+        void Add(ObjectFilter2D* filter);
+
+
+        /*Funciton Name: SetNMS(NMSFilter* nmsf)                                                        */
+        /*Description: NMS applied after the predicates                                           */
+        /*Input: NMSFilter* nmsf - pointer to a NMSFilter, NULL for none                 */
+        /*Output: void                                                                                                               */
+
+        void SetNMS(NMSFilter* nmsf);
+
+
+        /*Funciton Name: Clear()                                                                                          */
+        /*Description: Remove all filters, the capacity is kept                               */
+        /*Input: void                                                                                                               */
+        /*Output: void                                                                                                               */
+
+        void Clear();
+
+
+        /*Funciton Name: Fit(const Object_2D& obj)                                                     */
+        /*Description: Keep objects that fit all filters, in order of addition       */
+        /*Input: const Object_2D& obj - 2D object                                                         */
+        /*Output: bool result - 1: keep                                                                            */
+
+        bool Fit(const Object_2D& obj);
+
+
+        /*Funciton Name:FilterObjectList()                                                                  */
+        /*Description: Compact the list with all predicates, then NMS                   */
+        /*Input: void                                                                                                               */
         /*Output: void                                                                                                           */
-        
+
         void FilterObjectList();
 
 };
\ No newline at end of file
@@ -0,0 +1,329 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        Pipeline
+*****************************************************************/
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "Utility.h"
+#include "Disparity.h"
+#include "GroundFilter.h"
+#include "ObjectDetector.h"
+#include "ObjectFilter.h"
+
+using namespace std;
+using namespace cv;
+
+
+/*****************************************************************
+Stages of a Pipeline, held by value or by Ptr:
+    disparity engine - Mat CalculateDispMap(Mat img_l, Mat img_r)
+    ground model - void FilterGround(Mat& disparity, int min_disparity)
+                                  bool GroundLine(float& k, float& b)
+    detector - vector<Object_2D> DetectObject2D(Mat disparity)
+                      void SetGroundPlane(float k, float b)
+    filter - NMSFilter or FilterChain, filters the whole list
+Concrete stage types are called without dispatch at the stage boundaries;
+the stages still run one after another on the whole map and their bodies
+stay in their translation units, nothing is fused across stages. The
+Runtime stages dispatch on the configuration
+*****************************************************************/
+
+
+/*Funciton Name: Stage(T& stage), Stage(Ptr<T>& stage)                               */
+/*Description: stage held by value or by pointer                                              */
+/*Input: T& stage, Ptr<T>& stage - stage                                                               */
+/*Output: T& stage                                                                                                              */
+
+template<typename T> inline T& Stage(T& stage){ return stage; }
+template<typename T> inline T& Stage(Ptr<T>& stage){ return *stage; }
+
+
+
+/*****************************************************************
+Class Name: OnlineGround
+Description: ground model of an online ground filter estimated every frame
+*****************************************************************/
+
+template<typename Online>
+class OnlineGround{
+
+    private:
+
+        Online filter;
+        int iterations;                                         // filtering passes
+
+    public:
+
+        /*Funciton Name: OnlineGround(const Online& filter, int iterations)           */
+        /*Description: constructor from a ground filter                                              */
+        /*Input: const Online& filter - online ground filter
+                        int iterations - number of filtering passes                                      */
+
+        OnlineGround(const Online& filter, int iterations): filter(filter), iterations(iterations){}
+
+
+        /*Funciton Name: FilterGround(Mat& disparity, int min_disparity)               */
+        /*Description: estimate the ground line, iterated ground filtering, the
+                                  last pass also removes the background                                  */
+        /*Input: Mat& disparity - disparity map
+                        int min_disparity - minimal disparity kept                                           */
+        /*Output: void                                                                                                                */
+
+        void FilterGround(Mat& disparity, int min_disparity){
+
+            filter.UpdateGroundPlane(disparity);
+            filter.FilterGround(disparity, min_disparity, iterations);
+
+        }
+
+
+        /*Funciton Name: GroundLine(float& k, float& b)                                              */
+        /*Description: current ground line                                                                        */
+        /*Input: float& k, float& b - ground line, row = k * disparity + b           */
+        /*Output: bool valid - 0: no ground line                                                          */
+
+        bool GroundLine(float& k, float& b){
+
+            k = filter.GroundK();
+            b = filter.GroundB();
+            return true;
+
+        }
+
+};
+
+
+
+/*****************************************************************
+Class Name: RuntimeDisparity
+Description: disparity engine chosen by the configuration: a scheduler, or
+                         a single engine
+*****************************************************************/
+
+class RuntimeDisparity{
+
+    private:
+
+        Ptr<Disparity> matcher;
+        Ptr<DisparityScheduler> scheduler;
+
+    public:
+
+        /*Funciton Name: RuntimeDisparity()                                                                  */
+        /*Description: Default constructor                                                                    */
+        /*Input: void                                                                                                               */
+
+        RuntimeDisparity();
+
+
+        /*Funciton Name: RuntimeDisparity(Ptr<Disparity> matcher, Ptr<DisparityScheduler> scheduler) */
+        /*Description: constructor from the engines, the scheduler is used if set                          */
+        /*Input: Ptr<Disparity> matcher - disparity engine
+                        Ptr<DisparityScheduler> scheduler - disparity scheduler                                          */
+
+        RuntimeDisparity(Ptr<Disparity> matcher, Ptr<DisparityScheduler> scheduler);
+
+
+        /*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
+        /*Description: calculate disparity map                                                             */
+        /*Input: Mat img_l - left image
+                        Mat img_r - right image                                                                         */
+        /*Output: Mat disparity                                                                                             */
+
+        Mat CalculateDispMap(Mat img_l, Mat img_r);
+
+
+        /*Funciton Name: UpdateFrameTime(float frame_ms)                              */
+        /*Description: report the end-to-end latency of the last frame            */
+        /*Input: float frame_ms - latency of the whole frame [ms]                    */
+        /*Output: void                                                                                                            */
+
+        void UpdateFrameTime(float frame_ms);
+
+};
+
+
+
+/*****************************************************************
+Class Name: RuntimeGround
+Description: ground model chosen by the configuration: mono, online with or
+                         without prediction, or background only
+*****************************************************************/
+
+class RuntimeGround{
+
+    private:
+
+        Ptr<MonoGroundFilter> mono;
+        Ptr<OnlineGroundFilter> online;
+        Ptr<PredictedGroundFilter> prediction;
+        int iterations;                                         // filtering passes of online
+
+    public:
+
+        /*Funciton Name: RuntimeGround()                                                                      */
+        /*Description: Default constructor, background only                                  */
+        /*Input: void                                                                                                               */
+
+        RuntimeGround();
+
+
+        /*Funciton Name: RuntimeGround(Ptr<MonoGroundFilter> mono, Ptr<OnlineGroundFilter> online, Ptr<PredictedGroundFilter> prediction, int iterations) */
+        /*Description: constructor from the selected filters, mono before online, the
+                                  prediction only with online                                                                                                                         */
+        /*Input: Ptr<MonoGroundFilter> mono - mono ground filter
+                        Ptr<OnlineGroundFilter> online - online ground filter
+                        Ptr<PredictedGroundFilter> prediction - ground prediction
+                        int iterations - number of filtering passes of online                                                                                  */
+
+        RuntimeGround(Ptr<MonoGroundFilter> mono, Ptr<OnlineGroundFilter> online, Ptr<PredictedGroundFilter> prediction, int iterations);
+
+
+        /*Funciton Name: FilterGround(Mat& disparity, int min_disparity)               */
+        /*Description: filter ground and background with the selected filter       */
+        /*Input: Mat& disparity - disparity map
+                        int min_disparity - minimal disparity kept                                           */
+        /*Output: void                                                                                                                */
+
+        void FilterGround(Mat& disparity, int min_disparity);
+
+
+        /*Funciton Name: GroundLine(float& k, float& b)                                              */
+        /*Description: current ground line                                                                        */
+        /*Input: float& k, float& b - ground line, row = k * disparity + b           */
+        /*Output: bool valid - 0: no ground line                                                          */
+
+        bool GroundLine(float& k, float& b);
+
+};
+
+
+/*Funciton Name: ReportFrameTime(Engine& engine, float frame_ms)                     */
+/*Description: frame latency to the engines that schedule on it                     */
+/*Input: Engine& engine - disparity engine
+                float frame_ms - latency of the whole frame [ms]                                  */
+/*Output: void                                                                                                                      */
+
+template<typename Engine> inline void ReportFrameTime(Engine& engine, float frame_ms){}
+inline void ReportFrameTime(DisparityScheduler& engine, float frame_ms){ engine.UpdateFrameTime(frame_ms); }
+inline void ReportFrameTime(RuntimeDisparity& engine, float frame_ms){ engine.UpdateFrameTime(frame_ms); }
+
+
+/*****************************************************************
+Class Name: Pipeline
+Description: disparity, ground, detection and filter stages composed at
+                         compile time; with concrete stage types there is no
+                         dispatch between the stages, with the Runtime stages it is
+                         the configurable pipeline of Detection
+*****************************************************************/
+
+template<typename DisparityEngine, typename GroundModel, typename Detector, typename Filter>
+class Pipeline{
+
+    private:
+
+        DisparityEngine engine;
+        GroundModel ground;
+        Detector detector;
+        Filter filter;
+        vector<Object_2D> list_2D;
+
+    public:
+
+        /*Funciton Name: Pipeline(const DisparityEngine& engine, const GroundModel& ground, const Detector& detector, const Filter& filter) */
+        /*Description: constructor from the stages                                                                                                                                                             */
+        /*Input: const DisparityEngine& engine - disparity engine
+                        const GroundModel& ground - ground model
+                        const Detector& detector - object detector
+                        const Filter& filter - object filter of the whole list                                                                                                                      */
+
+        Pipeline(const DisparityEngine& engine, const GroundModel& ground, const Detector& detector, const Filter& filter):
+            engine(engine), ground(ground), detector(detector), filter(filter){}
+
+
+        /*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
+        /*Description: calculate disparity map                                                             */
+        /*Input: Mat img_l - left image
+                        Mat img_r - right image                                                                         */
+        /*Output: Mat disparity                                                                                             */
+
+        Mat CalculateDispMap(Mat img_l, Mat img_r){
+
+            return Stage(engine).CalculateDispMap(img_l, img_r);
+
+        }
+
+
+        /*Funciton Name: FilterGround(Mat& disparity, int min_disparity)               */
+        /*Description: filter ground and background                                                  */
+        /*Input: Mat& disparity - disparity map
+                        int min_disparity - minimal disparity kept                                           */
+        /*Output: void                                                                                                                */
+
+        void FilterGround(Mat& disparity, int min_disparity){
+
+            Stage(ground).FilterGround(disparity, min_disparity);
+
+        }
+
+
+        /*Funciton Name: DetectObject2D(Mat disparity)	                                  */
+        /*Description: Detect objects on the current ground line and filter them   */
+        /*Input: Mat disparity - disparity map with ground removed                  */
+        /*Output: vector<Object_2D>& list_2D, valid until the next frame           */
+
+        vector<Object_2D>& DetectObject2D(Mat disparity){
+
+            float k, b;
+            if(Stage(ground).GroundLine(k, b)) Stage(detector).SetGroundPlane(k, b);
+            list_2D = Stage(detector).DetectObject2D(disparity);
+
+            Stage(filter).UpdateObjectSource(&list_2D);
+            Stage(filter).FilterObjectList();
+
+            return list_2D;
+
+        }
+
+
+        /*Funciton Name: Update2D(Mat img_l, Mat img_r, int min_disparity)         */
+        /*Description: all stages of one frame                                                              */
+        /*Input: Mat img_l - left rectified image
+                        Mat img_r - right rectified image
+                        int min_disparity - minimal disparity kept                                           */
+        /*Output: vector<Object_2D>& list_2D, valid until the next frame           */
+
+        vector<Object_2D>& Update2D(Mat img_l, Mat img_r, int min_disparity){
+
+            Mat disparity = CalculateDispMap(img_l, img_r);
+            FilterGround(disparity, min_disparity);
+            return DetectObject2D(disparity);
+
+        }
+
+
+        /*Funciton Name: UpdateFrameTime(float frame_ms)                              */
+        /*Description: report the end-to-end latency of the last frame            */
+        /*Input: float frame_ms - latency of the whole frame [ms]                    */
+        /*Output: void                                                                                                            */
+
+        void UpdateFrameTime(float frame_ms){
+
+            ReportFrameTime(Stage(engine), frame_ms);
+
+        }
+
+};
+
+
+// Production configuration (config/ransac_fullsize.yml): SGBM, RANSAC ground
+// filter, contour detector and NMS; Detection runs it whenever
+// DetectionFactory::IsProduction holds
+typedef Pipeline<DisparitySGBM, OnlineGround<RANSACGroundFilter>, ContourDetector, NMSFilter> ProductionPipeline;
+
+// Configurable pipeline of Detection, for every other configuration
+typedef Pipeline<RuntimeDisparity, RuntimeGround, Ptr<ObjectDetector>, FilterChain> RuntimePipeline;
@@ -0,0 +1,181 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        SyntheticScene
+*****************************************************************/
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "Utility.h"
+#include "CameraModel.h"
+
+using namespace std;
+using namespace cv;
+
+
+/*****************************************************************
+Structure Name: SyntheticBox
+Description: box obstacle standing on the ground, in the level frame
+                         of the left camera (x right, z forward, meter)
+*****************************************************************/
+
+struct SyntheticBox{
+
+    float x;                    // lateral position of the center
+    float z;                    // distance of the front face
+    float width;
+    float height;
+
+};
+
+
+/*****************************************************************
+Class Name: SyntheticScene
+Description: render rectified stereo pairs of a textured ground plane
+                         with box obstacles, with ground-truth disparity, ground
+                         line and object boxes
+*****************************************************************/
+
+class SyntheticScene{
+
+    private:
+
+        // Camera geometry (output image of the camera model)
+        int width;
+        int height;
+        float f;
+        float cx;
+        float cy;
+        float baseline;
+
+        // Montage
+        float cam_height;                   // camera above ground (m)
+        float cam_theta;                     // pitch (degree), positive looking up
+
+        // Scene
+        float far_distance;               // background wall (m)
+        float travelled;                        // forward motion of the camera (m)
+        vector<SyntheticBox> boxes;
+        Mat disparity_gt;
+        Mat surface_gt;
+
+
+        /*Funciton Name: Texture(float a, float b, unsigned salt)                                    */
+        /*Description: two octaves of value noise on surface coordinates             */
+        /*Input: float a, float b - surface coordinates (m)
+                        unsigned salt - surface index                                                                      */
+        /*Output: uchar intensity                                                                                                    */
+
+        uchar Texture(float a, float b, unsigned salt);
+
+
+        /*Funciton Name: Cast(float u, float v, float offset, float& depth, int& surface)  */
+        /*Description: intersect the ray of pixel (u, v) of a camera shifted by offset
+                                  along x with the scene                                                                   */
+        /*Input: float u, float v - pixel
+                        float offset - camera position along x (m)
+                        float& depth - depth along the optical axis (m)
+                        int& surface - 0 background, 1 ground, 2+ box index                   */
+        /*Output: uchar intensity                                                                                                    */
+
+        uchar Cast(float u, float v, float offset, float& depth, int& surface);
+
+
+    public:
+
+        /*Funciton Name: SyntheticScene()                                                                           */
+        /*Description: Default constructor                                                                            */
+        /*Input: void                                                                                                                      */
+
+        SyntheticScene();
+
+
+        /*Funciton Name: SyntheticScene(CameraModel* cm, string montage)      */
+        /*Description: Constructor with camera model, the camera height is
+                                  abs_init_y of the montage file                                                    */
+        /*Input: CameraModel* cm - pointer to a CameraModel
+                        string montage - path to montage file                                                  */
+
+        SyntheticScene(CameraModel* cm, string montage);
+
+
+        /*Funciton Name: SetPitch(float theta)                                                                   */
+        /*Description: set camera pitch, same convention as MonoCameraModel   */
+        /*Input: float theta - pitch in degree                                                                    */
+        /*Output: void                                                                                                                     */
+
+        void SetPitch(float theta);
+
+
+        /*Funciton Name: AddBox(SyntheticBox box)                                                        */
+        /*Description: add a box obstacle                                                                            */
+        /*Input: SyntheticBox box - box in the level frame                                         */
+        /*Output: void                                                                                                                     */
+
+        void AddBox(SyntheticBox box);
+
+
+        /*Funciton Name: RandomBoxes(int num, unsigned seed, float min_z, float max_z) */
+        /*Description: replace the obstacles with reproducible random boxes      */
+        /*Input: int num - number of boxes
+                        unsigned seed - random seed
+                        float min_z, float max_z - range of distance (m)                           */
+        /*Output: void                                                                                                                     */
+
+        void RandomBoxes(int num, unsigned seed, float min_z=1.5, float max_z=6);
+
+
+        /*Funciton Name: Step(float distance)                                                                 */
+        /*Description: move the camera forward, boxes behind it are dropped  */
+        /*Input: float distance - forward motion (m)                                                  */
+        /*Output: void                                                                                                                     */
+
+        void Step(float distance);
+
+
+        /*Funciton Name: Render(Mat& left, Mat& right)                                               */
+        /*Description: render a rectified pair (CV_8U) and update the ground truth */
+        /*Input: Mat& left - left image
+                        Mat& right - right image                                                                             */
+        /*Output: void                                                                                                                     */
+
+        void Render(Mat& left, Mat& right);
+
+
+        /*Funciton Name: GroundTruth()                                                                             */
+        /*Description: disparity of the last rendered left image (CV_32F, pixel) */
+        /*Input: void                                                                                                                      */
+        /*Output: Mat disparity_gt                                                                                             */
+
+        Mat GroundTruth();
+
+
+        /*Funciton Name: Labels()                                                                                           */
+        /*Description: surface of the last rendered left image (CV_8U), 0 background,
+                                  1 ground, 2+ box index                                                                         */
+        /*Input: void                                                                                                                      */
+        /*Output: Mat surface_gt                                                                                                */
+
+        Mat Labels();
+
+
+        /*Funciton Name: GroundK(), GroundB()                                                              */
+        /*Description: ground line in v-disparity, row = k * disparity + b         */
+        /*Input: void                                                                                                                      */
+        /*Output: float k, float b                                                                                                 */
+
+        float GroundK();
+        float GroundB();
+
+
+        /*Funciton Name: Objects()                                                                                     */
+        /*Description: image boxes of the visible obstacles, in front of the
+                                  camera and inside the image, occlusion is not considered */
+        /*Input: void                                                                                                                      */
+        /*Output: vector<Object_2D> list                                                                             */
+
+        vector<Object_2D> Objects();
+
+};
@@ -0,0 +1,240 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        Tracker
+*****************************************************************/
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "Utility.h"
+#include "Motion.h"
+#include "Config.h"
+
+using namespace std;
+using namespace cv;
+
+
+/*****************************************************************
+Structure Name: Track
+Description: one tracked object, constant velocity in the camera frame
+                         (x right, y down, z forward, meter)
+*****************************************************************/
+
+struct Track{
+
+    int id;
+    KalmanFilter kf;                        // X, Y, Z of the center, vX, vY, vZ
+    Point2f size;                             // width, height (m)
+    int hits;                                     // associated detections
+    int misses;                                // frames without detection or failed verification
+    Object_2D box;                          // predicted image box
+
+};
+
+
+
+/*****************************************************************
+Class Name: Tracker
+Description: multi-object tracker: constant-velocity Kalman filter per
+                         object compensated by the ego-motion, association of
+                         detections by IoU with the Hungarian method, and
+                         verification of the predicted boxes on the disparity map
+                         between detections
+*****************************************************************/
+
+class Tracker{
+
+    private:
+
+        // Reprojection (Q) and its inverse, offset of the disparity map
+        Matx44d q;
+        Matx44d q_inv;
+        int offset_x;
+        int offset_y;
+
+        // Parameters
+        int detect_interval;                       // frames between full detections
+        float iou_threshold;                      // minimal IoU of an association
+        int max_misses;                              // frames without support before a track is dropped
+        int min_hits;                                    // detections before a track is reported
+        float process_noise;                      // acceleration (m/s^2)
+        float sigma_pixel;                           // detection box error (pixel)
+        float sigma_disparity;                    // detection disparity error (pixel)
+        float verify_confidence;               // non-zero ratio of a verified box
+        float verify_tolerance;                  // disparity error of a verified box
+
+        // Ego-motion source and pose of the last frame
+        Motion* ego;
+        Point3f last_position;
+        float last_yaw;
+
+        vector<Track> tracks;
+        int next_id;
+        BoxStatistics stats;
+
+        // State of the detection schedule
+        int64 last_tick;
+        int since_detection;
+        bool verify_failed;
+
+        // Statistics
+        long num_frames;
+        long num_detections;
+        double total_time;                          // ms of tracking
+        double last_time;
+
+
+        /*Funciton Name: ToCamera(float u, float v, float d)                                        */
+        /*Description: reproject an image point with disparity                             */
+        /*Input: float u, float v - pixel of the disparity map
+                        float d - disparity                                                                                     */
+        /*Output: Point3f point in the camera frame                                                    */
+
+        Point3f ToCamera(float u, float v, float d);
+
+
+        /*Funciton Name: ToImage(Point3f p)                                                                   */
+        /*Description: project a point of the camera frame                                   */
+        /*Input: Point3f p - point in the camera frame                                             */
+        /*Output: Point3f (u, v, d) on the disparity map                                             */
+
+        Point3f ToImage(Point3f p);
+
+
+        /*Funciton Name: UpdateBox(Track& track)                                                      */
+        /*Description: image box of the state of a track                                       */
+        /*Input: Track& track - track                                                                              */
+        /*Output: void                                                                                                               */
+
+        void UpdateBox(Track& track);
+
+
+        /*Funciton Name: Measure(Track& track, Point3f center)                                   */
+        /*Description: Kalman correction with a measured center, the error grows
+                                  with the depth as for the disparity                                 */
+        /*Input: Track& track - track
+                        Point3f center - measured center (m)                                                    */
+        /*Output: void                                                                                                               */
+
+        void Measure(Track& track, Point3f center);
+
+
+        /*Funciton Name: Hungarian(const vector<vector<float>>& cost)                        */
+        /*Description: minimal cost assignment of a rectangular matrix             */
+        /*Input: const vector<vector<float>>& cost - rows x cols                                */
+        /*Output: vector<int> column of each row, -1 if none                                  */
+
+        static vector<int> Hungarian(const vector<vector<float>>& cost);
+
+
+    public:
+
+        /*Funciton Name: Tracker()                                                                                     */
+        /*Description: Default constructor                                                                     */
+        /*Input: void                                                                                                               */
+
+        Tracker();
+
+
+        /*Funciton Name: Tracker(Mat Q, int offset_x, int offset_y, string config)  */
+        /*Description: Constructor with the reprojection of the disparity map  */
+        /*Input: Mat Q - reprojection matrix
+                        int offset_x, int offset_y - offset of the disparity map in the image
+                        string config - path to configuration file                                           */
+
+        Tracker(Mat Q, int offset_x, int offset_y, string config);
+
+
+        /*Funciton Name: Tracker(Mat Q, int offset_x, int offset_y, const TrackerParams& params) */
+        /*Description: Constructor with the reprojection of the disparity map and
+                                  parsed configuration                                                                  */
+        /*Input: Mat Q - reprojection matrix
+                        int offset_x, int offset_y - offset of the disparity map in the image
+                        const TrackerParams& params - tracker parameters                            */
+
+        Tracker(Mat Q, int offset_x, int offset_y, const TrackerParams& params);
+
+
+        /*Funciton Name: SetDetectInterval(int interval)                                             */
+        /*Description: frames between full detections                                          */
+        /*Input: int interval - frames, 1: detect every frame                                    */
+        /*Output: void                                                                                                               */
+
+        void SetDetectInterval(int interval);
+
+
+        /*Funciton Name: SetEgoSource(Motion* ego)                                                      */
+        /*Description: absolute T265 motion (x right, y up, z backward, yaw in
+                                  degree positive to the right) to compensate the tracks */
+        /*Input: Motion* ego - pointer to the motion, NULL for a static camera      */
+        /*Output: void                                                                                                               */
+
+        void SetEgoSource(Motion* ego);
+
+
+        /*Funciton Name: Predict()                                                                                     */
+        /*Description: move all tracks to the current frame: ego-motion since the
+                                  last frame, then constant velocity                                          */
+        /*Input: void                                                                                                               */
+        /*Output: void                                                                                                               */
+
+        void Predict();
+
+
+        /*Funciton Name: NeedDetection()                                                                      */
+        /*Description: whether the current frame needs a full detection: every
+                                  detect_interval frames or after a failed verification     */
+        /*Input: void                                                                                                               */
+        /*Output: bool result - 1: detect                                                                           */
+
+        bool NeedDetection();
+
+
+        /*Funciton Name: Correct(const vector<Object_2D>& list)                                   */
+        /*Description: associate a detection list to the predicted tracks, start
+                                  tracks for new objects and drop lost ones                          */
+        /*Input: const vector<Object_2D>& list - detected objects                                */
+        /*Output: void                                                                                                               */
+
+        void Correct(const vector<Object_2D>& list);
+
+
+        /*Funciton Name: Verify(Mat disparity)                                                                */
+        /*Description: check the predicted boxes on the disparity map instead of a
+                                  detection: enough pixels and median disparity close to the
+                                  prediction correct the depth, otherwise detection is due */
+        /*Input: Mat disparity - disparity map, ground removed                             */
+        /*Output: void                                                                                                               */
+
+        void Verify(Mat disparity);
+
+
+        /*Funciton Name: List2D(), IDs()                                                                           */
+        /*Description: boxes and IDs of the confirmed tracks supported in this frame */
+        /*Input: void                                                                                                               */
+        /*Output: vector<Object_2D> list, vector<int> ids                                            */
+
+        vector<Object_2D> List2D();
+        vector<int> IDs();
+
+
+        /*Funciton Name: DutyCycle()                                                                                */
+        /*Description: fraction of frames with full detection                                  */
+        /*Input: void                                                                                                               */
+        /*Output: float ratio                                                                                                       */
+
+        float DutyCycle();
+
+
+        /*Funciton Name: TrackTime(), MeanTrackTime()                                               */
+        /*Description: tracking time of the last frame and mean per frame (ms),
+                                  detection itself excluded                                                           */
+        /*Input: void                                                                                                               */
+        /*Output: double time                                                                                                    */
+
+        double TrackTime();
+        double MeanTrackTime();
+
+};
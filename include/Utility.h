@@ -44,6 +44,23 @@ struct Object_2D{
 
 
 
+/*****************************************************************
+Structure Name: Stixel
+Description: vertical obstacle segment of a column band in 2D
+*****************************************************************/
+
+struct Stixel{
+
+    int column;                 // first column of the band
+    int width;
+    int top;
+    int bottom;
+    float disparity;
+
+};
+
+
+
 /*****************************************************************
 Structure Name: EulerAngles
 Description: structure to describe an Euler angle
@@ -179,7 +196,7 @@ class MedianFilter:public ValueFilter{
 
     private:
 
-        queue<int> history;
+        queue<float> history;
 
     public:
 
@@ -204,8 +221,219 @@ class MedianFilter:public ValueFilter{
 
         int Filter(int input);
 
+
+        /*Funciton Name: Filter(float input)                                  								    */
+        /*Description: Perform median filter on float values                              */
+        /*Input: float input - input value                                                                       */   
+        /*Output: float output_value                                                                             */
+
+        float Filter(float input);
+
 };
 
 
 
+/*****************************************************************
+Class Name: BitMask
+Description: binary mask packed 64 pixels per word, bit c%64 of word c/64
+                         of a row is column c; bits beyond cols stay zero
+*****************************************************************/
+
+class BitMask{
+
+    private:
+
+        int rows;
+        int cols;
+        int words;                                  // words per row
+        vector<uint64_t> bits;
+
+        // Buffers of the column pass, kept between calls
+        vector<uint64_t> forward;
+        vector<uint64_t> backward;
+        vector<uint64_t> pad_row;
+
+
+        /*Funciton Name: Extract(const uint64_t* row, int length, int position, bool fill) */
+        /*Description: 64 bits of a row starting at a bit position, bits outside
+                                  the row are fill                                                                                   */
+        /*Input: const uint64_t* row - packed row
+                        int length - bits of the row
+                        int position - first bit, may be negative
+                        bool fill - value outside the row                                                          */
+        /*Output: uint64_t word                                                                                                     */
+
+        static uint64_t Extract(const uint64_t* row, int length, int position, bool fill);
+
+
+        /*Funciton Name: Horizontal(int k, bool erode)                                               */
+        /*Description: AND (erode) or OR (dilate) of k neighbours along the rows,
+                                  by doubling the window, log2(k) word passes                     */
+        /*Input: int k - kernel width
+                        bool erode - 1: AND, 0: OR                                                                */
+        /*Output: void                                                                                                                */
+
+        void Horizontal(int k, bool erode);
+
+
+        /*Funciton Name: Vertical(int k, bool erode)                                                      */
+        /*Description: AND (erode) or OR (dilate) of k neighbours along the columns,
+                                  van Herk/Gil-Werman on whole rows of words                     */
+        /*Input: int k - kernel height
+                        bool erode - 1: AND, 0: OR                                                                */
+        /*Output: void                                                                                                                */
+
+        void Vertical(int k, bool erode);
+
+
+    public:
+
+        /*Funciton Name: BitMask()                                                                                 */
+        /*Description: Default constructor, empty mask                                          */
+        /*Input: void                                                                                                               */
+
+        BitMask();
+
+
+        /*Funciton Name: BitMask(int rows, int cols)                                                   */
+        /*Description: Constructor of a cleared mask                                             */
+        /*Input: int rows, int cols - mask size                                                                */
+
+        BitMask(int rows, int cols);
+
+
+        /*Funciton Name: Create(int rows, int cols)                                                     */
+        /*Description: clear the mask, reallocate only if the size changes           */
+        /*Input: int rows, int cols - mask size                                                                */
+        /*Output: void                                                                                                                */
+
+        void Create(int rows, int cols);
+
+
+        /*Funciton Name: Rows(), Cols()                                                                           */
+        /*Description: mask size                                                                                          */
+        /*Input: void                                                                                                               */
+        /*Output: int rows, int cols                                                                                           */
+
+        inline int Rows() const{ return rows; }
+        inline int Cols() const{ return cols; }
+
 
+        /*Funciton Name: Set(int r, int c)                                                                     */
+        /*Description: set one pixel                                                                                 */
+        /*Input: int r, int c - pixel                                                                                   */
+        /*Output: void                                                                                                                */
+
+        inline void Set(int r, int c){ bits[r*words + (c>>6)] |= uint64_t(1) << (c&63); }
+
+
+        /*Funciton Name: Erode(Size kernel), Dilate(Size kernel)                              */
+        /*Description: rectangular erosion/dilation, anchor at the kernel center and
+                                  pixels outside the mask ignored, as cv::erode/cv::dilate   */
+        /*Input: Size kernel - kernel size                                                                        */
+        /*Output: void                                                                                                                */
+
+        void Erode(Size kernel);
+        void Dilate(Size kernel);
+
+
+        /*Funciton Name: Count(), Count(Rect box)                                                     */
+        /*Description: set pixels of the mask or of a box, by popcount                  */
+        /*Input: Rect box - area to be counted                                                             */
+        /*Output: int count                                                                                                        */
+
+        int Count() const;
+        int Count(Rect box) const;
+
+
+        /*Funciton Name: Runs(int r, vector<Range>& runs)                                          */
+        /*Description: append the runs of set pixels of a row, end exclusive       */
+        /*Input: int r - row
+                        vector<Range>& runs - output runs                                                         */
+        /*Output: void                                                                                                                */
+
+        void Runs(int r, vector<Range>& runs) const;
+
+
+        /*Funciton Name: ToMat()                                                                                      */
+        /*Description: unpack to a CV_8U mask (0/255)                                          */
+        /*Input: void                                                                                                               */
+        /*Output: Mat mask                                                                                                         */
+
+        Mat ToMat() const;
+
+};
+
+
+
+/*****************************************************************
+Class Name: BoxStatistics
+Description: per-frame statistics of the non-zero pixels of a CV_8U map
+                         in any box: integral images for count and sum, an integral
+                         histogram over coarse tiles for median and max, so a
+                         query only scans the partial tiles on the box border
+*****************************************************************/
+
+class BoxStatistics{
+
+    private:
+
+        Mat source;
+        int tile;
+        int tiles_x;
+        int tiles_y;
+        Mat count_integral;                 // CV_32S, non-zero pixels
+        Mat sum_integral;                     // CV_32S, sum of values
+        vector<int> histogram;            // (tiles_y+1) x (tiles_x+1) x 256, integral over tiles
+        bool has_histogram;
+
+
+        /*Funciton Name: Histogram(Rect box, int* hist)                                               */
+        /*Description: histogram of the non-zero values in a box, full tiles from
+                                  the integral histogram, border pixels scanned                */
+        /*Input: Rect box - box inside the map
+                        int* hist - 256 bins                                                                                 */
+        /*Output: void                                                                                                                */
+
+        void Histogram(Rect box, int* hist) const;
+
+
+    public:
+
+        /*Funciton Name: BoxStatistics(int tile)                                                             */
+        /*Description: Constructor with the tile size of the histogram              */
+        /*Input: int tile - tile size (pixel)                                                                      */
+
+        BoxStatistics(int tile=32);
+
+
+        /*Funciton Name: Update(const Mat& disparity, bool histogram)                  */
+        /*Description: build the integral images of a new map                             */
+        /*Input: const Mat& disparity - CV_8U map, 0 is no value
+                        bool histogram - also build the tile histograms for
+                                                  Median and Max                                                         */
+        /*Output: void                                                                                                                */
+
+        void Update(const Mat& disparity, bool histogram=true);
+
+
+        /*Funciton Name: Count(Rect box), Confidence(Rect box)                              */
+        /*Description: non-zero pixels of a box and their ratio to its area, O(1) */
+        /*Input: Rect box - box, clipped to the map                                                   */
+        /*Output: int count, float confidence                                                                    */
+
+        int Count(Rect box) const;
+        float Confidence(Rect box) const;
+
+
+        /*Funciton Name: Mean(Rect box), Median(Rect box), Max(Rect box)          */
+        /*Description: statistics of the non-zero values of a box, 0 if none;
+                                  Median is the value at index count/2 of the sorted values */
+        /*Input: Rect box - box, clipped to the map                                                   */
+        /*Output: int value                                                                                                         */
+
+        int Mean(Rect box) const;
+        int Median(Rect box) const;
+        int Max(Rect box) const;
+
+};
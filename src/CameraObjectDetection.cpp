@@ -43,6 +43,11 @@ CameraObjectDetection::CameraObjectDetection(string config){
 
      fs["MONO_DETECTION"]>>MONO_DETECTION;
 
+    fs["READ_FROM_SYNTHETIC"]>>READ_FROM_SYNTHETIC;
+    fs["synthetic_pitch"]>>synthetic_pitch;
+    fs["synthetic_boxes"]>>synthetic_boxes;
+    fs["synthetic_speed"]>>synthetic_speed;
+
     InitMotion();
     InitVisual();
     InitObjects();
@@ -99,19 +104,23 @@ void CameraObjectDetection::InitVisual(){
 void CameraObjectDetection::InitObjects(){
 
     if(IS_MONO){
-        mt265 = MonoCameraModel(PATH_STEREO_CALIBRATION);
-        mt265.SetHeightSource(&abs_motion.position.y);
-        mt265.SetThetaSource(&abs_motion.rotation.roll);
+        mt265 = makePtr<MonoCameraModel>(PATH_STEREO_CALIBRATION);
+        mt265->SetHeightSource(&abs_motion.position.y);
+        mt265->SetThetaSource(&abs_motion.rotation.roll);
         if(RUN_ALGORITHM){
-            mlane = MonoLane(&mt265, PATH_LANE);
-            detector = Detection(&mlane, PATH_DETECTION_CONFIG);
+            mlane = makePtr<MonoLane>(mt265.get(), PATH_LANE);
+            detector = makePtr<Detection>(mlane.get(), PATH_DETECTION_CONFIG);
+            detector->SetPoseSource(&abs_motion.position.y, &abs_motion.rotation.roll);
+            detector->SetEgoSource(&abs_motion);
         }
     }
     else{
-        t265 = CameraModel(PATH_STEREO_CALIBRATION);
+        t265 = makePtr<CameraModel>(PATH_STEREO_CALIBRATION);
         if(RUN_ALGORITHM){
-            lane = CameraLane(&t265, PATH_LANE);
-            detector = Detection(&lane, PATH_DETECTION_CONFIG);
+            lane = makePtr<CameraLane>(t265.get(), PATH_LANE);
+            detector = makePtr<Detection>(lane.get(), PATH_DETECTION_CONFIG);
+            detector->SetPoseSource(&abs_motion.position.y, &abs_motion.rotation.roll);
+            detector->SetEgoSource(&abs_motion);
         }
     }
     rs_t265 = RScamera(PATH_STEREO_CALIBRATION, SAMPLE_RATE);
@@ -121,6 +130,12 @@ void CameraObjectDetection::InitObjects(){
 
     if(MONO_DETECTION)  md = MonoDetector();
 
+    if(READ_FROM_SYNTHETIC){
+        scene = SyntheticScene(IS_MONO ? (CameraModel*)mt265.get() : t265.get(), PATH_MONTAGE);
+        scene.SetPitch(synthetic_pitch);
+        scene.RandomBoxes(synthetic_boxes, 0);
+    }
+
 }
 
 
@@ -131,6 +146,11 @@ void CameraObjectDetection::InitObjects(){
 
 void CameraObjectDetection::Run(){
 
+    if(READ_FROM_SYNTHETIC){
+        RunSynthetic();
+        return;
+    }
+
     // Start camera pipeline
     rs_t265.Start();
 
@@ -196,24 +216,35 @@ void CameraObjectDetection::RunAlgorithm(Mat left, Mat right){
 
     start_raw = clock();
 
-    if(IS_MONO) mlane.UpdateLane();                                         // MonoLane
-    else lane.UpdateLane();                                             // Lane
+    if(IS_MONO) mlane->UpdateLane();                                         // MonoLane
+    else lane->UpdateLane();                                             // Lane
 
-    abs_motion.Update(rs_t265.IMU());           // Absolute motion
+    // Rendered frames have no IMU and are already rectified
+    if(!READ_FROM_SYNTHETIC){
 
-    stop_raw =clock();
+        abs_motion.Update(rs_t265.IMU());           // Absolute motion
 
-    // Print motion
-    rs_t265.IMU().PrintMotion("Ego");
-    abs_motion.PrintMotion("Abs");
+        stop_raw =clock();
 
-    // Rectification
-    start_rectify = clock();
+        // Print motion
+        rs_t265.IMU().PrintMotion("Ego");
+        abs_motion.PrintMotion("Abs");
 
-    if(IS_MONO) mt265.Rectify(left, right);
-    else t265.Rectify(left, right);
+        // Rectification
+        start_rectify = clock();
 
-    stop_rectify = clock();
+        if(IS_MONO) mt265->Rectify(left, right);
+        else t265->Rectify(left, right);
+
+        stop_rectify = clock();
+
+    }
+    else{
+
+        stop_raw = clock();
+        start_rectify = stop_rectify = clock();
+
+    }
 
     if(MONO_DETECTION){
 
@@ -223,21 +254,21 @@ void CameraObjectDetection::RunAlgorithm(Mat left, Mat right){
     else{
 
         // Detection            
-        detector.Update2D(left, right);
-        detector.Update3D();
-        detector.PrintList3D();
+        detector->Update2D(left, right);
+        detector->Update3D();
+        detector->PrintList3D();
 
         // Transform
-        list_3D = cam_vehicle.PerspectiveTransform(detector.List3D());
-        detector.PrintList3D(list_3D);
+        list_3D = cam_vehicle.PerspectiveTransform(detector->List3D());
+        Detection::PrintList3D(list_3D);
 
         // Visualize detection
         if(VISUAL_DETECTION){
             Mat  visual_left;
             cvtColor(left, visual_left, COLOR_GRAY2RGB);
             // if(disp.IsStable()) disp.Rotate(visual_left, abs_motion.rotation.yaw);
-            vis.DrawBox(visual_left, detector.List2D());
-            if(VISUAL_LANE&&IS_MONO) vis.DrawLane(visual_left, mlane);
+            vis.DrawBox(visual_left, detector->List2D());
+            if(VISUAL_LANE&&IS_MONO) vis.DrawLane(visual_left, *mlane);
             imshow("detection", visual_left);
         } 
 
@@ -247,6 +278,51 @@ void CameraObjectDetection::RunAlgorithm(Mat left, Mat right){
 }
 
 
+/*Funciton Name: RunSynthetic()                                                                         */
+/*Description: Run detection pipeline on rendered frames, which are
+                          already rectified, and print the ground truth                */
+/*Input: void                                                                                                               */
+/*Output: void                                                                                                           */
+
+void CameraObjectDetection::RunSynthetic(){
+
+    bool run_loop = true;
+    unsigned seed = 0;
+
+    while(run_loop){
+
+        start_raw = clock();
+
+        Mat left, right;
+        scene.Render(left, right);
+
+        stop_raw = clock();
+
+        if(VISUAL_ORIGINAL){
+            imshow("Original Left", left);
+            imshow("Original Right", right);
+        }
+
+        if(RUN_ALGORITHM){
+            RunAlgorithm(left, right);
+            cout<<"Synthetic ground line\tk: "<<scene.GroundK()<<"\tb: "<<scene.GroundB()<<endl;
+            Detection::PrintList2D(scene.Objects());
+        }
+
+        PrintProcessingTime();
+
+        // Drive forward, new obstacles once all are passed
+        scene.Step(synthetic_speed);
+        if(scene.Objects().empty()) scene.RandomBoxes(synthetic_boxes, ++seed);
+
+        char key = char(cv::waitKey(1));
+        if (key=='q' || key=='Q') run_loop = false;
+
+    }
+
+}
+
+
 /*Funciton Name: PrintProcessingTime()                                                     */
 /*Description: Print processing time in the console                                 */
 /*Input: void                                                                                                               */        
@@ -277,6 +353,8 @@ void CameraObjectDetection::PrintProcessingTime(){
         cout<<"Ground fIlter:\t"<<(t_filter)/double(CLOCKS_PER_SEC)*1000<<"ms\t"<<p_filter<<"%"<<endl;
         cout<<"Detection:\t"<<(t_detection)/double(CLOCKS_PER_SEC)*1000<<"ms\t"<<p_detection<<"%"<<endl;
         cout<<"Total:\t\t"<<(t_total)/double(CLOCKS_PER_SEC)*1000<<"ms"<<endl;
+        if(RUN_ALGORITHM)   cout<<"Ground skip:\t"<<detector->GroundSkipRatio()*100<<"%\t"<<detector->GroundEstimationTime()<<"ms"<<endl;
+        if(RUN_ALGORITHM)   cout<<"Detection duty:\t"<<detector->DetectionDutyCycle()*100<<"%\t"<<detector->TrackTime()<<"ms tracking"<<endl;
         cout<<"################################################################"<<endl;
 
     }
@@ -0,0 +1,288 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        Config
+*****************************************************************/
+
+#include <map>
+#include <mutex>
+
+#include "Config.h"
+
+
+// read an optional value, keep the current one if the key is missing
+template<typename T> static void Read(FileStorage& fs, const string& key, T& value){
+    if(!fs[key].empty()) fs[key] >> value;
+}
+
+static void Read(FileStorage& fs, const string& key, bool& value){
+    int temp = value;
+    Read(fs, key, temp);
+    value = temp!=0;
+}
+
+
+/*Funciton Name: Replace(const string& config, const string& key, T& value, T usable)  */
+/*Description: report an invalid value and replace it                                       */
+/*Input: const string& config - path to configuration file
+                const string& key - key of the value
+                T& value - invalid value
+                T usable - replacement                                                                               */
+/*Output: void                                                                                                                     */
+
+template<typename T> static void Replace(const string& config, const string& key, T& value, T usable){
+
+    cout<<"Config: invalid "<<key<<" = "<<value<<" in "<<config<<", "<<usable<<" used"<<endl;
+    value = usable;
+
+}
+
+
+/*Funciton Name: DetectionConfig()                                                                    */
+/*Description: Default constructor, all parameters at their default        */
+/*Input: void                                                                                                               */
+
+DetectionConfig::DetectionConfig(){
+
+    detection = DetectionParams();
+    disparity = DisparityParams();
+    ground = GroundParams();
+    detector = DetectorParams();
+    filter = ObjectFilterParams();
+    tracker = TrackerParams();
+
+    // MIDDLEBURY if no profile is given (former default)
+    disparity.elas = Elas::parameters(Elas::MIDDLEBURY);
+    disparity.elas_upsample_sigma = 10;
+    disparity.scheduler_upgrade_margin = 0.8;
+    disparity.scheduler_window = 20;
+    disparity.scheduler_probe_interval = 100;
+
+    // Prediction from pose, as ransac_fullsize.yml
+    ground.ground_max_age = 10;
+    ground.ground_verify_step = 8;
+    ground.ground_verify_tolerance = 2;
+    ground.ground_verify_ratio = 0.8;
+
+    // Former hard-coded slice morphology and stixel settings, for files
+    // without these keys (contour.yml, ransac_halfsize.yml)
+    detector.erode_kernel = 20;
+    detector.dilate_kernel = 30;
+    detector.stixel_width = 5;
+    detector.stixel_min_count = 30;
+    detector.stixel_smooth_penalty = 5;
+    detector.stixel_jump_penalty = 50;
+    detector.stixel_max_gap = 3;
+    detector.stixel_group_tolerance = 2;
+    detector.stixel_min_group = 2;
+
+    tracker.track_detect_interval = 1;
+    tracker.track_iou_threshold = 0.3;
+    tracker.track_max_misses = 3;
+    tracker.track_min_hits = 1;
+    tracker.track_process_noise = 2;
+    tracker.track_sigma_pixel = 2;
+    tracker.track_sigma_disparity = 1;
+    tracker.track_verify_confidence = 0.3;
+    tracker.track_verify_tolerance = 2;
+
+}
+
+
+/*Funciton Name: DetectionConfig(string config)                                               */
+/*Description: Constructor from configuration file                                      */
+/*Input: string config - path to configuration file                                          */
+
+DetectionConfig::DetectionConfig(string config): DetectionConfig(){
+
+    FileStorage fs(config, FileStorage::READ);
+    if(!fs.isOpened()) cout<<"Config: cannot open "<<config<<endl;
+
+    // Pipeline
+    Read(fs, "FILTER_GROUND", detection.FILTER_GROUND);
+    Read(fs, "FILTER_BACKGROUND", detection.FILTER_BACKGROUND);
+    Read(fs, "FILTER_LANE", detection.FILTER_LANE);
+    Read(fs, "DISPARITY_TYPE", detection.DISPARITY_TYPE);
+    Read(fs, "DISPARITY_SCHEDULER", detection.DISPARITY_SCHEDULER);
+    Read(fs, "GROUND_FILTER_TYPE", detection.GROUND_FILTER_TYPE);
+    Read(fs, "ONLINE_GROUND_FILTER_TYPE", detection.ONLINE_GROUND_FILTER_TYPE);
+    Read(fs, "DETECTOR_TYPE", detection.DETECTOR_TYPE);
+    Read(fs, "NUM_OF_RANSAC_FILTERING", detection.NUM_OF_RANSAC_FILTERING);
+    Read(fs, "GROUND_PREDICTION", detection.GROUND_PREDICTION);
+    Read(fs, "TRACKING", detection.TRACKING);
+
+    // Disparity
+    Read(fs, "pre_gaussian_kernel", disparity.pre_gaussian_kernel);
+    Read(fs, "pre_median_kernel", disparity.pre_median_kernel);
+    Read(fs, "max_disparity", disparity.max_disparity);
+    Read(fs, "window_size", disparity.window_size);
+    Read(fs, "prefilter_size", disparity.prefilter_size);
+    Read(fs, "prefilter_cap", disparity.prefilter_cap);
+    Read(fs, "texture_threshold", disparity.texture_threshold);
+    Read(fs, "uniqueness_ratio", disparity.uniqueness_ratio);
+    Read(fs, "wls_lambda", disparity.wls_lambda);
+    Read(fs, "wls_sigma", disparity.wls_sigma);
+    Read(fs, "speckle_window", disparity.speckle_window);
+    Read(fs, "speckle_range", disparity.speckle_range);
+
+    // ELAS profile, the override keys are the Elas parameter names with prefix "elas_"
+    string profile;
+    Read(fs, "elas_profile", profile);
+    if(profile=="ROBOTICS") disparity.elas = Elas::parameters(Elas::ROBOTICS);
+    Elas::parameters& elas = disparity.elas;
+    Read(fs, "elas_support_threshold", elas.support_threshold);
+    Read(fs, "elas_support_texture", elas.support_texture);
+    Read(fs, "elas_candidate_stepsize", elas.candidate_stepsize);
+    Read(fs, "elas_incon_window_size", elas.incon_window_size);
+    Read(fs, "elas_incon_threshold", elas.incon_threshold);
+    Read(fs, "elas_incon_min_support", elas.incon_min_support);
+    Read(fs, "elas_add_corners", elas.add_corners);
+    Read(fs, "elas_grid_size", elas.grid_size);
+    Read(fs, "elas_beta", elas.beta);
+    Read(fs, "elas_gamma", elas.gamma);
+    Read(fs, "elas_sigma", elas.sigma);
+    Read(fs, "elas_sradius", elas.sradius);
+    Read(fs, "elas_match_texture", elas.match_texture);
+    Read(fs, "elas_lr_threshold", elas.lr_threshold);
+    Read(fs, "elas_speckle_sim_threshold", elas.speckle_sim_threshold);
+    Read(fs, "elas_speckle_size", elas.speckle_size);
+    Read(fs, "elas_ipol_gap_width", elas.ipol_gap_width);
+    Read(fs, "elas_filter_median", elas.filter_median);
+    Read(fs, "elas_filter_adaptive_mean", elas.filter_adaptive_mean);
+    Read(fs, "elas_subsampling", elas.subsampling);
+    Read(fs, "elas_temporal_support", elas.temporal_support);
+    Read(fs, "elas_temporal_search_radius", elas.temporal_search_radius);
+    Read(fs, "elas_temporal_tile_size", elas.temporal_tile_size);
+    Read(fs, "elas_temporal_min_confirmed", elas.temporal_min_confirmed);
+    Read(fs, "elas_temporal_refresh", elas.temporal_refresh);
+    Read(fs, "elas_temporal_empty_interval", elas.temporal_empty_interval);
+    Read(fs, "elas_temporal_new_stride", elas.temporal_new_stride);
+    Read(fs, "elas_upsample_sigma", disparity.elas_upsample_sigma);
+
+    Read(fs, "scheduler_deadline_ms", disparity.scheduler_deadline_ms);
+    Read(fs, "scheduler_upgrade_margin", disparity.scheduler_upgrade_margin);
+    Read(fs, "scheduler_window", disparity.scheduler_window);
+    Read(fs, "scheduler_probe_interval", disparity.scheduler_probe_interval);
+    Read(fs, "scheduler_modes", disparity.scheduler_modes);
+
+    // Ground
+    Read(fs, "ground_tolerance", ground.ground_tolerance);
+    Read(fs, "min_count", ground.min_count);
+    Read(fs, "max_disparity", ground.max_disparity);
+    Read(fs, "min_disparity", ground.min_disparity);
+    Read(fs, "hough_min_count", ground.hough_min_count);
+    Read(fs, "hough_min_length", ground.hough_min_length);
+    Read(fs, "hough_max_gap", ground.hough_max_gap);
+    Read(fs, "num_samples", ground.num_samples);
+    Read(fs, "distance_threshold", ground.distance_threshold);
+    Read(fs, "start_row", ground.start_row);
+    Read(fs, "start_column", ground.start_column);
+    Read(fs, "max_iteration", ground.max_iteration);
+    Read(fs, "num_median_filter", ground.num_median_filter);
+    Read(fs, "ransac_seed", ground.ransac_seed);
+    Read(fs, "huber_delta", ground.huber_delta);
+    Read(fs, "irls_iterations", ground.irls_iterations);
+    Read(fs, "ground_max_age", ground.ground_max_age);
+    Read(fs, "ground_verify_step", ground.ground_verify_step);
+    Read(fs, "ground_verify_tolerance", ground.ground_verify_tolerance);
+    Read(fs, "ground_verify_ratio", ground.ground_verify_ratio);
+
+    // Detector
+    Read(fs, "min_depth", detector.min_depth);
+    Read(fs, "depth_step", detector.depth_step);
+    Read(fs, "num_of_waypoints", detector.num_of_waypoints);
+    Read(fs, "DISPARITY_CALC_TYPE", detector.DISPARITY_CALC_TYPE);
+    Read(fs, "od_pre_median_kernel", detector.od_pre_median_kernel);
+    Read(fs, "median_kernel", detector.median_kernel);
+    Read(fs, "canny_threshold", detector.canny_threshold);
+    Read(fs, "erode_kernel", detector.erode_kernel);
+    Read(fs, "dilate_kernel", detector.dilate_kernel);
+    Read(fs, "stixel_width", detector.stixel_width);
+    Read(fs, "stixel_min_count", detector.stixel_min_count);
+    Read(fs, "stixel_smooth_penalty", detector.stixel_smooth_penalty);
+    Read(fs, "stixel_jump_penalty", detector.stixel_jump_penalty);
+    Read(fs, "stixel_group_tolerance", detector.stixel_group_tolerance);
+    Read(fs, "stixel_min_group", detector.stixel_min_group);
+    Read(fs, "stixel_max_gap", detector.stixel_max_gap);
+    Read(fs, "ground_tolerance", detector.ground_tolerance);
+
+    // Object filters
+    Read(fs, "NMS_threshold", filter.NMS_threshold);
+    Read(fs, "confidence_threshold", filter.confidence_threshold);
+    Read(fs, "min_width", filter.min_width);
+    Read(fs, "min_height", filter.min_height);
+    Read(fs, "max_width", filter.max_width);
+    Read(fs, "max_height", filter.max_height);
+
+    // Tracker
+    Read(fs, "track_detect_interval", tracker.track_detect_interval);
+    Read(fs, "track_iou_threshold", tracker.track_iou_threshold);
+    Read(fs, "track_max_misses", tracker.track_max_misses);
+    Read(fs, "track_min_hits", tracker.track_min_hits);
+    Read(fs, "track_process_noise", tracker.track_process_noise);
+    Read(fs, "track_sigma_pixel", tracker.track_sigma_pixel);
+    Read(fs, "track_sigma_disparity", tracker.track_sigma_disparity);
+    Read(fs, "track_verify_confidence", tracker.track_verify_confidence);
+    Read(fs, "track_verify_tolerance", tracker.track_verify_tolerance);
+
+    fs.release();
+
+    Validate(config);
+
+}
+
+
+/*Funciton Name: Validate(string config)                                                            */
+/*Description: report invalid values and replace them with usable ones */
+/*Input: string config - path to configuration file, for the messages     */
+/*Output: void                                                                                                               */
+
+void DetectionConfig::Validate(string config){
+
+    // Unknown selections fall back to the first choice
+    if(detection.DISPARITY_TYPE<0 || detection.DISPARITY_TYPE>2) Replace(config, "DISPARITY_TYPE", detection.DISPARITY_TYPE, 0);
+    if(detection.DETECTOR_TYPE<0 || detection.DETECTOR_TYPE>1) Replace(config, "DETECTOR_TYPE", detection.DETECTOR_TYPE, 0);
+    if(detection.GROUND_FILTER_TYPE<0 || detection.GROUND_FILTER_TYPE>1) Replace(config, "GROUND_FILTER_TYPE", detection.GROUND_FILTER_TYPE, 0);
+    if(detection.ONLINE_GROUND_FILTER_TYPE<0 || detection.ONLINE_GROUND_FILTER_TYPE>2) Replace(config, "ONLINE_GROUND_FILTER_TYPE", detection.ONLINE_GROUND_FILTER_TYPE, 0);
+    if(detector.DISPARITY_CALC_TYPE<0 || detector.DISPARITY_CALC_TYPE>2) Replace(config, "DISPARITY_CALC_TYPE", detector.DISPARITY_CALC_TYPE, 0);
+
+    // SGBM and BM match odd windows only
+    if(disparity.window_size>0 && disparity.window_size%2==0) Replace(config, "window_size", disparity.window_size, disparity.window_size + 1);
+
+    // Ratios
+    if(filter.NMS_threshold<0 || filter.NMS_threshold>1) Replace(config, "NMS_threshold", filter.NMS_threshold, min(max(filter.NMS_threshold, 0.f), 1.f));
+    if(filter.confidence_threshold<0 || filter.confidence_threshold>1) Replace(config, "confidence_threshold", filter.confidence_threshold, min(max(filter.confidence_threshold, 0.f), 1.f));
+    if(tracker.track_iou_threshold<0 || tracker.track_iou_threshold>1) Replace(config, "track_iou_threshold", tracker.track_iou_threshold, 0.3f);
+
+    // Sizes and strides of at least one
+    disparity.scheduler_window = max(disparity.scheduler_window, 1);
+    ground.num_median_filter = max(ground.num_median_filter, 1);
+    ground.ground_verify_step = max(ground.ground_verify_step, 1);
+    detector.erode_kernel = max(detector.erode_kernel, 1);
+    detector.dilate_kernel = max(detector.dilate_kernel, 1);
+    detector.stixel_width = max(detector.stixel_width, 1);
+    tracker.track_detect_interval = max(tracker.track_detect_interval, 1);
+    tracker.track_min_hits = max(tracker.track_min_hits, 1);
+
+}
+
+
+/*Funciton Name: Load(string config)                                                                  */
+/*Description: configuration of a file, parsed on the first call only; the
+                          reference stays valid for the whole run                          */
+/*Input: string config - path to configuration file                                          */
+/*Output: const DetectionConfig& configuration                                              */
+
+const DetectionConfig& DetectionConfig::Load(string config){
+
+    // map nodes do not move, the references outlive later insertions
+    static map<string, DetectionConfig> loaded;
+    static mutex lock;
+
+    lock_guard<mutex> guard(lock);
+    map<string, DetectionConfig>::iterator it = loaded.find(config);
+    if(it==loaded.end()) it = loaded.insert(make_pair(config, DetectionConfig(config))).first;
+
+    return it->second;
+
+}
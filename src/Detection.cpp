@@ -12,7 +12,9 @@ Description:        Detection
 /*Description: Default constructor                                                                    */
 /*Input: void                                                                                                               */     
 
-Detection::Detection(){}
+Detection::Detection(){
+
+}
 
 
 /*Funciton Name: Detection(CameraLane* lane, string config)           */
@@ -29,10 +31,12 @@ Detection::Detection(CameraLane* lane, string config){
 	offset_y = cm->OffsetY();
 	this->mcm = NULL;
 	this->mlane = NULL;
+	this->config = config;
 
-	ReadParameters(config);
+	const DetectionConfig& params = DetectionConfig::Load(config);
+	ReadParameters(params);
 	UpdateMinDisparity();
-	Initialize(config);
+	Initialize(params);
     
 }
 
@@ -55,87 +59,78 @@ Detection::Detection(MonoLane* mlane, string config){
 	this->lane =NULL;
 	this->cm = NULL;
 	
-	ReadParameters(config);
+	const DetectionConfig& params = DetectionConfig::Load(config);
+	ReadParameters(params);
 	UpdateMinDisparity();
-	Initialize(config);
+	Initialize(params);
 
 }
 
 
-/*Funciton Name: ReadParameters(string config)                                     */
-/*Description: Read parameters from configuration file                         */
-/*Input: string config - path to configuration file                                        */        
+/*Funciton Name: ReadParameters(const DetectionConfig& params)        */
+/*Description: Set control variables from parsed configuration          */
+/*Input: const DetectionConfig& params - parsed configuration               */
 /*Output: void                                                                                                           */   
 
-void Detection::ReadParameters(string config){
-
-	this->config = config;
-
-    FileStorage fs(config, FileStorage::READ);
+void Detection::ReadParameters(const DetectionConfig& params){
 
-	fs["FILTER_GROUND"]>>FILTER_GROUND;
-	fs["FILTER_BACKGROUND"]>>FILTER_BACKGROUND;
-	fs["FILTER_LANE"]>>FILTER_LANE;
-	fs["DISPARITY_TYPE"]>>DISPARITY_TYPE;
-	fs["GROUND_FILTER_TYPE"]>>GROUND_FILTER_TYPE;
-	fs["ONLINE_GROUND_FILTER_TYPE"]>>ONLINE_GROUND_FILTER_TYPE;
-	fs["DETECTOR_TYPE"]>>DETECTOR_TYPE;
-	fs["NUM_OF_RANSAC_FILTERING"]>>NUM_OF_RANSAC_FILTERING;
+	FILTER_GROUND = params.detection.FILTER_GROUND;
+	FILTER_BACKGROUND = params.detection.FILTER_BACKGROUND;
+	FILTER_LANE = params.detection.FILTER_LANE;
+	DISPARITY_TYPE = params.detection.DISPARITY_TYPE;
+	DISPARITY_SCHEDULER = params.detection.DISPARITY_SCHEDULER;
+	GROUND_FILTER_TYPE = params.detection.GROUND_FILTER_TYPE;
+	ONLINE_GROUND_FILTER_TYPE = params.detection.ONLINE_GROUND_FILTER_TYPE;
+	DETECTOR_TYPE = params.detection.DETECTOR_TYPE;
+	NUM_OF_RANSAC_FILTERING = params.detection.NUM_OF_RANSAC_FILTERING;
+	GROUND_PREDICTION = params.detection.GROUND_PREDICTION;
+	TRACKING = params.detection.TRACKING;
 
 }
 
 
-/*Funciton Name: Initialize(string config)                                                   */
-/*Description: Initialize objects according to configuration                */
-/*Input: string config - path to configuration file                                      */        
+/*Funciton Name: Initialize(const DetectionConfig& params)                    */
+/*Description: Build the objects selected by the configuration             */
+/*Input: const DetectionConfig& params - parsed configuration              */
 /*Output: void                                                                                                          */
 
-void Detection::Initialize(string config){
-
-	// Disparity
-	if(DISPARITY_TYPE==0)	sgbm = DisparitySGBM(config);
-	else if (DISPARITY_TYPE==1)	 bm = DisparityBM(config);
-	else if (DISPARITY_TYPE==2) elas = DisparityELAS(config);
-
-	// GroundFilter
-	if(FILTER_GROUND){
-
-		if(!mlane){
-			if(ONLINE_GROUND_FILTER_TYPE == 0)	hgf = HoughGroundFilter(config);
-			else if(ONLINE_GROUND_FILTER_TYPE == 1)	rgf = RANSACGroundFilter(config);
-		}
-		else{
-			if(GROUND_FILTER_TYPE == 0)	mgf = MonoGroundFilter(mcm, config);
-			else if (GROUND_FILTER_TYPE == 1 ){
-				if(ONLINE_GROUND_FILTER_TYPE == 0)	hgf = HoughGroundFilter(config);
-				else if(ONLINE_GROUND_FILTER_TYPE == 1)	rgf = RANSACGroundFilter(config);
-			}	
-		}
-	}
+void Detection::Initialize(const DetectionConfig& params){
 
-	// ObjectDetector
-	if(DETECTOR_TYPE == 0){
+	CameraModel* camera = mlane ? (CameraModel*)mcm : cm;
+	CameraLane* camera_lane = mlane ? (CameraLane*)mlane : lane;
 
-		if(lane)	cd = ContourDetector(cm, lane, config);
-		else if (mlane)	cd = ContourDetector(mcm, mlane, config);	
+	// Tracker
+	tracker = DetectionFactory::CreateTracker(params, Q, offset_x, offset_y);
 
+	// Production configuration: stages known at compile time
+	if(DetectionFactory::IsProduction(params, mlane != NULL)){
+		runner = makePtr<PipelineRunner<ProductionPipeline> >(ProductionPipeline(DisparitySGBM(params.disparity),
+			OnlineGround<RANSACGroundFilter>(RANSACGroundFilter(params.ground), NUM_OF_RANSAC_FILTERING),
+			ContourDetector(camera, camera_lane, params.detector, params.filter), NMSFilter(params.filter)));
+		return;
 	}
-	else if (DETECTOR_TYPE == 1){
-		uvd = UVDisparityDetector(config);
-	}
-
 
-	// NMSFilter
-	nmsf = NMSFilter(config);
+	// Disparity
+	RuntimeDisparity engine(DetectionFactory::CreateDisparity(params), DetectionFactory::CreateScheduler(params));
 
-	// LaneFilter
-	if(FILTER_LANE){
+	// GroundFilter
+	Ptr<MonoGroundFilter> mgf = DetectionFactory::CreateMonoGroundFilter(params, mlane ? mcm : NULL);
+	Ptr<OnlineGroundFilter> ogf = DetectionFactory::CreateOnlineGroundFilter(params, mlane != NULL);
+	pgf = ogf ? DetectionFactory::CreatePredictedGroundFilter(params, camera) : Ptr<PredictedGroundFilter>();
+	RuntimeGround ground(mgf, ogf, pgf, ONLINE_GROUND_FILTER_TYPE == 1 ? NUM_OF_RANSAC_FILTERING : 1);
 
-		if(lane) lf = LaneFilter(lane);
-		else if (mlane)	mlf = MonoLaneFilter(mlane);
+	// ObjectDetector
+	Ptr<ObjectDetector> detector = DetectionFactory::CreateDetector(params, camera, camera_lane);
 
-	}
+	// LaneFilter, then NMS over the objects on the lane; the filters are
+	// shared by copies, the chain stays valid
+	lf = DetectionFactory::CreateLaneFilter(params, lane, mlane);
+	nmsf = DetectionFactory::CreateNMSFilter(params);
+	FilterChain chain;
+	if(lf) chain.Add(lf.get());
+	chain.SetNMS(nmsf.get());
 
+	runner = makePtr<PipelineRunner<RuntimePipeline> >(RuntimePipeline(engine, ground, detector, chain));
 
 }
 
@@ -148,12 +143,27 @@ void Detection::Initialize(string config){
 
 void Detection::Update2D(Mat left, Mat right){
 
+	if(runner)	runner->Update2D(*this, left, right);
+
+}
+
+
+/*Funciton Name: UpdateFrame(P& pipeline, Mat left, Mat right)            */
+/*Description: Detect 2D objects from rectified image pair with the
+                          selected pipeline                                                                        */
+/*Input: P& pipeline - ProductionPipeline or RuntimePipeline
+                Mat left - left rectified image
+                Mat right - right rectified image                                                       */
+/*Output: void                                                                                                          */
+
+template<typename P>
+void Detection::UpdateFrame(P& pipeline, Mat left, Mat right){
+
 	// Calculate disparity
 	Mat disparity;
+	int64 start_frame = getTickCount();
 	start_disp = clock();
-	if(DISPARITY_TYPE==0) disparity = sgbm.CalculateDispMap(left, right);
-	else if (DISPARITY_TYPE==1)	disparity = bm.CalculateDispMap(left, right);
-	else if (DISPARITY_TYPE==2) disparity = elas.CalculateDispMap(left, right);
+	disparity = pipeline.CalculateDispMap(left, right);
 	stop_disp = clock();
 
 	// Visualize disparity
@@ -166,33 +176,8 @@ void Detection::Update2D(Mat left, Mat right){
 
 	start_ground_filter = clock();
 	// Filter ground and background
-	if(GROUND_FILTER_TYPE==0 && mlane){
-
-		mgf.UpdateGroundPlane();
-		mgf.FilterGround(disparity);
-
-		if(FILTER_BACKGROUND)	mgf.FilterBackground(disparity, min_disparity);
-
-	}	
-	else if(GROUND_FILTER_TYPE==1 || !mlane){
-
-		if(ONLINE_GROUND_FILTER_TYPE==0){
-			hgf.UpdateGroundPlane(disparity);
-			hgf.FilterGround(disparity);
-		}
-		else if(ONLINE_GROUND_FILTER_TYPE==1){
-			for(int i=0; i<NUM_OF_RANSAC_FILTERING; i++){
-				rgf.UpdateGroundPlane(disparity);
-				rgf.FilterGround(disparity);
-			}
-			// Mat temp = rgf.Vdisparity(disparity, 0, 255, 0);
-			// // medianBlur(disparity, disparity, 13);
-			// imshow("filtered v-disparity", temp);
-		}
-				
-		if(FILTER_BACKGROUND)	mgf.FilterBackground(disparity, min_disparity);
-
-	}
+	int min_kept = FILTER_BACKGROUND ? min_disparity : 0;
+	pipeline.FilterGround(disparity, min_kept);
 	
 	stop_ground_filter = clock();
 	
@@ -205,34 +190,120 @@ void Detection::Update2D(Mat left, Mat right){
 	} 
 
 	start_detection = clock();
-	// Detect objects
-	if(DETECTOR_TYPE==0){
-		list_2D = cd.DetectObject2D(disparity);
-		nmsf.UpdateObjectSource(&list_2D);
-		nmsf.FilterObjectList();
-	}
-	else if (DETECTOR_TYPE == 1){
-		list_2D = uvd.DetectObject2D(disparity);
+
+	// Tracks verified on the disparity map while detection is not due
+	bool detect = true;
+	if(tracker){
+		tracker->Predict();
+		detect = tracker->NeedDetection();
+		if(!detect){
+			tracker->Verify(disparity);
+			list_2D = tracker->List2D();
+		}
 	}
 
-	// Filter from lane
-	if(FILTER_LANE){
+	if(detect){
 
-		if(lane){
-			lf.UpdateObjectSource(&list_2D);
-			lf.FilterObjectList();
-		}	
-		else if (mlane){
-			mlf.UpdateObjectSource(&list_2D);
-			mlf.FilterObjectList();
-		}
+		// Detect objects on the current ground line, filter from lane, then
+		// NMS over the objects on the lane
+		list_2D = pipeline.DetectObject2D(disparity);
 
-		cout<<"Detection after lane filtering: "<<list_2D.size()<<endl;
+		if(lf)	cout<<"Detection after lane filtering: "<<list_2D.size()<<endl;
+
+		// Detections update the tracks, the list holds the tracked objects
+		if(tracker){
+			tracker->Correct(list_2D);
+			list_2D = tracker->List2D();
+		}
 
 	}
 
 	stop_detection = clock();
 
+	float frame_ms = (getTickCount() - start_frame)*1000.0/getTickFrequency();
+	pipeline.UpdateFrameTime(frame_ms);
+
+}
+
+
+/*Funciton Name: SetPoseSource(float* cam_height, float* cam_theta)        */
+/*Description: set the pose used to predict the online ground plane    */
+/*Input: float* cam_height - camera height (m)
+                float* cam_theta - camera pitch (degree)                                            */
+/*Output: void                                                                                                          */
+
+void Detection::SetPoseSource(float* cam_height, float* cam_theta){
+
+	if(pgf)	pgf->SetPoseSource(cam_height, cam_theta);
+
+}
+
+
+/*Funciton Name: GroundSkipRatio()                                                                */
+/*Description: fraction of frames with predicted ground plane              */
+/*Input: void                                                                                                               */
+/*Output: float ratio                                                                                                   */
+
+float Detection::GroundSkipRatio(){
+
+	return pgf ? pgf->SkipRatio() : 0;
+
+}
+
+
+/*Funciton Name: GroundEstimationTime()                                                   */
+/*Description: ground estimation and filtering time of the last frame (ms) */
+/*Input: void                                                                                                               */
+/*Output: double time                                                                                                 */
+
+double Detection::GroundEstimationTime(){
+
+	return pgf ? pgf->EstimationTime() : 0;
+
+}
+
+
+/*Funciton Name: SetEgoSource(Motion* ego)                                                      */
+/*Description: set the ego-motion used to predict the tracks                    */
+/*Input: Motion* ego - pointer to the absolute motion                                  */
+/*Output: void                                                                                                          */
+
+void Detection::SetEgoSource(Motion* ego){
+
+	if(tracker)	tracker->SetEgoSource(ego);
+
+}
+
+
+/*Funciton Name: TrackIDs()                                                                                 */
+/*Description: track ID of every object of the 2D list, empty without
+                          tracking                                                                                                */
+/*Input: void                                                                                                               */
+/*Output: vector<int> ids                                                                                             */
+
+vector<int> Detection::TrackIDs(){
+
+	return tracker ? tracker->IDs() : vector<int>();
+
+}
+
+
+/*Funciton Name: DetectionDutyCycle(), TrackTime()                                    */
+/*Description: fraction of frames with full detection, tracking time of
+                          the last frame (ms)                                                                        */
+/*Input: void                                                                                                               */
+/*Output: float ratio, double time                                                                          */
+
+float Detection::DetectionDutyCycle(){
+
+	return tracker ? tracker->DutyCycle() : 1;
+
+}
+
+double Detection::TrackTime(){
+
+	return tracker ? tracker->TrackTime() : 0;
+
 }
 
 
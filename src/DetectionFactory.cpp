@@ -0,0 +1,190 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        DetectionFactory
+*****************************************************************/
+
+#include "DetectionFactory.h"
+
+
+/*****************************************************************
+Class Name: DetectionFactory
+Description: Build the components of Detection selected by the configuration,
+                         an empty pointer for every component that is not used
+*****************************************************************/
+
+/*Funciton Name: CreateDisparity(const DetectionConfig& params)               */
+/*Description: disparity engine of DISPARITY_TYPE, none with the scheduler */
+/*Input: const DetectionConfig& params - parsed configuration                */
+/*Output: Ptr<Disparity> engine                                                                           */
+
+Ptr<Disparity> DetectionFactory::CreateDisparity(const DetectionConfig& params){
+
+    if(params.detection.DISPARITY_SCHEDULER) return Ptr<Disparity>();
+
+    if(params.detection.DISPARITY_TYPE == 0) return makePtr<DisparitySGBM>(params.disparity);
+    else if(params.detection.DISPARITY_TYPE == 1) return makePtr<DisparityBM>(params.disparity);
+    else if(params.detection.DISPARITY_TYPE == 2) return makePtr<DisparityELAS>(params.disparity);
+
+    return Ptr<Disparity>();
+
+}
+
+
+/*Funciton Name: CreateScheduler(const DetectionConfig& params)              */
+/*Description: disparity scheduler if DISPARITY_SCHEDULER                      */
+/*Input: const DetectionConfig& params - parsed configuration                */
+/*Output: Ptr<DisparityScheduler> scheduler                                                     */
+
+Ptr<DisparityScheduler> DetectionFactory::CreateScheduler(const DetectionConfig& params){
+
+    if(!params.detection.DISPARITY_SCHEDULER) return Ptr<DisparityScheduler>();
+
+    return makePtr<DisparityScheduler>(params.disparity);
+
+}
+
+
+/*Funciton Name: CreateMonoGroundFilter(const DetectionConfig& params, MonoCameraModel* mcm) */
+/*Description: mono ground filter if FILTER_GROUND, GROUND_FILTER_TYPE 0 and
+                          a mono camera                                                                                                    */
+/*Input: const DetectionConfig& params - parsed configuration
+                MonoCameraModel* mcm - pointer to a MonoCameraModel, NULL for stereo               */
+/*Output: Ptr<MonoGroundFilter> filter                                                                                       */
+
+Ptr<MonoGroundFilter> DetectionFactory::CreateMonoGroundFilter(const DetectionConfig& params, MonoCameraModel* mcm){
+
+    if(!params.detection.FILTER_GROUND || !mcm || params.detection.GROUND_FILTER_TYPE != 0) return Ptr<MonoGroundFilter>();
+
+    return makePtr<MonoGroundFilter>(mcm, params.ground);
+
+}
+
+
+/*Funciton Name: CreateOnlineGroundFilter(const DetectionConfig& params, bool mono) */
+/*Description: online ground filter of ONLINE_GROUND_FILTER_TYPE if FILTER_GROUND,
+                          always for stereo and with GROUND_FILTER_TYPE 1 for mono; RANSAC
+                          needs NUM_OF_RANSAC_FILTERING > 0                                                         */
+/*Input: const DetectionConfig& params - parsed configuration
+                bool mono - mono camera                                                                                                */
+/*Output: Ptr<OnlineGroundFilter> filter                                                                                     */
+
+Ptr<OnlineGroundFilter> DetectionFactory::CreateOnlineGroundFilter(const DetectionConfig& params, bool mono){
+
+    const DetectionParams& detection = params.detection;
+
+    if(!detection.FILTER_GROUND || (mono && detection.GROUND_FILTER_TYPE != 1)) return Ptr<OnlineGroundFilter>();
+
+    if(detection.ONLINE_GROUND_FILTER_TYPE == 0) return makePtr<HoughGroundFilter>(params.ground);
+    else if(detection.ONLINE_GROUND_FILTER_TYPE == 1 && detection.NUM_OF_RANSAC_FILTERING > 0) return makePtr<RANSACGroundFilter>(params.ground);
+    else if(detection.ONLINE_GROUND_FILTER_TYPE == 2) return makePtr<PeakGroundFilter>(params.ground);
+
+    return Ptr<OnlineGroundFilter>();
+
+}
+
+
+/*Funciton Name: CreatePredictedGroundFilter(const DetectionConfig& params, CameraModel* cm) */
+/*Description: ground prediction if FILTER_GROUND and GROUND_PREDICTION     */
+/*Input: const DetectionConfig& params - parsed configuration
+                CameraModel* cm - pointer to a CameraModel                                                  */
+/*Output: Ptr<PredictedGroundFilter> filter                                                                  */
+
+Ptr<PredictedGroundFilter> DetectionFactory::CreatePredictedGroundFilter(const DetectionConfig& params, CameraModel* cm){
+
+    if(!params.detection.FILTER_GROUND || !params.detection.GROUND_PREDICTION) return Ptr<PredictedGroundFilter>();
+
+    return makePtr<PredictedGroundFilter>(cm, params.ground);
+
+}
+
+
+/*Funciton Name: CreateDetector(const DetectionConfig& params, CameraModel* cm, Lane* lane) */
+/*Description: object detector of DETECTOR_TYPE                                                               */
+/*Input: const DetectionConfig& params - parsed configuration
+                CameraModel* cm - pointer to a CameraModel
+                Lane* lane - pointer to a Lane                                                                                    */
+/*Output: Ptr<ObjectDetector> detector                                                                             */
+
+Ptr<ObjectDetector> DetectionFactory::CreateDetector(const DetectionConfig& params, CameraModel* cm, Lane* lane){
+
+    if(params.detection.DETECTOR_TYPE == 0) return makePtr<ContourDetector>(cm, lane, params.detector, params.filter);
+    else if(params.detection.DETECTOR_TYPE == 1) return makePtr<UVDisparityDetector>(params.detector);
+
+    return Ptr<ObjectDetector>();
+
+}
+
+
+/*Funciton Name: CreateNMSFilter(const DetectionConfig& params)               */
+/*Description: NMS over the detected list, the contour detector only        */
+/*Input: const DetectionConfig& params - parsed configuration                */
+/*Output: Ptr<NMSFilter> filter                                                                                */
+
+Ptr<NMSFilter> DetectionFactory::CreateNMSFilter(const DetectionConfig& params){
+
+    if(params.detection.DETECTOR_TYPE != 0) return Ptr<NMSFilter>();
+
+    return makePtr<NMSFilter>(params.filter);
+
+}
+
+
+/*Funciton Name: CreateLaneFilter(const DetectionConfig& params, CameraLane* lane, MonoLane* mlane) */
+/*Description: lane filter of the lane model if FILTER_LANE                                                      */
+/*Input: const DetectionConfig& params - parsed configuration
+                CameraLane* lane - pointer to lane model, NULL for mono
+                MonoLane* mlane - pointer to monolane model, NULL for stereo                               */
+/*Output: Ptr<ObjectFilter2D> filter                                                                                                */
+
+Ptr<ObjectFilter2D> DetectionFactory::CreateLaneFilter(const DetectionConfig& params, CameraLane* lane, MonoLane* mlane){
+
+    if(!params.detection.FILTER_LANE) return Ptr<ObjectFilter2D>();
+
+    if(lane) return makePtr<LaneFilter>(lane);
+    else if(mlane) return makePtr<MonoLaneFilter>(mlane);
+
+    return Ptr<ObjectFilter2D>();
+
+}
+
+
+/*Funciton Name: CreateTracker(const DetectionConfig& params, Mat Q, int offset_x, int offset_y) */
+/*Description: multi-object tracker if TRACKING                                                                   */
+/*Input: const DetectionConfig& params - parsed configuration
+                Mat Q - reprojection matrix
+                int offset_x, int offset_y - offset of the disparity map in the image                     */
+/*Output: Ptr<Tracker> tracker                                                                                                   */
+
+Ptr<Tracker> DetectionFactory::CreateTracker(const DetectionConfig& params, Mat Q, int offset_x, int offset_y){
+
+    if(!params.detection.TRACKING) return Ptr<Tracker>();
+
+    return makePtr<Tracker>(Q, offset_x, offset_y, params.tracker);
+
+}
+
+
+/*Funciton Name: IsProduction(const DetectionConfig& params, bool mono)     */
+/*Description: whether the configuration selects exactly the components of
+                          ProductionPipeline: SGBM without scheduler, RANSAC ground
+                          without prediction, contour detector and NMS only         */
+/*Input: const DetectionConfig& params - parsed configuration
+                bool mono - mono camera                                                                       */
+/*Output: bool result - 1: production configuration                                      */
+
+bool DetectionFactory::IsProduction(const DetectionConfig& params, bool mono){
+
+    const DetectionParams& detection = params.detection;
+
+    // Same selection as CreateDisparity, CreateOnlineGroundFilter,
+    // CreatePredictedGroundFilter, CreateDetector and CreateLaneFilter
+    bool disparity = detection.DISPARITY_TYPE == 0 && !detection.DISPARITY_SCHEDULER;
+    bool ground = detection.FILTER_GROUND && (!mono || detection.GROUND_FILTER_TYPE == 1)
+                            && detection.ONLINE_GROUND_FILTER_TYPE == 1 && detection.NUM_OF_RANSAC_FILTERING > 0
+                            && !detection.GROUND_PREDICTION;
+    bool detector = detection.DETECTOR_TYPE == 0 && !detection.FILTER_LANE;
+
+    return disparity && ground && detector;
+
+}
@@ -26,19 +26,48 @@ Disparity::Disparity(){}
 /*Description: Constructor from configuration file                                     */
 /*Input: string config - configurateion file                                                       */    
 
-Disparity::Disparity(string config){
+Disparity::Disparity(string config): Disparity(DetectionConfig::Load(config).disparity){}
 
 
-    FileStorage fs(config, FileStorage::READ);
+/*Funciton Name: Disparity(const DisparityParams& params)                          */
+/*Description: Constructor from parsed configuration                                */
+/*Input: const DisparityParams& params - disparity parameters                  */
 
-    fs["pre_gaussian_kernel"] >> pre_gaussian_kernel;
-    fs["pre_median_kernel"] >> pre_median_kernel;
-    fs["max_disparity"] >> max_disparity;
-    fs["window_size"] >> window_size;
-    fs["prefilter_size"] >> prefilter_size;
-    fs["prefilter_cap"] >> prefilter_cap;
-    fs["texture_threshold"] >> texture_threshold;
-    fs["uniqueness_ratio"] >> uniqueness_ratio;
+Disparity::Disparity(const DisparityParams& params){
+
+    pre_gaussian_kernel = params.pre_gaussian_kernel;
+    pre_median_kernel = params.pre_median_kernel;
+    max_disparity = params.max_disparity;
+    window_size = params.window_size;
+    prefilter_size = params.prefilter_size;
+    prefilter_cap = params.prefilter_cap;
+    texture_threshold = params.texture_threshold;
+    uniqueness_ratio = params.uniqueness_ratio;
+
+}
+
+
+/*Funciton Name: LevelsPerPixel()                                                               */
+/*Description: output levels per pixel of disparity                                 */
+/*Input: void                                                                                                                 */    
+/*Output: float levels                                                                                                  */  
+
+float Disparity::LevelsPerPixel(){
+
+    return 1;
+
+}
+
+
+/*Funciton Name: SetMaxDisparity(int max_disparity)                          */
+/*Description: change the disparity range and re-initialize matchers */
+/*Input: int max_disparity - number of disparities                                  */    
+/*Output: void                                                                                                            */  
+
+void Disparity::SetMaxDisparity(int max_disparity){
+
+    this->max_disparity = max_disparity;
+    InitMatcher();
 
 }
 
@@ -75,11 +104,17 @@ DisparitySGBM::DisparitySGBM(){}
 /*Description: Constructor from configuration file                                     */
 /*Input: string config - configurateion file                                                       */    
 
-DisparitySGBM::DisparitySGBM(string config): Disparity(config){
+DisparitySGBM::DisparitySGBM(string config): DisparitySGBM(DetectionConfig::Load(config).disparity){}
+
+
+/*Funciton Name: DisparitySGBM(const DisparityParams& params)                */
+/*Description: Constructor from parsed configuration                                */
+/*Input: const DisparityParams& params - disparity parameters                  */
+
+DisparitySGBM::DisparitySGBM(const DisparityParams& params): Disparity(params){
 
-    FileStorage fs(config, FileStorage::READ);
-    fs["wls_lambda"] >> wls_lambda;
-    fs["wls_sigma"] >> wls_sigma;
+    wls_lambda = params.wls_lambda;
+    wls_sigma = params.wls_sigma;
 
     InitMatcher();
 
@@ -164,11 +199,17 @@ DisparityBM::DisparityBM(){}
 /*Description: Constructor from configuration file                                     */
 /*Input: string config - configurateion file                                                       */    
 
-DisparityBM::DisparityBM(string config): Disparity(config){
+DisparityBM::DisparityBM(string config): DisparityBM(DetectionConfig::Load(config).disparity){}
 
-    FileStorage fs(config, FileStorage::READ);
-    fs["speckle_window"] >> speckle_window;
-    fs["speckle_range"] >> speckle_range;
+
+/*Funciton Name: DisparityBM(const DisparityParams& params)                     */
+/*Description: Constructor from parsed configuration                                */
+/*Input: const DisparityParams& params - disparity parameters                  */
+
+DisparityBM::DisparityBM(const DisparityParams& params): Disparity(params){
+
+    speckle_window = params.speckle_window;
+    speckle_range = params.speckle_range;
 
     InitMatcher();
 
@@ -240,6 +281,8 @@ Description: Calculate disparity map with ELAS algorithm
 
 DisparityELAS::DisparityELAS(){
 
+    elas_param = Elas::parameters(Elas::MIDDLEBURY);
+    upsample_sigma = 10;
     disp_elas = StereoEfficientLargeScale(0,128);
 
 }
@@ -249,13 +292,36 @@ DisparityELAS::DisparityELAS(){
 /*Description: Constructor from configuration file                                     */
 /*Input: string config - configurateion file                                                       */    
 
-DisparityELAS::DisparityELAS(string config):Disparity(config){
+DisparityELAS::DisparityELAS(string config): DisparityELAS(DetectionConfig::Load(config).disparity){}
+
+
+/*Funciton Name: DisparityELAS(const DisparityParams& params)                  */
+/*Description: Constructor from parsed configuration, ELAS profile with
+                          overrides                                                                                            */
+/*Input: const DisparityParams& params - disparity parameters                  */
+
+DisparityELAS::DisparityELAS(const DisparityParams& params): Disparity(params){
+
+    elas_param = params.elas;
+    upsample_sigma = params.elas_upsample_sigma;
 
     InitMatcher();
 
 }
 
 
+/*Funciton Name: LevelsPerPixel()                                                               */
+/*Description: ELAS output is scaled by 2 (former CV_16S(x16)/8)         */
+/*Input: void                                                                                                                 */    
+/*Output: float levels                                                                                                  */  
+
+float DisparityELAS::LevelsPerPixel(){
+
+    return 2;
+
+}
+
+
 /*Funciton Name: InitMatcher()                                                                          */
 /*Description: initialize matchers                                                                       */
 /*Input: void                                                                                                                */    
@@ -265,10 +331,11 @@ void DisparityELAS::InitMatcher(){
 
     disp_elas = StereoEfficientLargeScale(0,max_disparity);
 
-	// we can set various parameter
-		//elas.elas.param.ipol_gap_width=;
-		//elas.elas.param.speckle_size=getParameter("speckle_size");
-		//elas.elas.param.speckle_sim_threshold=getParameter("speckle_sim");
+    // disparity range comes from max_disparity, everything else from the profile
+    Elas::parameters param = elas_param;
+    param.disp_min = disp_elas.elas.param.disp_min;
+    param.disp_max = disp_elas.elas.param.disp_max;
+    disp_elas.elas.param = param;
 
 }
 
@@ -281,15 +348,338 @@ void DisparityELAS::InitMatcher(){
 
 Mat DisparityELAS::CalculateDispMap(Mat img_l, Mat img_r){
 
-    Mat output, temp, temp_l, temp_r;
+    Mat output, temp_l, temp_r;
     Preprocessing(img_l, temp_l);
     Preprocessing(img_r, temp_r);
 
-	disp_elas(temp_l,temp_r,temp,max_disparity);
-	temp.convertTo(output,CV_8U,1.0/8);
+	// left disparity straight into CV_8U, same scale as the former CV_16S(x16)/8,
+	// the images padded by max_disparity columns as before
+	if(elas_param.subsampling){
+		Mat half;
+		disp_elas.compute(temp_l,temp_r,half,LevelsPerPixel(),max_disparity);
+		UpsampleDispMap(half,temp_l,output);
+	}
+	else disp_elas.compute(temp_l,temp_r,output,LevelsPerPixel(),max_disparity);
 
     return output;
 
 }
 
 
+/*Funciton Name: UpsampleDispMap(Mat& disp_half, Mat& guide, Mat& disp_full)   */
+/*Description: joint bilateral upsampling of a subsampled disparity map, 
+                         guided by the full resolution image                                         */
+/*Input: Mat& disp_half - disparity of every 2nd pixel (CV_8U)
+                Mat& guide - full resolution left image (CV_8U)
+                Mat& disp_full - full resolution disparity (CV_8U)                      */    
+/*Output: void                                                                                                            */  
+
+void DisparityELAS::UpsampleDispMap(Mat& disp_half, Mat& guide, Mat& disp_full){
+
+    disp_full.create(guide.size(), CV_8U);
+
+    // range weight for intensity differences
+    float w_range[256];
+    for(int i = 0; i < 256; i++) w_range[i] = exp(-(float)(i*i)/(2*upsample_sigma*upsample_sigma));
+
+    // sample (x,y) of disp_half belongs to full resolution pixel (2x,2y), so
+    // a pixel lies on a sample (fraction 0, bilinear weights 1 and 0) or
+    // halfway between two (fraction 1/2, weights 1/2 and 1/2) in each
+    // direction; the bilinear weights of the 2x2 surrounding samples are
+    // multiplied by the intensity similarity to the pixel under the sample
+    // and invalid (0) samples are ignored, so edges of the guide are kept
+    const float w_bilinear[2][2] = { {1.f, 0.f}, {0.5f, 0.5f} };
+    const int last_x = disp_half.cols-1;
+    const int last_y = disp_half.rows-1;
+    for(int y = 0; y < disp_full.rows; y++){
+
+        int y0 = min(y/2, last_y);
+        int y1 = min(y0 + (y&1), last_y);
+        const float* wy = w_bilinear[y&1];
+        const uchar* d_row[2] = { disp_half.ptr<uchar>(y0), disp_half.ptr<uchar>(y1) };
+        const uchar* g_row[2] = { guide.ptr<uchar>(2*y0), guide.ptr<uchar>(2*y1) };
+        const uchar* g = guide.ptr<uchar>(y);
+        uchar* out = disp_full.ptr<uchar>(y);
+
+        for(int x = 0; x < disp_full.cols; x++){
+
+            int x0 = min(x/2, last_x);
+            int x1 = min(x0 + (x&1), last_x);
+            int xs[2] = { x0, x1 };
+            const float* wx = w_bilinear[x&1];
+
+            float sum = 0, sum_w = 0;
+            for(int j = 0; j < 2; j++){
+                for(int i = 0; i < 2; i++){
+                    uchar d = d_row[j][xs[i]];
+                    if(d == 0 || wx[i]*wy[j] == 0) continue;
+                    float w = wx[i]*wy[j]*w_range[abs(g[x] - g_row[j][2*xs[i]])];
+                    sum += w*d;
+                    sum_w += w;
+                }
+            }
+            out[x] = sum_w > 0 ? saturate_cast<uchar>(sum/sum_w) : 0;
+        }
+    }
+
+}
+
+
+
+/*****************************************************************
+Class Name: DisparityScheduler
+Description: Pick disparity engine, resolution and disparity range 
+                         per frame to meet an end-to-end deadline
+*****************************************************************/
+
+/*Funciton Name: DisparityScheduler()                                                    */
+/*Description: Default constructor                                                                     */
+/*Input: void                                                                                                                 */  
+
+DisparityScheduler::DisparityScheduler(){
+
+    current = -1;
+    deadline_ms = 0;
+    upgrade_margin = 0.8;
+    window = 20;
+    probe_interval = 100;
+    rest_ms = 0;
+    last_disp_ms = 0;
+    frames = 0;
+    switches = 0;
+
+}
+
+
+/*Funciton Name: DisparityScheduler(string config)                            */
+/*Description: Constructor from configuration file                                     */
+/*Input: string config - configurateion file                                                       */   
+
+DisparityScheduler::DisparityScheduler(string config): DisparityScheduler(DetectionConfig::Load(config).disparity){}
+
+
+/*Funciton Name: DisparityScheduler(const DisparityParams& params)         */
+/*Description: Constructor from parsed configuration                                */
+/*Input: const DisparityParams& params - disparity parameters                  */
+
+DisparityScheduler::DisparityScheduler(const DisparityParams& params): DisparityScheduler(){
+
+    deadline_ms = params.scheduler_deadline_ms;
+    upgrade_margin = params.scheduler_upgrade_margin;
+    window = params.scheduler_window;
+    probe_interval = params.scheduler_probe_interval;
+
+    // modes as triples: type, downscale, max_disparity (best quality first)
+    const vector<int>& list = params.scheduler_modes;
+    for(size_t i = 0; i + 2 < list.size(); i += 3) AddMode(params, list[i], list[i+1], list[i+2]);
+
+    if(modes.empty()) cout<<"Disparity scheduler: no valid scheduler_modes"<<endl;
+
+}
+
+
+/*Funciton Name: AddMode(string config, int type, int downscale, int max_disparity)   */
+/*Description: append a mode with lower preference than the existing ones  */
+/*Input: string config - configuration file of the matcher, or
+                const DisparityParams& params - parameters of the matcher
+                int type - 0 - SGBM, 1- BM, 2 - ELAS
+                int downscale - 1 - full, 2 - half resolution
+                int max_disparity - disparity range at full resolution                  */    
+/*Output: void                                                                                                            */  
+
+void DisparityScheduler::AddMode(string config, int type, int downscale, int max_disparity){
+
+    AddMode(DetectionConfig::Load(config).disparity, type, downscale, max_disparity);
+
+}
+
+void DisparityScheduler::AddMode(const DisparityParams& params, int type, int downscale, int max_disparity){
+
+    Mode mode;
+    mode.type = type;
+    mode.downscale = max(downscale, 1);
+    mode.max_disparity = max_disparity;
+    mode.next = 0;
+    mode.last_frame = -1;
+
+    if(type == 0) mode.matcher = makePtr<DisparitySGBM>(params);
+    else if(type == 1) mode.matcher = makePtr<DisparityBM>(params);
+    else if(type == 2) mode.matcher = makePtr<DisparityELAS>(params);
+    else return;
+
+    // SGBM and BM need a multiple of 16 disparities at the matching resolution
+    int range = (max_disparity + mode.downscale - 1)/mode.downscale;
+    if(type != 2) range = (range + 15)/16*16;
+    mode.matcher->SetMaxDisparity(range);
+
+    modes.push_back(mode);
+
+}
+
+
+/*Funciton Name: PredictLatency(const Mode& mode)                          */
+/*Description: mean + one standard deviation of the rolling window */
+/*Input: const Mode& mode - mode to predict                                          */    
+/*Output: float latency [ms], 0 if the mode has not been measured  */  
+
+float DisparityScheduler::PredictLatency(const Mode& mode){
+
+    if(mode.latency.empty()) return 0;
+
+    float mean = 0, var = 0;
+    for(float t : mode.latency) mean += t;
+    mean /= mode.latency.size();
+    for(float t : mode.latency) var += (t - mean)*(t - mean);
+    var /= mode.latency.size();
+
+    return mean + sqrt(var);
+
+}
+
+
+/*Funciton Name: ModeName(int i)                                                              */
+/*Description: readable name of a mode for logging                            */
+/*Input: int i - index of mode                                                                        */    
+/*Output: string name                                                                                                 */  
+
+string DisparityScheduler::ModeName(int i){
+
+    if(i < 0) return "none";
+    const char* types[] = {"SGBM", "BM", "ELAS"};
+    return string(types[modes[i].type]) + "/" + to_string(modes[i].downscale) + "/" + to_string(modes[i].max_disparity);
+
+}
+
+
+/*Funciton Name: ProbeMode(int choice)                                                    */
+/*Description: mode to measure instead of the choice: every probe_interval
+                          frames the best mode not measured for probe_interval
+                          frames, so that a latency spike does not lock it out     */
+/*Input: int choice - mode chosen from the predictions                         */
+/*Output: int mode, choice if there is nothing to probe                            */
+
+int DisparityScheduler::ProbeMode(int choice){
+
+    if(probe_interval <= 0 || frames == 0 || frames%probe_interval != 0) return choice;
+
+    // Modes of higher preference first; lower ones only matter if the choice
+    // does not fit either, then the fastest is chosen again anyway
+    for(int i = 0; i < choice; i++){
+        Mode& mode = modes[i];
+        if(mode.last_frame >= 0 && frames - mode.last_frame >= probe_interval){
+            // the old window describes another load, start it again
+            mode.latency.clear();
+            mode.next = 0;
+            return i;
+        }
+    }
+    return choice;
+
+}
+
+
+/*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
+/*Description: choose a mode for this frame and calculate the 
+                         full resolution disparity map (1 level per pixel)               */
+/*Input: Mat img_l - left image
+                    Mat img_r - right image                                                                         */    
+/*Output: Mat disparity                                                                                             */  
+
+Mat DisparityScheduler::CalculateDispMap(Mat img_l, Mat img_r){
+
+    if(modes.empty()) return Mat::zeros(img_l.size(), CV_8U);
+
+    // Budget left for disparity after the rest of the pipeline
+    float budget = deadline_ms - rest_ms;
+
+    // Best mode that fits: unmeasured modes are tried once, modes better than
+    // the current one need some headroom so that the choice does not flicker
+    int choice = -1;
+    for(int i = 0; i < (int)modes.size(); i++){
+        float limit = (current >= 0 && i < current) ? upgrade_margin*budget : budget;
+        if(PredictLatency(modes[i]) <= limit){
+            choice = i;
+            break;
+        }
+    }
+
+    // Nothing fits: fastest predicted mode
+    if(choice < 0){
+        choice = 0;
+        for(int i = 1; i < (int)modes.size(); i++)
+            if(PredictLatency(modes[i]) < PredictLatency(modes[choice])) choice = i;
+    }
+
+    // A stale better mode is measured once; the schedule continues from the
+    // predictions, so a single probe does not count as a switch
+    int probe = ProbeMode(choice);
+    if(probe != choice){
+        cout<<"Disparity scheduler: frame "<<frames<<" probe "<<ModeName(probe)<<" (last measured "
+            <<frames - modes[probe].last_frame<<" frames ago)"<<endl;
+        choice = probe;
+    }
+    else if(choice != current){
+        if(current >= 0){
+            switches++;
+            cout<<"Disparity scheduler: frame "<<frames<<" switch "<<ModeName(current)<<" -> "<<ModeName(choice)
+                <<" (predicted "<<PredictLatency(modes[choice])<<" ms, budget "<<budget<<" ms, switches "<<switches<<")"<<endl;
+        }
+        current = choice;
+    }
+
+    Mode& mode = modes[choice];
+    int64 start = getTickCount();
+
+    Mat disparity, temp_l, temp_r, temp;
+    if(mode.downscale > 1){
+        resize(img_l, temp_l, Size(), 1.0/mode.downscale, 1.0/mode.downscale, INTER_AREA);
+        resize(img_r, temp_r, Size(), 1.0/mode.downscale, 1.0/mode.downscale, INTER_AREA);
+    }
+    else{
+        temp_l = img_l;
+        temp_r = img_r;
+    }
+
+    temp = mode.matcher->CalculateDispMap(temp_l, temp_r);
+
+    // rescale to one level per full resolution pixel
+    double scale = mode.downscale/mode.matcher->LevelsPerPixel();
+    if(mode.downscale > 1) resize(temp, temp, img_l.size(), 0, 0, INTER_NEAREST);
+    if(scale != 1.0) temp.convertTo(disparity, CV_8U, scale);
+    else disparity = temp;
+
+    last_disp_ms = (getTickCount() - start)*1000.0/getTickFrequency();
+    if((int)mode.latency.size() < window) mode.latency.push_back(last_disp_ms);
+    else mode.latency[mode.next] = last_disp_ms;
+    mode.next = (mode.next + 1)%window;
+    mode.last_frame = frames;
+    frames++;
+
+    return disparity;
+
+}
+
+
+/*Funciton Name: UpdateFrameTime(float frame_ms)                              */
+/*Description: report the end-to-end latency of the last frame            */
+/*Input: float frame_ms - latency of the whole frame [ms]                    */    
+/*Output: void                                                                                                            */  
+
+void DisparityScheduler::UpdateFrameTime(float frame_ms){
+
+    float rest = max(frame_ms - last_disp_ms, 0.0f);
+    rest_ms = frames <= 1 ? rest : 0.9*rest_ms + 0.1*rest;
+
+}
+
+
+/*Funciton Name: Switches()                                                                           */
+/*Description: number of mode switches so far                                        */
+/*Input: void                                                                                                                 */    
+/*Output: int switches                                                                                                 */  
+
+int DisparityScheduler::Switches(){
+
+    return switches;
+
+}
@@ -20,95 +20,178 @@ Street, Fifth Floor, Boston, MA 02110-1301, USA
 */
 
 #include "ELAS/descriptor.h"
-#include "ELAS/filter.h"
 #include <emmintrin.h>
 
 using namespace std;
 
-Descriptor::Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution) {
-  I_desc        = (uint8_t*)_mm_malloc(16*width*height*sizeof(uint8_t),16);
-  uint8_t* I_du = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-  uint8_t* I_dv = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-  filter::sobel3x3(I,I_du,I_dv,bpl,height);
-  createDescriptor(I_du,I_dv,width,height,bpl,half_resolution);
-  _mm_free(I_du);
-  _mm_free(I_dv);
+// sparse descriptor layout: (line offset -2..+2, column offset) of the 12 du
+// samples followed by the 4 dv samples, see createDescriptor for the pattern
+static const int32_t desc_du_line[12] = { 0, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 4};
+static const int32_t desc_du_col[12]  = { 0,-2, 0, 2,-1, 0, 0, 1,-2, 0, 2, 0};
+static const int32_t desc_dv_line[4]  = { 1, 2, 2, 3};
+static const int32_t desc_dv_col[4]   = { 0,-1, 1, 0};
+
+// transpose a 16x16 byte block held in 16 registers (row k, byte p => row p, byte k)
+static inline void transpose_16x16_8bit (__m128i* r) {
+  __m128i t[16];
+  for (int32_t i=0; i<8; i++) {
+    t[i]   = _mm_unpacklo_epi8(r[2*i],r[2*i+1]);
+    t[i+8] = _mm_unpackhi_epi8(r[2*i],r[2*i+1]);
+  }
+  for (int32_t i=0; i<4; i++) {
+    r[i]    = _mm_unpacklo_epi16(t[2*i],t[2*i+1]);
+    r[i+4]  = _mm_unpackhi_epi16(t[2*i],t[2*i+1]);
+    r[i+8]  = _mm_unpacklo_epi16(t[2*i+8],t[2*i+9]);
+    r[i+12] = _mm_unpackhi_epi16(t[2*i+8],t[2*i+9]);
+  }
+  for (int32_t j=0; j<4; j++) {
+    for (int32_t i=0; i<2; i++) {
+      t[4*j+i]   = _mm_unpacklo_epi32(r[4*j+2*i],r[4*j+2*i+1]);
+      t[4*j+i+2] = _mm_unpackhi_epi32(r[4*j+2*i],r[4*j+2*i+1]);
+    }
+  }
+  for (int32_t j=0; j<8; j++) {
+    r[2*j]   = _mm_unpacklo_epi64(t[2*j],t[2*j+1]);
+    r[2*j+1] = _mm_unpackhi_epi64(t[2*j],t[2*j+1]);
+  }
+}
+
+Descriptor::Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution,int32_t border) {
+  I_desc = (uint8_t*)_mm_malloc(16*width*height*sizeof(uint8_t),16);
+  createDescriptor(I,width,height,bpl,half_resolution,border);
 }
 
 Descriptor::~Descriptor() {
   _mm_free(I_desc);
 }
 
-void Descriptor::createDescriptor (uint8_t* I_du,uint8_t* I_dv,int32_t width,int32_t height,int32_t bpl,bool half_resolution) {
-
-  uint8_t *I_desc_curr;  
-  uint32_t addr_v0,addr_v1,addr_v2,addr_v3,addr_v4;
-  
-  // do not compute every second line
-  if (half_resolution) {
-  
-    // create filter strip
-    for (int32_t v=4; v<height-3; v+=2) {
-
-      addr_v2 = v*bpl;
-      addr_v0 = addr_v2-2*bpl;
-      addr_v1 = addr_v2-1*bpl;
-      addr_v3 = addr_v2+1*bpl;
-      addr_v4 = addr_v2+2*bpl;
-
-      for (int32_t u=3; u<width-3; u++) {
-        I_desc_curr = I_desc+(v*width+u)*16;
-        *(I_desc_curr++) = *(I_du+addr_v0+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v1+u-2);
-        *(I_desc_curr++) = *(I_du+addr_v1+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v1+u+2);
-        *(I_desc_curr++) = *(I_du+addr_v2+u-1);
-        *(I_desc_curr++) = *(I_du+addr_v2+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v2+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v2+u+1);
-        *(I_desc_curr++) = *(I_du+addr_v3+u-2);
-        *(I_desc_curr++) = *(I_du+addr_v3+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v3+u+2);
-        *(I_desc_curr++) = *(I_du+addr_v4+u+0);
-        *(I_desc_curr++) = *(I_dv+addr_v1+u+0);
-        *(I_desc_curr++) = *(I_dv+addr_v2+u-1);
-        *(I_desc_curr++) = *(I_dv+addr_v2+u+1);
-        *(I_desc_curr++) = *(I_dv+addr_v3+u+0);
+// sobel responses of pixel u (with border replicated columns left of the
+// image), the columns u-1..u+1 are clamped to the cols columns of the line
+static inline void sobelPixel (const uint8_t* I_top,const uint8_t* I_mid,const uint8_t* I_bot,
+                               uint8_t* du,uint8_t* dv,int32_t u,int32_t cols,int32_t border) {
+  int32_t l = min(max(u-1-border,0),cols-1);
+  int32_t c = min(max(u-border,0),cols-1);
+  int32_t r = min(max(u+1-border,0),cols-1);
+  int32_t v_l = I_top[l]+2*I_mid[l]+I_bot[l];
+  int32_t v_r = I_top[r]+2*I_mid[r]+I_bot[r];
+  int32_t h   = (I_top[l]-I_bot[l])+2*(I_top[c]-I_bot[c])+(I_top[r]-I_bot[r]);
+  du[u] = (uint8_t)min(max(((v_l-v_r)>>2)+128,0),255);
+  dv[u] = (uint8_t)min(max((h>>2)+128,0),255);
+}
+
+void Descriptor::sobelRow (const uint8_t* I,uint8_t* du,uint8_t* dv,int32_t v,int32_t width,int32_t bpl,int32_t border) {
+
+  const uint8_t* I_top = I+(v-1)*bpl;
+  const uint8_t* I_mid = I+(v+0)*bpl;
+  const uint8_t* I_bot = I+(v+1)*bpl;
+  const int32_t  cols  = width-2*border;
+
+  __m128i zero = _mm_setzero_si128();
+  __m128i offs = _mm_set1_epi16(128);
+  int32_t u = 1;
+
+  // left border: the left neighbour is a replicated column
+  for (; u<width-1 && u-1<border; u++)
+    sobelPixel(I_top,I_mid,I_bot,du,dv,u,cols,border);
+
+  // 16 pixels per iteration, loads must stay inside the image columns
+  for (; u+16-border<=cols-1 && u<width-1; u+=16) {
+    __m128i top_l = _mm_loadu_si128((const __m128i*)(I_top+u-1-border));
+    __m128i top_c = _mm_loadu_si128((const __m128i*)(I_top+u+0-border));
+    __m128i top_r = _mm_loadu_si128((const __m128i*)(I_top+u+1-border));
+    __m128i mid_l = _mm_loadu_si128((const __m128i*)(I_mid+u-1-border));
+    __m128i mid_r = _mm_loadu_si128((const __m128i*)(I_mid+u+1-border));
+    __m128i bot_l = _mm_loadu_si128((const __m128i*)(I_bot+u-1-border));
+    __m128i bot_c = _mm_loadu_si128((const __m128i*)(I_bot+u+0-border));
+    __m128i bot_r = _mm_loadu_si128((const __m128i*)(I_bot+u+1-border));
+    __m128i du_res[2],dv_res[2];
+    for (int32_t i=0; i<2; i++) {
+      __m128i tl,tc,tr,ml,mr,bl,bc,br;
+      if (i==0) {
+        tl = _mm_unpacklo_epi8(top_l,zero); tc = _mm_unpacklo_epi8(top_c,zero); tr = _mm_unpacklo_epi8(top_r,zero);
+        ml = _mm_unpacklo_epi8(mid_l,zero); mr = _mm_unpacklo_epi8(mid_r,zero);
+        bl = _mm_unpacklo_epi8(bot_l,zero); bc = _mm_unpacklo_epi8(bot_c,zero); br = _mm_unpacklo_epi8(bot_r,zero);
+      } else {
+        tl = _mm_unpackhi_epi8(top_l,zero); tc = _mm_unpackhi_epi8(top_c,zero); tr = _mm_unpackhi_epi8(top_r,zero);
+        ml = _mm_unpackhi_epi8(mid_l,zero); mr = _mm_unpackhi_epi8(mid_r,zero);
+        bl = _mm_unpackhi_epi8(bot_l,zero); bc = _mm_unpackhi_epi8(bot_c,zero); br = _mm_unpackhi_epi8(bot_r,zero);
       }
+      // du: column smoothing (1,2,1) followed by row derivative (1,0,-1)
+      __m128i v_l = _mm_add_epi16(_mm_add_epi16(tl,bl),_mm_add_epi16(ml,ml));
+      __m128i v_r = _mm_add_epi16(_mm_add_epi16(tr,br),_mm_add_epi16(mr,mr));
+      du_res[i]   = _mm_add_epi16(_mm_srai_epi16(_mm_sub_epi16(v_l,v_r),2),offs);
+      // dv: column derivative (1,0,-1) followed by row smoothing (1,2,1)
+      __m128i h_l = _mm_sub_epi16(tl,bl);
+      __m128i h_c = _mm_sub_epi16(tc,bc);
+      __m128i h_r = _mm_sub_epi16(tr,br);
+      __m128i h   = _mm_add_epi16(_mm_add_epi16(h_l,h_r),_mm_add_epi16(h_c,h_c));
+      dv_res[i]   = _mm_add_epi16(_mm_srai_epi16(h,2),offs);
     }
-    
-  // compute full descriptor images
-  } else {
-    
-    // create filter strip
-    for (int32_t v=3; v<height-3; v++) {
-
-      addr_v2 = v*bpl;
-      addr_v0 = addr_v2-2*bpl;
-      addr_v1 = addr_v2-1*bpl;
-      addr_v3 = addr_v2+1*bpl;
-      addr_v4 = addr_v2+2*bpl;
-
-      for (int32_t u=3; u<width-3; u++) {
-        I_desc_curr = I_desc+(v*width+u)*16;
-        *(I_desc_curr++) = *(I_du+addr_v0+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v1+u-2);
-        *(I_desc_curr++) = *(I_du+addr_v1+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v1+u+2);
-        *(I_desc_curr++) = *(I_du+addr_v2+u-1);
-        *(I_desc_curr++) = *(I_du+addr_v2+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v2+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v2+u+1);
-        *(I_desc_curr++) = *(I_du+addr_v3+u-2);
-        *(I_desc_curr++) = *(I_du+addr_v3+u+0);
-        *(I_desc_curr++) = *(I_du+addr_v3+u+2);
-        *(I_desc_curr++) = *(I_du+addr_v4+u+0);
-        *(I_desc_curr++) = *(I_dv+addr_v1+u+0);
-        *(I_desc_curr++) = *(I_dv+addr_v2+u-1);
-        *(I_desc_curr++) = *(I_dv+addr_v2+u+1);
-        *(I_desc_curr++) = *(I_dv+addr_v3+u+0);
-      }
+    _mm_storeu_si128((__m128i*)(du+u),_mm_packus_epi16(du_res[0],du_res[1]));
+    _mm_storeu_si128((__m128i*)(dv+u),_mm_packus_epi16(dv_res[0],dv_res[1]));
+  }
+
+  // remaining pixels at the end of the line and the right border
+  for (; u<width-1; u++)
+    sobelPixel(I_top,I_mid,I_bot,du,dv,u,cols,border);
+}
+
+void Descriptor::descriptorRow (uint8_t** du_rows,uint8_t** dv_rows,uint8_t* I_desc_line,int32_t width) {
+
+  __m128i xmm[16];
+  int32_t u = 3;
+
+  // 16 descriptors per iteration: load each of the 16 descriptor
+  // components for 16 neighboring pixels, then transpose the block
+  for (; u+15<width-3; u+=16) {
+    for (int32_t k=0; k<12; k++)
+      xmm[k] = _mm_loadu_si128((__m128i*)(du_rows[desc_du_line[k]]+u+desc_du_col[k]));
+    for (int32_t k=0; k<4; k++)
+      xmm[12+k] = _mm_loadu_si128((__m128i*)(dv_rows[desc_dv_line[k]]+u+desc_dv_col[k]));
+    transpose_16x16_8bit(xmm);
+    for (int32_t k=0; k<16; k++)
+      _mm_store_si128((__m128i*)(I_desc_line+(u+k)*16),xmm[k]);
+  }
+
+  // remaining pixels at the end of the line
+  for (; u<width-3; u++) {
+    uint8_t* I_desc_curr = I_desc_line+u*16;
+    for (int32_t k=0; k<12; k++)
+      *(I_desc_curr++) = *(du_rows[desc_du_line[k]]+u+desc_du_col[k]);
+    for (int32_t k=0; k<4; k++)
+      *(I_desc_curr++) = *(dv_rows[desc_dv_line[k]]+u+desc_dv_col[k]);
+  }
+}
+
+void Descriptor::createDescriptor (uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution,int32_t border) {
+
+  // ring buffer for the sobel responses of 5 consecutive lines of the full
+  // descriptor width, lines 16 byte aligned
+  int32_t ring_bpl = width + 15-(width-1)%16;
+  uint8_t* du_ring = (uint8_t*)_mm_malloc(5*ring_bpl*sizeof(uint8_t),16);
+  uint8_t* dv_ring = (uint8_t*)_mm_malloc(5*ring_bpl*sizeof(uint8_t),16);
+  uint8_t *du_rows[5],*dv_rows[5];
+
+  // next line to be filtered into the ring buffer
+  int32_t v_sobel = 1;
+
+  for (int32_t v=3; v<height-3; v++) {
+
+    // filter lines up to v+2, overwriting line v-3 which is no longer needed
+    for (; v_sobel<=v+2; v_sobel++)
+      sobelRow(I,du_ring+(v_sobel%5)*ring_bpl,dv_ring+(v_sobel%5)*ring_bpl,v_sobel,width,bpl,border);
+
+    // do not compute every second line
+    if (half_resolution && v%2==1)
+      continue;
+
+    for (int32_t i=0; i<5; i++) {
+      du_rows[i] = du_ring+((v-2+i)%5)*ring_bpl;
+      dv_rows[i] = dv_ring+((v-2+i)%5)*ring_bpl;
     }
+    descriptorRow(du_rows,dv_rows,I_desc+v*width*16,width);
   }
-  
+
+  _mm_free(du_ring);
+  _mm_free(dv_ring);
 }
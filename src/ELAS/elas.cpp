@@ -26,30 +26,66 @@ Street, Fifth Floor, Boston, MA 02110-1301, USA
 #include "ELAS/matrix.h"
 
 #include "ELAS/StereoEfficientLargeScale.h"
+#include <memory>
 using namespace std;
 using namespace cv;
 
+#ifdef PROFILE
+#include <chrono>
+#include <iostream>
+
+// prints the time spent since the previous lap (or construction)
+class LapTimer {
+public:
+  LapTimer () : last(chrono::steady_clock::now()) {}
+  void lap (const char* name) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    cout << name << ": " << chrono::duration<double,milli>(now-last).count() << " ms" << endl;
+    last = now;
+  }
+private:
+  chrono::steady_clock::time_point last;
+};
+#endif
+
 void Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t* dims){
+  match(I1_,I2_,D1,D2,dims,!param.postprocess_only_left,0);
+}
+
+void Elas::process (uint8_t* I1_,uint8_t* I2_,uint8_t* D1,int32_t D1_bpl,float scale,const int32_t* dims,int32_t border){
+
+  // float disparities are only kept internally, the right one is needed
+  // for the L/R consistency check but never postprocessed or returned
+  int32_t D_width  = param.subsampling ? dims[0]/2 : dims[0];
+  int32_t D_height = param.subsampling ? dims[1]/2 : dims[1];
+  D1_buf.resize(D_width*D_height);
+  D2_buf.resize(D_width*D_height);
+  match(I1_,I2_,&D1_buf[0],&D2_buf[0],dims,false,border);
+
+  // the padding columns are not written
+  int32_t u_first = param.subsampling ? border/2 : border;
+  int32_t D_out   = param.subsampling ? (dims[0]-2*border)/2 : dims[0]-2*border;
+
+  // scale and saturate into the 8 bit output (invalid disparities become 0),
+  // quantised to 1/16 pixel first to round like the CV_16S(x16) output
+  float scale_16 = scale/16;
+  for (int32_t v=0; v<D_height; v++) {
+    const float* D1_line = &D1_buf[v*D_width+u_first];
+    uint8_t*     D1_out  = D1+v*D1_bpl;
+    for (int32_t u=0; u<D_out; u++)
+      D1_out[u] = saturate_cast<uint8_t>(saturate_cast<int16_t>(D1_line[u]*16)*scale_16);
+  }
+}
+
+void Elas::match (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t* dims,bool postprocess_right,int32_t border){
   
-  // get width, height and bytes per line
+  // get width, height and bytes per line; the images are read in place,
+  // the descriptors replicate the border columns by clamped indexing
   width  = dims[0];
   height = dims[1];
-  bpl    = width + 15-(width-1)%16;
-  
-  // copy images to byte aligned memory
-  I1 = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-  I2 = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-  memset (I1,0,bpl*height*sizeof(uint8_t));
-  memset (I2,0,bpl*height*sizeof(uint8_t));
-  if (bpl==dims[2]) {
-    memcpy(I1,I1_,bpl*height*sizeof(uint8_t));
-    memcpy(I2,I2_,bpl*height*sizeof(uint8_t));
-  } else {
-    for (int32_t v=0; v<height; v++) {
-      memcpy(I1+v*bpl,I1_+v*dims[2],width*sizeof(uint8_t));
-      memcpy(I2+v*bpl,I2_+v*dims[2],width*sizeof(uint8_t));
-    }
-  }
+  bpl    = dims[2];
+  I1     = I1_;
+  I2     = I2_;
   
   // allocate memory for disparity grid
   int32_t grid_width   = (int32_t)ceil((float)width/(float)param.grid_size);
@@ -59,11 +95,18 @@ void Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
   int32_t* disparity_grid_2 = (int32_t*)calloc((param.disp_max+2)*grid_height*grid_width,sizeof(int32_t));
 
 #ifdef PROFILE
-  CalcTime timer("time",TIME_MSEC,false); 
-  
+  LapTimer timer;
 #endif
-  Descriptor desc1(I1,width,height,bpl,param.subsampling);
-  Descriptor desc2(I2,width,height,bpl,param.subsampling);
+  // descriptors of both images are independent => build them concurrently
+  // on the OpenCV thread pool
+  uint8_t* I[2] = {I1,I2};
+  unique_ptr<Descriptor> desc[2];
+  parallel_for_(Range(0,2),[&](const Range& range){
+    for (int32_t i=range.start; i<range.end; i++)
+      desc[i].reset(new Descriptor(I[i],width,height,bpl,param.subsampling,border));
+  });
+  Descriptor& desc1 = *desc[0];
+  Descriptor& desc2 = *desc[1];
 
 #ifdef PROFILE
   timer.lap("Descriptor");  
@@ -73,14 +116,15 @@ void Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
 #ifdef PROFILE
   timer.lap("Support Matches");
 #endif
-  vector<triangle> tri_1 = computeDelaunayTriangulation(p_support,0);
-  vector<triangle> tri_2 = computeDelaunayTriangulation(p_support,1);
+  // a single triangulation of the support points is shared by both images:
+  // the right image reuses its connectivity with corners moved to u-d and
+  // the t2 planes, which computeDisparityPlanes() fills in the same pass
+  vector<triangle> tri = computeDelaunayTriangulation(p_support,0);
 
 #ifdef PROFILE
   timer.lap("Delaunay Triangulation");
 #endif
-  computeDisparityPlanes(p_support,tri_1,0);
-  computeDisparityPlanes(p_support,tri_2,1);
+  computeDisparityPlanes(p_support,tri,0);
 
 #ifdef PROFILE
   timer.lap("Disparity Planes");
@@ -93,8 +137,8 @@ void Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
 #endif
 
 
-computeDisparity(p_support,tri_1,disparity_grid_1,grid_dims,desc1.I_desc,desc2.I_desc,0,D1);
-computeDisparity(p_support,tri_2,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I_desc,1,D2);
+computeDisparity(p_support,tri,disparity_grid_1,grid_dims,desc1.I_desc,desc2.I_desc,0,D1);
+computeDisparity(p_support,tri,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I_desc,1,D2);
 
 
   
@@ -107,14 +151,14 @@ computeDisparity(p_support,tri_2,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I
   timer.lap("L/R Consistency Check");
 #endif
   removeSmallSegments(D1);
-  if (!param.postprocess_only_left)
+  if (postprocess_right)
     removeSmallSegments(D2);
 
 #ifdef PROFILE
   timer.lap("Remove Small Segments");
 #endif
   gapInterpolation(D1);
-  if (!param.postprocess_only_left)
+  if (postprocess_right)
     gapInterpolation(D2);
 
   if (param.filter_adaptive_mean) {
@@ -122,7 +166,7 @@ computeDisparity(p_support,tri_2,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I
 	  timer.lap("Gap Interpolation");
 #endif
     adaptiveMean(D1);
-    if (!param.postprocess_only_left)
+    if (postprocess_right)
       adaptiveMean(D2);
   }
 
@@ -131,7 +175,7 @@ computeDisparity(p_support,tri_2,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I
 	  timer.lap("Adaptive Mean");
 #endif
     median(D1);
-    if (!param.postprocess_only_left)
+    if (postprocess_right)
       median(D2);
 
 	#ifdef PROFILE
@@ -143,8 +187,6 @@ computeDisparity(p_support,tri_2,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I
   // release memory
   free(disparity_grid_1);
   free(disparity_grid_2);
-  _mm_free(I1);
-  _mm_free(I2);
 }
 
 void Elas::removeInconsistentSupportPoints (int16_t* D_can,int32_t D_can_width,int32_t D_can_height) {
@@ -367,6 +409,97 @@ inline int16_t Elas::computeMatchingDisparity (const int32_t &u,const int32_t &v
     return -1;
 }
 
+inline int16_t Elas::computeLocalMatchingDisparity (const int32_t &u,const int32_t &v,const int32_t &d_pred,
+                                                    uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image) {
+
+  const int32_t u_step      = 2;
+  const int32_t v_step      = 2;
+  const int32_t window_size = 3;
+  const int32_t radius      = min(max(param.temporal_search_radius,2),16);
+
+  int32_t desc_offset_1 = -16*u_step-16*width*v_step;
+  int32_t desc_offset_2 = +16*u_step-16*width*v_step;
+  int32_t desc_offset_3 = -16*u_step+16*width*v_step;
+  int32_t desc_offset_4 = +16*u_step+16*width*v_step;
+
+  __m128i xmm1,xmm2,xmm3,xmm4,xmm5,xmm6;
+
+  // check if we are inside the image region
+  if (u<window_size+u_step || u>width-window_size-1-u_step || v<window_size+v_step || v>height-window_size-1-v_step)
+    return -1;
+
+  // compute desc and start addresses
+  int32_t  line_offset = 16*width*v;
+  uint8_t *I1_line_addr,*I2_line_addr;
+  if (!right_image) {
+    I1_line_addr = I1_desc+line_offset;
+    I2_line_addr = I2_desc+line_offset;
+  } else {
+    I1_line_addr = I2_desc+line_offset;
+    I2_line_addr = I1_desc+line_offset;
+  }
+  uint8_t* I1_block_addr = I1_line_addr+16*u;
+  uint8_t* I2_block_addr;
+
+  // we require at least some texture
+  int32_t sum = 0;
+  for (int32_t i=0; i<16; i++)
+    sum += abs((int32_t)(*(I1_block_addr+i))-128);
+  if (sum<param.support_texture)
+    return -1;
+
+  // search window around the predicted disparity, clipped to the valid range
+  int32_t disp_min_valid = max(param.disp_min,0);
+  int32_t disp_max_valid;
+  if (!right_image) disp_max_valid = min(param.disp_max,u-window_size-u_step);
+  else              disp_max_valid = min(param.disp_max,width-u-window_size-u_step);
+  int32_t d_lo = max(d_pred-radius,disp_min_valid);
+  int32_t d_hi = min(d_pred+radius,disp_max_valid);
+  if (d_hi-d_lo<2)
+    return -1;
+
+  xmm1 = _mm_load_si128((__m128i*)(I1_block_addr+desc_offset_1));
+  xmm2 = _mm_load_si128((__m128i*)(I1_block_addr+desc_offset_2));
+  xmm3 = _mm_load_si128((__m128i*)(I1_block_addr+desc_offset_3));
+  xmm4 = _mm_load_si128((__m128i*)(I1_block_addr+desc_offset_4));
+
+  // best + second best match of the window, as in computeMatchingDisparity
+  int16_t min_1_d = -1;
+  int32_t min_1_E = 32767;
+  int16_t min_2_d = -1;
+  int32_t min_2_E = 32767;
+  for (int32_t d=d_lo; d<=d_hi; d++) {
+    int32_t u_warp = right_image ? u+d : u-d;
+    I2_block_addr = I2_line_addr+16*u_warp;
+    xmm6 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_1));
+    xmm6 = _mm_sad_epu8(xmm1,xmm6);
+    xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_2));
+    xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm2,xmm5),xmm6);
+    xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_3));
+    xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm3,xmm5),xmm6);
+    xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_4));
+    xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm4,xmm5),xmm6);
+    sum = _mm_extract_epi16(xmm6,0)+_mm_extract_epi16(xmm6,4);
+    if (sum<min_1_E) {
+      min_1_E = sum;
+      min_1_d = d;
+    } else if (sum<min_2_E) {
+      min_2_E = sum;
+      min_2_d = d;
+    }
+  }
+
+  // a minimum on the window border (that is not the border of the valid
+  // range) means the match has moved further than the window allows
+  if ((min_1_d==d_lo && d_lo>disp_min_valid) || (min_1_d==d_hi && d_hi<disp_max_valid))
+    return -1;
+
+  // uniqueness: check if the matching ratio is sufficient
+  if (min_2_d>=0 && (float)min_1_E<param.support_threshold*(float)min_2_E)
+    return min_1_d;
+  return -1;
+}
+
 vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t* I2_desc) {
   
   // be sure that at half resolution we only need data
@@ -385,30 +518,150 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
   // loop variables
   int32_t u,v;
   int16_t d,d2;
-   
-  // for all point candidates in image 1 do
-  for (int32_t u_can=1; u_can<D_can_width; u_can++) {
-    u = u_can*D_candidate_stepsize;
-    for (int32_t v_can=1; v_can<D_can_height; v_can++) {
-      v = v_can*D_candidate_stepsize;
-      
-      // initialize disparity candidate to invalid
-      *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = -1;
-      
-      // find forwards
-      d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false);
-      if (d>=0) {
-        
-        // find backwards
-        d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
-        if (d2>=0 && abs(d-d2)<=param.lr_threshold)
-          *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = d;
+
+  // incremental mode: re-use the support points of the previous frame if the
+  // candidate grid did not change and no periodic full search is due
+  bool full_search = !param.temporal_support ||
+                     D_can_prev_width!=D_can_width || D_can_prev_height!=D_can_height ||
+                     support_frames_since_full>=param.temporal_refresh;
+
+  if (full_search) {
+
+    // for all point candidates in image 1 do
+    for (int32_t u_can=1; u_can<D_can_width; u_can++) {
+      u = u_can*D_candidate_stepsize;
+      for (int32_t v_can=1; v_can<D_can_height; v_can++) {
+        v = v_can*D_candidate_stepsize;
+
+        // initialize disparity candidate to invalid
+        *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = -1;
+
+        // find forwards
+        d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false);
+        if (d>=0) {
+
+          // find backwards
+          d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
+          if (d2>=0 && abs(d-d2)<=param.lr_threshold)
+            *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = d;
+        }
+      }
+    }
+    support_frames_since_full = 0;
+    tile_frames_since_search.clear();
+
+  } else {
+
+    // the candidate grid is processed in tiles: previous support points are
+    // only rechecked in a small window around their old disparity, and a tile
+    // falls back to the full search if too few of them are confirmed
+    int32_t tile = max(param.temporal_tile_size,1);
+    int32_t tiles_searched = 0, tiles_total = 0;
+
+    // tiles without previous support points (sky, road, textureless walls)
+    // are only searched fully every temporal_empty_interval frames; the
+    // counters start staggered so these searches spread over the frames
+    int32_t empty_interval = max(param.temporal_empty_interval,1);
+    int32_t new_stride = max(param.temporal_new_stride,1);
+    int32_t num_tiles = ((D_can_width-2)/tile+1)*((D_can_height-2)/tile+1);
+    if ((int32_t)tile_frames_since_search.size()!=num_tiles) {
+      tile_frames_since_search.resize(num_tiles);
+      for (int32_t i=0; i<num_tiles; i++)
+        tile_frames_since_search[i] = i%empty_interval;
+    }
+
+    for (int32_t u_tile=1; u_tile<D_can_width; u_tile+=tile) {
+      for (int32_t v_tile=1; v_tile<D_can_height; v_tile+=tile) {
+        int32_t u_tile_end = min(u_tile+tile,D_can_width);
+        int32_t v_tile_end = min(v_tile+tile,D_can_height);
+        int32_t num_prev = 0, num_confirmed = 0;
+
+        for (int32_t u_can=u_tile; u_can<u_tile_end; u_can++) {
+          u = u_can*D_candidate_stepsize;
+          for (int32_t v_can=v_tile; v_can<v_tile_end; v_can++) {
+            v = v_can*D_candidate_stepsize;
+            int32_t addr = getAddressOffsetImage(u_can,v_can,D_can_width);
+            int16_t d_prev = D_can_prev[addr];
+            *(D_can+addr) = -1;
+            if (d_prev<0)
+              continue;
+            num_prev++;
+            d = computeLocalMatchingDisparity(u,v,d_prev,I1_desc,I2_desc,false);
+            if (d>=0) {
+              d2 = computeLocalMatchingDisparity(u-d,v,d,I1_desc,I2_desc,true);
+              if (d2>=0 && abs(d-d2)<=param.lr_threshold) {
+                *(D_can+addr) = d;
+                num_confirmed++;
+              }
+            }
+          }
+        }
+
+        int32_t& frames_since_search = tile_frames_since_search[tiles_total++];
+        frames_since_search++;
+        if (num_prev>0 && (float)num_confirmed>=param.temporal_min_confirmed*(float)num_prev) {
+
+          // confirmed tile: cells without a confirmed point may show a new
+          // obstacle, they are searched fully on a sparse grid whose phase
+          // moves every frame, each cell once in new_stride^2 frames
+          int32_t phase = support_frames_since_full%(new_stride*new_stride);
+          for (int32_t u_can=u_tile; u_can<u_tile_end; u_can++) {
+            if (u_can%new_stride!=phase%new_stride)
+              continue;
+            u = u_can*D_candidate_stepsize;
+            for (int32_t v_can=v_tile; v_can<v_tile_end; v_can++) {
+              if (v_can%new_stride!=phase/new_stride)
+                continue;
+              v = v_can*D_candidate_stepsize;
+              int32_t addr = getAddressOffsetImage(u_can,v_can,D_can_width);
+              if (*(D_can+addr)>=0)
+                continue;
+              d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false);
+              if (d>=0) {
+                d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
+                if (d2>=0 && abs(d-d2)<=param.lr_threshold)
+                  *(D_can+addr) = d;
+              }
+            }
+          }
+          continue;
+        }
+        if (num_prev==0 && frames_since_search<empty_interval)
+          continue;
+
+        // consistency failed (or nothing tracked for a while) => full search in this tile
+        frames_since_search = 0;
+        tiles_searched++;
+        for (int32_t u_can=u_tile; u_can<u_tile_end; u_can++) {
+          u = u_can*D_candidate_stepsize;
+          for (int32_t v_can=v_tile; v_can<v_tile_end; v_can++) {
+            v = v_can*D_candidate_stepsize;
+            *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = -1;
+            d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false);
+            if (d>=0) {
+              d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
+              if (d2>=0 && abs(d-d2)<=param.lr_threshold)
+                *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = d;
+            }
+          }
+        }
       }
     }
+    support_frames_since_full++;
+#ifdef PROFILE
+    cout << "Support tiles searched: " << tiles_searched << "/" << tiles_total << endl;
+#endif
   }
-  
+
   // remove inconsistent support points
   removeInconsistentSupportPoints(D_can,D_can_width,D_can_height);
+
+  // keep the consistent support points as prediction for the next frame
+  if (param.temporal_support) {
+    D_can_prev.assign(D_can,D_can+D_can_width*D_can_height);
+    D_can_prev_width  = D_can_width;
+    D_can_prev_height = D_can_height;
+  }
   
   // remove support points on straight lines, since they are redundant
   // this reduces the number of triangles a little bit and hence speeds up
@@ -437,7 +690,7 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
   return p_support; 
 }
 
-vector<Elas::triangle> Elas::computeDelaunayTriangulation (vector<support_pt> p_support,int32_t right_image) {
+vector<Elas::triangle> Elas::computeDelaunayTriangulation (const vector<support_pt> &p_support,int32_t right_image) {
 
   // input/output structure for triangulation
   struct triangulateio in, out;
@@ -499,7 +752,7 @@ vector<Elas::triangle> Elas::computeDelaunayTriangulation (vector<support_pt> p_
   return tri;
 }
 
-void Elas::computeDisparityPlanes (vector<support_pt> p_support,vector<triangle> &tri,int32_t right_image) {
+void Elas::computeDisparityPlanes (const vector<support_pt> &p_support,vector<triangle> &tri,int32_t right_image) {
 
   // init matrices
   Matrix A(3,3);
@@ -571,7 +824,7 @@ void Elas::computeDisparityPlanes (vector<support_pt> p_support,vector<triangle>
   }  
 }
 
-void Elas::createGrid(vector<support_pt> p_support,int32_t* disparity_grid,int32_t* grid_dims,bool right_image) {
+void Elas::createGrid(const vector<support_pt> &p_support,int32_t* disparity_grid,int32_t* grid_dims,bool right_image) {
   
   // get grid dimensions
   int32_t grid_width  = grid_dims[1];
@@ -775,7 +1028,7 @@ inline void Elas::findMatch(int32_t &u,int32_t &v,float &plane_a,float &plane_b,
 }
 
 // TODO: %2 => more elegantly
-void Elas::computeDisparity(vector<support_pt> p_support,vector<triangle> tri,int32_t* disparity_grid,int32_t *grid_dims,
+void Elas::computeDisparity(const vector<support_pt> &p_support,const vector<triangle> &tri,int32_t* disparity_grid,int32_t *grid_dims,
                             uint8_t* I1_desc,uint8_t* I2_desc,bool right_image,float* D) {
 
   // number of disparities
@@ -1568,6 +1821,23 @@ void StereoEfficientLargeScale::operator()(cv::Mat& leftim, cv::Mat& rightim, cv
 	Mat temp;
 	StereoEfficientLargeScale::operator()(leftim,rightim,leftdisp,temp,bd);
 }
+
+void StereoEfficientLargeScale::compute(const cv::Mat& leftim, const cv::Mat& rightim, cv::Mat& leftdisp, float scale, int bd)
+{
+	CV_Assert(leftim.type()==CV_8UC1 && rightim.type()==CV_8UC1 && leftim.size()==rightim.size());
+
+	// subsampled disparities start at even columns of the padded image
+	if(elas.param.subsampling) bd += bd&1;
+
+	// the images are matched in place with bd replicated columns on each
+	// side, read by clamped indexing on their own bytes per line
+	CV_Assert(leftim.step==rightim.step);
+	const int32_t dims[3] = {leftim.cols+2*bd,leftim.rows,(int32_t)leftim.step};
+	const int cols = elas.param.subsampling ? leftim.cols/2 : leftim.cols;
+	const int rows = elas.param.subsampling ? leftim.rows/2 : leftim.rows;
+	leftdisp.create(rows,cols,CV_8U);
+	elas.process(leftim.data,rightim.data,leftdisp.data,(int32_t)leftdisp.step,scale,dims,bd);
+}
 /*
 void StereoEfficientLargeScale::check(Mat& leftim, Mat& rightim, Mat& disp, StereoEval& eval)
 {
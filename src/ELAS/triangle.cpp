@@ -1701,6 +1701,84 @@ void pooldeinit(struct memorypool *pool)
   }
 }
 
+/*****************************************************************************/
+/*                                                                           */
+/*  Pool cache.  ELAS triangulates a similarly sized set of support points   */
+/*  every frame, so instead of handing the vertex and triangle pools back    */
+/*  to the operating system at the end of triangulate(), they are parked     */
+/*  here (one cache per thread) and recycled by the next call.  The blocks   */
+/*  are released when the thread exits or by triangulaterelease().           */
+/*                                                                           */
+/*****************************************************************************/
+
+struct poolcache {
+  struct memorypool vertices;
+  struct memorypool triangles;
+
+  poolcache() {
+    poolzero(&vertices);
+    poolzero(&triangles);
+  }
+  ~poolcache() {
+    pooldeinit(&vertices);
+    pooldeinit(&triangles);
+  }
+};
+
+static thread_local struct poolcache cachedpools;
+
+/*****************************************************************************/
+/*                                                                           */
+/*  poolrecycle()   Initialize a pool, reusing the blocks of a cached pool   */
+/*                  if it has the same layout and a large enough first       */
+/*                  block.  Otherwise the cached blocks are freed and a new  */
+/*                  pool is created by poolinit().                           */
+/*                                                                           */
+/*****************************************************************************/
+
+void poolrecycle(struct memorypool *pool, struct memorypool *cached,
+                 int bytecount, int itemcount, int firstitemcount,
+                 int alignment)
+{
+  int alignbytes, itembytes;
+
+  alignbytes = alignment > sizeof(int *) ? alignment : sizeof(int *);
+  itembytes = ((bytecount - 1) / alignbytes + 1) * alignbytes;
+  if (firstitemcount == 0) {
+    firstitemcount = itemcount;
+  }
+
+  if ((cached->firstblock != (int **) NULL) &&
+      (cached->alignbytes == alignbytes) &&
+      (cached->itembytes == itembytes) &&
+      (cached->itemsperblock == itemcount) &&
+      (cached->itemsfirstblock >= firstitemcount)) {
+    /* Take over the cached blocks; poolalloc() walks the existing chain */
+    /*   before it allocates anything new.                               */
+    *pool = *cached;
+    poolzero(cached);
+    poolrestart(pool);
+  } else {
+    pooldeinit(cached);
+    poolzero(cached);
+    poolinit(pool, bytecount, itemcount, firstitemcount, alignment);
+  }
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  triangulaterelease()   Free the pools cached by the calling thread.      */
+/*                                                                           */
+/*****************************************************************************/
+
+void triangulaterelease()
+{
+  pooldeinit(&cachedpools.vertices);
+  poolzero(&cachedpools.vertices);
+  pooldeinit(&cachedpools.triangles);
+  poolzero(&cachedpools.triangles);
+}
+
 /*****************************************************************************/
 /*                                                                           */
 /*  poolalloc()   Allocate space for an item.                                */
@@ -1960,9 +2038,10 @@ void initializevertexpool(struct mesh *m, struct behavior *b)
   }
 
   /* Initialize the pool of vertices. */
-  poolinit(&m->vertices, vertexsize, VERTEXPERBLOCK,
-           m->invertices > VERTEXPERBLOCK ? m->invertices : VERTEXPERBLOCK,
-           sizeof(float));
+  poolrecycle(&m->vertices, &cachedpools.vertices, vertexsize,
+              VERTEXPERBLOCK,
+              m->invertices > VERTEXPERBLOCK ? m->invertices : VERTEXPERBLOCK,
+              sizeof(float));
 }
 
 /*****************************************************************************/
@@ -2012,9 +2091,9 @@ void initializetrisubpools(struct mesh *m, struct behavior *b)
   }
 
   /* Having determined the memory size of a triangle, initialize the pool. */
-  poolinit(&m->triangles, trisize, TRIPERBLOCK,
-           (2 * m->invertices - 2) > TRIPERBLOCK ? (2 * m->invertices - 2) :
-           TRIPERBLOCK, 4);
+  poolrecycle(&m->triangles, &cachedpools.triangles, trisize, TRIPERBLOCK,
+              (2 * m->invertices - 2) > TRIPERBLOCK ?
+              (2 * m->invertices - 2) : TRIPERBLOCK, 4);
 
   if (b->usesegments) {
     /* Initialize the pool of subsegments.  Take into account all eight */
@@ -2170,19 +2249,23 @@ vertex getvertex(struct mesh *m, struct behavior *b, int number)
 
 /*****************************************************************************/
 /*                                                                           */
-/*  triangledeinit()   Free all remaining allocated memory.                  */
+/*  triangledeinit()   Free all remaining allocated memory.  The vertex and  */
+/*                     triangle pools go to the pool cache instead.          */
 /*                                                                           */
 /*****************************************************************************/
 
 void triangledeinit(struct mesh *m, struct behavior *b)
 {
-  pooldeinit(&m->triangles);
+  /* Park the vertex and triangle pools for the next call. */
+  pooldeinit(&cachedpools.triangles);
+  cachedpools.triangles = m->triangles;
   trifree((int *) m->dummytribase);
   if (b->usesegments) {
     pooldeinit(&m->subsegs);
     trifree((int *) m->dummysubbase);
   }
-  pooldeinit(&m->vertices);
+  pooldeinit(&cachedpools.vertices);
+  cachedpools.vertices = m->vertices;
 }
 
 /**                                                                         **/
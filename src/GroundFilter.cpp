@@ -4,6 +4,8 @@ Date:                      2020-12-22
 Description:        GroundFilter
 *****************************************************************/
 
+#include <opencv2/core/hal/intrin.hpp>
+
 #include "Global.h"
 #include "GroundFilter.h"
 
@@ -31,9 +33,8 @@ GroundFilter::GroundFilter(){}
 
 void GroundFilter::FilterBackground(Mat& disparity, int min_disparity){
 
-    Mat temp;
-    inRange(disparity, min_disparity, 255, temp);
-    bitwise_and(disparity, temp, disparity);
+    // keep pixel >= min_disparity, in place
+    if(min_disparity > 0) threshold(disparity, disparity, min_disparity - 1, 0, THRESH_TOZERO);
 
 }
 
@@ -51,24 +52,143 @@ Description: ground filter in v-disparity space
 VDisparityGroundFilter::VDisparityGroundFilter(){}
 
 
+/*Funciton Name: GroundK(), GroundB()                                                              */
+/*Description: current ground line, row = k * disparity + b                     */
+/*Input: void                                                                                                                      */
+/*Output: float ground_k, float ground_b                                                                  */
+
+float VDisparityGroundFilter::GroundK(){
+
+    return ground_k;
+
+}
+
+float VDisparityGroundFilter::GroundB(){
+
+    return ground_b;
+
+}
+
+
+/*Funciton Name: SetGroundPlane(float k, float b)                                              */
+/*Description: set the ground line, e.g. from a prediction                         */
+/*Input: float k, float b - ground line, row = k * disparity + b              */
+/*Output: void                                                                                                                      */
+
+void VDisparityGroundFilter::SetGroundPlane(float k, float b){
+
+    ground_k = k;
+    ground_b = b;
+
+}
+
+
+/*Funciton Name: UpdateRowThreshold(int rows)                                               */
+/*Description: a pixel is ground if r > int(ground_k*pixel+ground_b-ground_tolerance),
+                          the line is monotone in pixel, so every row removes either
+                          pixel < row_threshold[r] (k >= 0) or pixel >= row_threshold[r] (k < 0) */
+/*Input: int rows - number of rows                                                                          */
+/*Output: void                                                                                                                      */
+
+void VDisparityGroundFilter::UpdateRowThreshold(int rows){
+
+    // Same float expression as the per-pixel test, evaluated once per disparity
+    int limit[256];
+    for(int pixel = 0; pixel < 256; pixel++) limit[pixel] = int(ground_k*pixel+ground_b-ground_tolerance);
+
+    row_threshold.resize(rows);
+    int pixel = 0;
+    if(ground_k >= 0){
+        // first pixel which is kept in row r, non-decreasing with r
+        for(int r = 0; r < rows; r++){
+            while(pixel < 256 && limit[pixel] < r) pixel++;
+            row_threshold[r] = pixel;
+        }
+    }
+    else{
+        // first pixel which is removed in row r, non-increasing with r
+        pixel = 256;
+        for(int r = 0; r < rows; r++){
+            while(pixel > 0 && limit[pixel-1] < r) pixel--;
+            row_threshold[r] = pixel;
+        }
+    }
+
+}
+
+
+/*Funciton Name: FilterRow(uchar* row, int cols, int r, int min_disparity)     */
+/*Description: zero ground pixels of row r and pixels below min_disparity,
+                          row_threshold must be up to date                                                      */
+/*Input: uchar* row - pointer to the row
+                int cols - number of columns
+                int r - row index
+                int min_disparity - minimal disparity kept                                                  */
+/*Output: void                                                                                                                      */
+
+void VDisparityGroundFilter::FilterRow(uchar* row, int cols, int r, int min_disparity){
+
+    // Kept pixels are in [low, high)
+    int low = max(min_disparity, 0), high = 256;
+    if(ground_k >= 0) low = max(low, row_threshold[r]);
+    else high = row_threshold[r];
+
+    // whole row kept or removed
+    if(low == 0 && high == 256) return;
+    if(low >= high){
+        memset(row, 0, cols);
+        return;
+    }
+
+    int c = 0;
+#if CV_SIMD128
+    v_uint8x16 v_low = v_setall_u8((uchar)low);
+    v_uint8x16 v_high = v_setall_u8((uchar)(high - 1));
+    v_uint8x16 v_zero = v_setzero_u8();
+    for(; c + 16 <= cols; c += 16){
+        v_uint8x16 pixel = v_load(row + c);
+        v_uint8x16 kept = (pixel >= v_low) & (pixel <= v_high);
+        v_store(row + c, v_select(kept, pixel, v_zero));
+    }
+#endif
+    for(; c < cols; c++){
+        if(row[c] < low || row[c] >= high) row[c] = 0;
+    }
+
+}
+
+
 /*Funciton Name:FilterGround(Mat& disparity)                                             */                            
-/*Description: filter ground according to variables                                        */
+/*Description: filter ground according to variables, with a threshold
+                          per row and a vectorized compare over row pointers        */
 /*Input: Mat& disparity - disparity map                                                               */    
 /*Output: void                                                                                                                 */
 
 void VDisparityGroundFilter::FilterGround(Mat& disparity){
 
-    cout<<"Filtering ground... \tk: "<<ground_k<<"\tb: "<<ground_b<<endl;
-    for (int r = 0; r < disparity.rows;r++) {
-		for (int c = 0; c < disparity.cols;c++){
-			int pixel = disparity.at<uint8_t>(r, c);
-			if (r >int(ground_k*pixel+ground_b-ground_tolerance)) disparity.at<uint8_t>(r, c)=0;
-		}
-	}
+    FilterGround(disparity, 0);
 
 }
 
 
+/*Funciton Name:FilterGround(Mat& disparity, int min_disparity)                 */                            
+/*Description: filter ground and background in one pass                             */
+/*Input: Mat& disparity - disparity map
+                int min_disparity - minimal disparity kept                                              */    
+/*Output: void                                                                                                                 */
+
+void VDisparityGroundFilter::FilterGround(Mat& disparity, int min_disparity){
+
+    CV_Assert(disparity.type() == CV_8UC1);
+
+    UpdateRowThreshold(disparity.rows);
+
+    parallel_for_(Range(0, disparity.rows), [&](const Range& range){
+        for(int r = range.start; r < range.end; r++) FilterRow(disparity.ptr<uchar>(r), disparity.cols, r, min_disparity);
+    });
+
+}
+
 
 /*****************************************************************
 Class Name: MonoGroundFilter
@@ -87,13 +207,19 @@ MonoGroundFilter::MonoGroundFilter(){}
 /*Input: MonoCameraModel* mcm - pointer to a MonoCameraModel
                   string config - path to configuration file                                                                    */    
 
-MonoGroundFilter::MonoGroundFilter(MonoCameraModel* mcm, string config){
+MonoGroundFilter::MonoGroundFilter(MonoCameraModel* mcm, string config): MonoGroundFilter(mcm, DetectionConfig::Load(config).ground){}
 
-    this->mcm = mcm;
 
-    FileStorage fs(config, FileStorage::READ);
+/*Funciton Name: MonoGroundFilter(MonoCameraModel* mcm, const GroundParams& params) */
+/*Description: constructor from parsed configuration                                 */
+/*Input: MonoCameraModel* mcm - pointer to a MonoCameraModel
+                const GroundParams& params - ground parameters                                   */
+
+MonoGroundFilter::MonoGroundFilter(MonoCameraModel* mcm, const GroundParams& params){
+
+    this->mcm = mcm;
 
-    fs["ground_tolerance"] >> ground_tolerance;
+    ground_tolerance = params.ground_tolerance;
 
 }
 
@@ -138,6 +264,123 @@ void MonoGroundFilter::UpdateGroundPlane(){
 
 
 
+/*****************************************************************
+Class Name: UVDisparityHistogram
+Description: U- and V-disparity histograms with 16-bit bins
+*****************************************************************/
+
+/*Funciton Name: UVDisparityHistogram()                                                          */
+/*Description: Default constructor                                                                            */
+/*Input: void                                                                                                                      */
+
+UVDisparityHistogram::UVDisparityHistogram(){
+
+    min_disparity = 0;
+    max_disparity = 0;
+    has_u = false;
+    has_v = false;
+    u_view_count = -1;
+    v_view_count = -1;
+
+}
+
+
+/*Funciton Name: UVDisparityHistogram(int min_disparity, int max_disparity) */
+/*Description: Constructor with the counted range,
+                          min_disparity < pixel < max_disparity                                  */
+/*Input: int min_disparity - minimal disparity (excluded)
+                int max_disparity - number of disparity bins                                     */
+
+UVDisparityHistogram::UVDisparityHistogram(int min_disparity, int max_disparity){
+
+    SetRange(min_disparity, max_disparity);
+    has_u = false;
+    has_v = false;
+    u_view_count = -1;
+    v_view_count = -1;
+
+}
+
+
+/*Funciton Name: SetRange(int min_disparity, int max_disparity)                */
+/*Description: change the counted range                                                             */
+/*Input: int min_disparity - minimal disparity (excluded)
+                int max_disparity - number of disparity bins                                     */
+/*Output: void                                                                                                                     */
+
+void UVDisparityHistogram::SetRange(int min_disparity, int max_disparity){
+
+    this->min_disparity = min_disparity;
+    this->max_disparity = min(max(max_disparity, 0), 256);
+
+}
+
+
+/*Funciton Name: Compute(const Mat& disparity, bool u, bool v, int start_row, int start_column) */
+/*Description: count disparities of a trapezoid area from (start_row, start_column),
+                          both histograms in the same pass                                                                           */
+/*Input: const Mat& disparity - disparity map (CV_8UC1)
+                bool u - calculate u-disparity
+                bool v - calculate v-disparity
+                int start_row - row of the top-left point
+                int start_column - column of the top-left point                                                                */
+/*Output: void                                                                                                                                                       */
+
+void UVDisparityHistogram::Compute(const Mat& disparity, bool u, bool v, int start_row, int start_column){
+
+    Sweep(disparity, u, v, start_row, start_column, [](uchar*, int){});
+
+}
+
+
+/*Funciton Name: U(), V()                                                                                         */
+/*Description: counts of the last Compute (CV_16U)                                      */
+/*Input: void                                                                                                                      */
+/*Output: Mat u_hist, Mat v_hist                                                                              */
+
+Mat UVDisparityHistogram::U(){
+
+    return has_u ? u_hist : Mat();
+
+}
+
+Mat UVDisparityHistogram::V(){
+
+    return has_v ? v_hist : Mat();
+
+}
+
+
+/*Funciton Name: UView(int min_count), VView(int min_count)                       */
+/*Description: 255 where count > min_count, computed once per Compute
+                          and min_count, valid until the next Compute                          */
+/*Input: int min_count - minimal count                                                                 */
+/*Output: Mat u_view, Mat v_view (CV_8U)                                                           */
+
+Mat UVDisparityHistogram::UView(int min_count){
+
+    if(!has_u) return Mat();
+    if(u_view_count != min_count){
+        compare(u_hist, min_count, u_view, CMP_GT);
+        u_view_count = min_count;
+    }
+    return u_view;
+
+}
+
+Mat UVDisparityHistogram::VView(int min_count){
+
+    if(!has_v) return Mat();
+    if(v_view_count != min_count){
+        compare(v_hist, min_count, v_view, CMP_GT);
+        v_view_count = min_count;
+    }
+    return v_view;
+
+}
+
+
+
 /*****************************************************************
 Class Name: OnlineGroundFilter
 Description: ground plane is calculated from v-disparity online
@@ -147,21 +390,34 @@ Description: ground plane is calculated from v-disparity online
 /*Description: Default constructor                                                                    */
 /*Input: void                                                                                                               */    
 
-OnlineGroundFilter::OnlineGroundFilter(){}
+OnlineGroundFilter::OnlineGroundFilter(){
+
+    uv_start_row = 0;
+    uv_start_column = 0;
+
+}
 
 
 /*Funciton Name: OnlineGroundFilter(string config)                 		          */
 /*Description: constructor from configuration file                                     */
 /*Input: string config - path to configuration file                                        */  
 
-OnlineGroundFilter::OnlineGroundFilter(string config){
+OnlineGroundFilter::OnlineGroundFilter(string config): OnlineGroundFilter(DetectionConfig::Load(config).ground){}
+
+
+/*Funciton Name: OnlineGroundFilter(const GroundParams& params)                 */
+/*Description: constructor from parsed configuration                                 */
+/*Input: const GroundParams& params - ground parameters                            */
+
+OnlineGroundFilter::OnlineGroundFilter(const GroundParams& params){
 
-    FileStorage fs(config, FileStorage::READ);
+    ground_tolerance = params.ground_tolerance;
+    min_count = params.min_count;
+    max_disparity = params.max_disparity;
+    min_disparity = params.min_disparity;
 
-    fs["ground_tolerance"] >> ground_tolerance;
-    fs["min_count"] >> min_count;
-    fs["max_disparity"] >> max_disparity;
-    fs["min_disparity"] >> min_disparity;
+    uv_start_row = 0;
+    uv_start_column = 0;
 
 }
 
@@ -178,32 +434,16 @@ OnlineGroundFilter::OnlineGroundFilter(string config){
 
 void OnlineGroundFilter::CalcUVdisp(Mat disparity, bool u, bool v, int start_row, int start_column){
 
+    uv_start_row = start_row;
+    uv_start_column = start_column;
 
-    u_disparity= Mat:: zeros(Size(disparity.cols, max_disparity), CV_8UC1);
-    v_disparity = Mat:: zeros(Size(max_disparity, disparity.rows), CV_8UC1);
-
-    for (int r = start_row; r < disparity.rows;r++) {
-
-        int c_left = int(start_column - start_column * (r-start_row)/(v_disparity.rows-start_row));
-        int c_right = disparity.cols-c_left;
-
-        for (int c = c_left; c < c_right;c++) {
-            int pixel = disparity.at<uint8_t>(r, c);
-            if (pixel > min_disparity){
-                if(v)   v_disparity.at<uint8_t>(r, pixel)++;
-                if(u)   u_disparity.at<uint8_t>(pixel, c)++;
-            }
-        }
-    }
-
-    // Filter weak counts
-    if(v)   threshold(v_disparity, v_disparity, min_count, 255, THRESH_BINARY);
-    if(u)   threshold(u_disparity, u_disparity, min_count, 255, THRESH_BINARY);
+    histogram.SetRange(min_disparity, max_disparity);
+    histogram.Compute(disparity, u, v, start_row, start_column);
 
     // Visualize
     if(VISUAL_U_V_DISPARITY){
-        if(u)   cv::imshow("u-disparity", u_disparity);
-        if(v)   cv::imshow("v_disparity", v_disparity);
+        if(u)   cv::imshow("u-disparity", histogram.UView(min_count));
+        if(v)   cv::imshow("v_disparity", histogram.VView(min_count));
     }
 
 }
@@ -219,22 +459,10 @@ void OnlineGroundFilter::CalcUVdisp(Mat disparity, bool u, bool v, int start_row
 
 Mat OnlineGroundFilter::Udisparity(Mat disparity, int min_disp, int max_disp, int min_count){
 
-    Mat temp = Mat:: zeros(Size(disparity.cols, max_disparity), CV_8UC1);
-    
-    // Calculate
-    for (int r = 0; r < disparity.rows;r++) {
-        for (int c = 0; c < disparity.cols;c++) {
-            int pixel = disparity.at<uint8_t>(r, c);
-            if (pixel > min_disparity){
-                temp.at<uint8_t>(pixel, c)++;
-            }
-        }
-    }
-
-    // Filter weak counts
-    threshold(temp, temp, min_count, 255, THRESH_BINARY);
+    histogram.SetRange(min_disp, max_disp);
+    histogram.Compute(disparity, true, false);
 
-    return temp;
+    return histogram.UView(min_count);
 
 }
 
@@ -249,22 +477,63 @@ Mat OnlineGroundFilter::Udisparity(Mat disparity, int min_disp, int max_disp, in
 
 Mat OnlineGroundFilter::Vdisparity(Mat disparity, int min_disp, int max_disp, int min_count){
 
-    Mat temp = Mat:: zeros(Size(max_disparity, disparity.rows), CV_8UC1);
+    histogram.SetRange(min_disp, max_disp);
+    histogram.Compute(disparity, false, true);
 
-    // Calculate
-    for (int r = 0; r < disparity.rows;r++) {
-        for (int c = 0; c < disparity.cols;c++) {
-            int pixel = disparity.at<uint8_t>(r, c);
-            if (pixel > min_disparity){
-                temp.at<uint8_t>(r, pixel)++;
-            }
+    return histogram.VView(min_count);
+
+}
+
+
+/*Funciton Name: FitGroundPlane()                                                                           */
+/*Description: update ground_k and ground_b from the current v-disparity,
+                          nothing to fit for the base class                                                      */
+/*Input: void                                                                                                                      */
+/*Output: void                                                                                                                  */
+
+void OnlineGroundFilter::FitGroundPlane(){}
+
+
+/*Funciton Name: UpdateGroundPlane(Mat disparity)                                          */
+/*Description: update ground_k and ground_b from disparity map      */
+/*Input: Mat disparity - diaprity map                                                                     */
+/*Output: void                                                                                                                  */
+
+void OnlineGroundFilter::UpdateGroundPlane(Mat disparity){
+
+    CalcUVdisp(disparity, false, true);
+    FitGroundPlane();
+
+}
+
+
+/*Funciton Name: FilterGround(Mat& disparity, int min_disparity, int iterations)  */
+/*Description: iterated ground filtering after UpdateGroundPlane: every pass
+                          removes ground and accumulates the v-disparity for the next
+                          fit, the last pass also removes pixels below min_disparity  */
+/*Input: Mat& disparity - disparity map
+                int min_disparity - minimal disparity kept
+                int iterations - number of filtering passes                                                  */
+/*Output: void                                                                                                                             */
+
+void OnlineGroundFilter::FilterGround(Mat& disparity, int min_disparity, int iterations){
+
+    for(int i = 0; i < iterations; i++){
+
+        if(i + 1 == iterations){
+            FilterGround(disparity, min_disparity);
+            break;
         }
-    }
 
-    // Filter weak counts
-    threshold(temp, temp, min_count, 255, THRESH_BINARY);
+        // Filter and count in the same sweep, then refit on the filtered map
+        UpdateRowThreshold(disparity.rows);
+        histogram.SetRange(this->min_disparity, max_disparity);
+        histogram.Sweep(disparity, false, true, uv_start_row, uv_start_column, [&](uchar* row, int r){
+            FilterRow(row, disparity.cols, r, 0);
+        });
+        FitGroundPlane();
 
-    return temp;
+    }
 
 }
 
@@ -286,54 +555,61 @@ HoughGroundFilter::HoughGroundFilter(){}
 /*Description: constructor from configuration file                                     */
 /*Input: string config - path to configuration file                                        */  
 
-HoughGroundFilter::HoughGroundFilter(string config): OnlineGroundFilter(config){
+HoughGroundFilter::HoughGroundFilter(string config): HoughGroundFilter(DetectionConfig::Load(config).ground){}
 
 
-    FileStorage fs(config, FileStorage::READ);
+/*Funciton Name: HoughGroundFilter(const GroundParams& params)                  */
+/*Description: constructor from parsed configuration                                 */
+/*Input: const GroundParams& params - ground parameters                            */
 
-    fs["hough_min_count"] >> hough_min_count;
-    fs["hough_min_length"] >> hough_min_length;
-    fs["hough_max_gap"] >> hough_max_gap;
+HoughGroundFilter::HoughGroundFilter(const GroundParams& params): OnlineGroundFilter(params){
+
+    hough_min_count = params.hough_min_count;
+    hough_min_length = params.hough_min_length;
+    hough_max_gap = params.hough_max_gap;
 
 }
 
 
-/*Funciton Name: UpdateGroundPlane(Mat disparity)           		              */
-/*Description: update ground_k and ground_b from disparity map      */
-/*Input: Mat disparity - diaprity map                                                                     */  
+/*Funciton Name: FitGroundPlane()                                                                           */
+/*Description: update ground_k and ground_b from the current v-disparity */
+/*Input: void                                                                                                                      */
 /*Output: void                                                                                                                  */
 
-void HoughGroundFilter::UpdateGroundPlane(Mat disparity){
+void HoughGroundFilter::FitGroundPlane(){
 
-    CalcUVdisp(disparity, false, true);
+    Mat v_disparity = histogram.VView(min_count);
 
     // Detect ground line in V-Disparity
-    Mat dst, cdst, cdstP;
+    Mat dst;
     // Edge detection
     Canny(v_disparity, dst, 50, 100, 3);
-    // Copy edges to the images that will display the results in BGR
-    cv::cvtColor(dst, cdstP, COLOR_GRAY2BGR);
     // Probabilistic Line Transform
     vector<Vec4i> linesP; // will hold the results of the detection
     HoughLinesP(dst, linesP, 1, CV_PI / 180, hough_min_count, hough_min_length, hough_max_gap); // runs the actual detection
-    Vec4i line_ground;
-    float maxLength;
-    double slope_threshold = 0;
-
-    if (linesP.size() > 0) {
-        // Find line with max length
-        for (size_t i = 0; i < linesP.size(); i++){
-            Vec4i l = linesP[i];
-            double length = sqrt(pow(l[3] - l[1], 2) + pow(l[2] - l[0], 2));
-            if(length > maxLength) line_ground = l;
+
+    // Keep the last ground line without detection
+    if(linesP.empty()) return;
+
+    // Find line with max length
+    Vec4i line_ground = linesP[0];
+    double maxLength = 0;
+    for (size_t i = 0; i < linesP.size(); i++){
+        Vec4i l = linesP[i];
+        double length = sqrt(pow(l[3] - l[1], 2) + pow(l[2] - l[0], 2));
+        if(length > maxLength){
+            maxLength = length;
+            line_ground = l;
         }
     }
     // Update k and b
     ground_k = (line_ground[3] - line_ground[1]) / ((line_ground[2] - line_ground[0]) + 0.0001);
     ground_b = line_ground[3] - ground_k * line_ground[2];
 
-    // Show results
+    // Show results, the BGR copy only for display
     if(VISUAL_U_V_DISPARITY){
+        Mat cdstP;
+        cvtColor(dst, cdstP, COLOR_GRAY2BGR);
         line(cdstP, Point(line_ground[0], line_ground[1]), Point(line_ground[2], line_ground[3]), Scalar(0, 255, 255), 1, LINE_AA);
         imshow("Ground Line - Probabilistic Line Transform", cdstP);
     }
@@ -360,16 +636,22 @@ RANSACGroundFilter::RANSACGroundFilter(){}
 /*Description: constructor from configuration file                                     */
 /*Input: string config - path to configuration file                                        */  
 
-RANSACGroundFilter::RANSACGroundFilter(string config): OnlineGroundFilter(config){
+RANSACGroundFilter::RANSACGroundFilter(string config): RANSACGroundFilter(DetectionConfig::Load(config).ground){}
+
+
+/*Funciton Name: RANSACGroundFilter(const GroundParams& params)                 */
+/*Description: constructor from parsed configuration                                 */
+/*Input: const GroundParams& params - ground parameters                            */
 
-    FileStorage fs(config, FileStorage::READ);
+RANSACGroundFilter::RANSACGroundFilter(const GroundParams& params): OnlineGroundFilter(params){
 
-    fs["num_samples"] >> num_samples;
-    fs["distance_threshold"] >> distance_threshold;
-    fs["start_row"] >> start_row;
-    fs["start_column"] >> start_column;
-    fs["max_iteration"] >> max_iteration;
-    fs["num_median_filter"] >> num_median_filter;
+    num_samples = params.num_samples;
+    distance_threshold = params.distance_threshold;
+    start_row = params.start_row;
+    start_column = params.start_column;
+    max_iteration = params.max_iteration;
+    num_median_filter = params.num_median_filter;
+    seed = params.ransac_seed;
 
     mfk = MedianFilter(num_median_filter);
     mfb = MedianFilter(num_median_filter);
@@ -384,19 +666,31 @@ RANSACGroundFilter::RANSACGroundFilter(string config): OnlineGroundFilter(config
 
 void RANSACGroundFilter::UpdateGroundPlane(Mat disparity){
 
-
     // Calculate V-Disparity
     CalcUVdisp(disparity, false, true, start_row, start_column);
+    FitGroundPlane();
+
+}
+
+
+/*Funciton Name: FitGroundPlane()                                                                           */
+/*Description: update ground_k and ground_b from the current v-disparity */
+/*Input: void                                                                                                                      */
+/*Output: void                                                                                                                  */
+
+void RANSACGroundFilter::FitGroundPlane(){
 
     // Calculate point list
     UpdateList();
 
     // Run RANSAC if num_data>num_samples
-    if(list_point.size()>num_samples){
+    if(point_x.size()>num_samples && num_samples>=2){
 
         last_ground_k = ground_k;
         last_ground_b = ground_b;
 
+        // Same input, same line
+        rng = RNG(seed);
         max_cost = 0;
 
         // Start iteration
@@ -408,29 +702,27 @@ void RANSACGroundFilter::UpdateGroundPlane(Mat disparity){
             // Calculate line from sample
             LineModel temp = ComputeLine();
             
-            // // Compute cost from sample
-            int cost = ComputeCost(temp);
+            // Compute cost from sample, give up once it cannot win
+            float cost = ComputeCost(temp, max_cost);
 
             // Update ground line if the sample brings more inliers
             if(cost>max_cost){
                 max_cost = cost;
-                ground_line = ComputeLine();
+                ground_line = temp;
             }
 
         }
 
-        // conver to k and b
-        int temp_k = int(ground_line.my / (ground_line.mx + 1e-6));
-        if(isless(abs(temp_k), 10000) ){
-            int temp_b = int( v_disparity.rows - int(ground_line.sy - temp_k * ground_line.sx));
-            if(isgreater(temp_b, 0)&&isless(temp_b, 100)){
-                ground_k = mfk.Filter(abs(temp_k));
-                ground_b = mfb.Filter(temp_b);
-            }
-            // ground_b =  v_disparity.rows - int(ground_line.sy - temp_k * ground_line.sx);
+        // Least squares on the inliers, row = k * disparity + b
+        float k, b;
+        int rows = histogram.V().rows;
+        if(max_cost>0 && RefitLine(ground_line, k, b) && k>0 && k<10000 && b>0 && b<rows){
+            ground_k = mfk.Filter(k);
+            ground_b = mfb.Filter(b);
         }
 
         if(VISUAL_U_V_DISPARITY){
+            Mat v_disparity = histogram.VView(min_count);
             Mat visual_v_disparity;
             cvtColor(v_disparity, visual_v_disparity, COLOR_GRAY2RGB);
             line(visual_v_disparity, Point(0, ground_b), Point(int((v_disparity.rows-ground_b)/ground_k), v_disparity.rows), Scalar(0, 255, 255), 1, LINE_AA);
@@ -443,20 +735,30 @@ void RANSACGroundFilter::UpdateGroundPlane(Mat disparity){
 
 
 /*Funciton Name: UpdateList()                                                             		              */
-/*Description: update list_point from v_disparity                                            */
+/*Description: update the point arrays from the v-disparity counts           */
 /*Input: void                                                                                                                      */  
 /*Output: void                                                                                                                  */
 
 void RANSACGroundFilter::UpdateList(){
 
-    list_point.clear();
-
-    for(int r=start_row; r<v_disparity.rows; r++){
-
-        for(int c=0; c<v_disparity.cols; c++){
-        // for(int c=c_left; c<c_right; c++){
-            if(v_disparity.at<uint8_t>(r,c)>0){
-                list_point.push_back(Point2f(c,v_disparity.rows-r));
+    point_x.clear();
+    point_y.clear();
+    point_w.clear();
+    point_cumulative.clear();
+    total_weight = 0;
+
+    Mat counts = histogram.V();
+    if(counts.empty()) return;
+
+    for(int r=max(start_row, 0); r<counts.rows; r++){
+        const ushort* row = counts.ptr<ushort>(r);
+        for(int c=0; c<counts.cols; c++){
+            if(row[c]>min_count){
+                point_x.push_back(c);
+                point_y.push_back(r);
+                point_w.push_back(row[c]);
+                total_weight += row[c];
+                point_cumulative.push_back(total_weight);
             }
         }
     }
@@ -465,24 +767,25 @@ void RANSACGroundFilter::UpdateList(){
 
 
 /*Funciton Name: GetRandomSamples()                                                                      */
-/*Description: get samples from list_point and save to list_sample_point    */
+/*Description: draw num_samples points, weighted by count, to list_sample */
 /*Input: void                                                                                                                               */  
 /*Output: void                                                                                                                           */
 
 void RANSACGroundFilter::GetRandomSamples(){
 
-    list_sample_point.clear();
+    list_sample.resize(num_samples);
 
     for(int i=0; i<num_samples; i++){
-        int temp = rand() % list_point.size();
-        list_sample_point.push_back(list_point[temp]);
+        float u = rng.uniform(0.f, total_weight);
+        int index = int(upper_bound(point_cumulative.begin(), point_cumulative.end(), u) - point_cumulative.begin());
+        list_sample[i] = min(index, (int)point_x.size() - 1);
     }
 
 }
 
 
 /*Funciton Name: ComputeLine()                                                                                     */
-/*Description: compute a line from list_sample_point                                           */
+/*Description: compute a line from list_sample (principal axis)                      */
 /*Input: void                                                                                                                               */  
 /*Output: LineModel line                                                                                                      */
 
@@ -496,8 +799,8 @@ LineModel RANSACGroundFilter::ComputeLine(){
 
 	for (int i = 0; i<num_samples; i++)
 	{
-        float x = list_sample_point[i].x;
-        float y = list_sample_point[i].y;
+        float x = point_x[list_sample[i]];
+        float y = point_y[list_sample[i]];
 
 		sx += x;
 		sy += y;
@@ -527,29 +830,48 @@ LineModel RANSACGroundFilter::ComputeLine(){
 }
 
 
-/*Funciton Name: ComputeCost(LineModel line)                                                      */
-/*Description: find inliers for a given line and count newly added inliers       */
-/*Input: void                                                                                                                               */  
-/*Output: LineModel line                                                                                                      */
+/*Funciton Name: ComputeCost(LineModel line, float best)                                 */
+/*Description: sum of inlier counts of a line, stops as soon as the line
+                          can no longer beat best                                                                             */
+/*Input: LineModel line - line with unit direction
+                float best - score to beat                                                                                    */  
+/*Output: float cost                                                                                                                  */
 
-int RANSACGroundFilter::ComputeCost(LineModel line){
+float RANSACGroundFilter::ComputeCost(LineModel line, float best){
 
-    list_inliers.clear();
-    num_inliers = 0;
+    const float* x = point_x.data();
+    const float* y = point_y.data();
+    const float* w = point_w.data();
+    int n = (int)point_x.size();
+    const int block = 256;
 
-    int cost = 0.;
+    float cost = 0;
 
-    for(int i=0; i<list_point.size(); i++){
+    for(int start=0; start<n; start+=block){
 
-        float dist = ComputeDistance(line, list_point[i]);
+        int end = min(n, start + block);
+        int i = start;
 
-        // Is inlier if dist less than threshold
-        if(isless(dist, distance_threshold)){
-            list_inliers.push_back(list_point[i]);
-            num_inliers++;
-            cost ++;
+#if CV_SIMD128
+        v_float32x4 v_sx = v_setall_f32(line.sx), v_sy = v_setall_f32(line.sy);
+        v_float32x4 v_mx = v_setall_f32(line.mx), v_my = v_setall_f32(line.my);
+        v_float32x4 v_threshold = v_setall_f32(distance_threshold);
+        v_float32x4 v_zero = v_setzero_f32(), v_cost = v_setzero_f32();
+        for(; i+4<=end; i+=4){
+            v_float32x4 dist = v_abs((v_load(x+i) - v_sx)*v_my - (v_load(y+i) - v_sy)*v_mx);
+            v_cost += v_select(dist < v_threshold, v_load(w+i), v_zero);
+        }
+        cost += v_reduce_sum(v_cost);
+#endif
+        for(; i<end; i++){
+            float dist = fabs((x[i] - line.sx)*line.my - (y[i] - line.sy)*line.mx);
+            // Is inlier if dist less than threshold
+            if(dist < distance_threshold) cost += w[i];
         }
 
+        // Remaining points cannot make this line better than best
+        if(cost + (total_weight - point_cumulative[end-1]) <= best) break;
+
     }
 
     return cost;
@@ -557,14 +879,383 @@ int RANSACGroundFilter::ComputeCost(LineModel line){
 }
 
 
-/*Funciton Name: ComputeDistance(LineModel line, Point p)                            */
-/*Description: compute point to line distance                                                            */
-/*Input: LineModel line - line
-                 Point p - point                                                                                                           */  
-/*Output: float distance                                                                                                        */
+/*Funciton Name: RefitLine(LineModel line, float& k, float& b)                          */
+/*Description: weighted least squares row = k * disparity + b on the inliers of line */
+/*Input: LineModel line - line with unit direction
+                float& k, float& b - fitted line                                                                      */  
+/*Output: bool success                                                                                                            */
+
+bool RANSACGroundFilter::RefitLine(LineModel line, float& k, float& b){
+
+    double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    for(size_t i=0; i<point_x.size(); i++){
+        float dist = fabs((point_x[i] - line.sx)*line.my - (point_y[i] - line.sy)*line.mx);
+        if(dist >= distance_threshold) continue;
+        double w = point_w[i], x = point_x[i], y = point_y[i];
+        sw += w;
+        sx += w*x;
+        sy += w*y;
+        sxx += w*x*x;
+        sxy += w*x*y;
+    }
+
+    double det = sw*sxx - sx*sx;
+    if(sw <= 0 || fabs(det) < 1e-9) return false;
+
+    k = float((sw*sxy - sx*sy)/det);
+    b = float((sy - k*sx)/sw);
+    return true;
+
+}
+
+
+
+/*****************************************************************
+Class Name: PeakGroundFilter
+Description: ground line fitted to the per-row peaks of the v-disparity
+*****************************************************************/
+
+/*Funciton Name: PeakGroundFilter()                                                                     */
+/*Description: Default constructor                                                                            */
+/*Input: void                                                                                                                      */
+
+PeakGroundFilter::PeakGroundFilter(){}
+
+
+/*Funciton Name: PeakGroundFilter(string config)                                             */
+/*Description: constructor from configuration file                                     */
+/*Input: string config - path to configuration file                                        */
+
+PeakGroundFilter::PeakGroundFilter(string config): PeakGroundFilter(DetectionConfig::Load(config).ground){}
+
+
+/*Funciton Name: PeakGroundFilter(const GroundParams& params)                      */
+/*Description: constructor from parsed configuration                                 */
+/*Input: const GroundParams& params - ground parameters                            */
+
+PeakGroundFilter::PeakGroundFilter(const GroundParams& params): OnlineGroundFilter(params){
+
+    start_row = params.start_row;
+    start_column = params.start_column;
+    huber_delta = params.huber_delta;
+    irls_iterations = params.irls_iterations;
+    num_median_filter = params.num_median_filter;
+
+    mfk = MedianFilter(num_median_filter);
+    mfb = MedianFilter(num_median_filter);
+
+}
+
+
+/*Funciton Name: UpdateGroundPlane(Mat disparity)                                          */
+/*Description: update ground_k and ground_b from disparity map      */
+/*Input: Mat disparity - diaprity map                                                                     */
+/*Output: void                                                                                                                  */
+
+void PeakGroundFilter::UpdateGroundPlane(Mat disparity){
+
+    CalcUVdisp(disparity, false, true, start_row, start_column);
+    FitGroundPlane();
+
+}
+
+
+/*Funciton Name: FitGroundPlane()                                                                           */
+/*Description: update ground_k and ground_b from the current v-disparity */
+/*Input: void                                                                                                                      */
+/*Output: void                                                                                                                  */
+
+void PeakGroundFilter::FitGroundPlane(){
+
+    UpdatePeaks();
+
+    float k, b;
+    int rows = histogram.V().rows;
+    if(FitLine(k, b) && k>0 && k<10000 && b>0 && b<rows){
+        ground_k = mfk.Filter(k);
+        ground_b = mfb.Filter(b);
+    }
+
+    if(VISUAL_U_V_DISPARITY){
+        Mat v_disparity = histogram.VView(min_count);
+        Mat visual_v_disparity;
+        cvtColor(v_disparity, visual_v_disparity, COLOR_GRAY2RGB);
+        for(size_t i=0; i<peak_x.size(); i++) visual_v_disparity.at<Vec3b>(int(peak_y[i]), int(peak_x[i])) = Vec3b(0, 0, 255);
+        line(visual_v_disparity, Point(0, ground_b), Point(int((v_disparity.rows-ground_b)/ground_k), v_disparity.rows), Scalar(0, 255, 255), 1, LINE_AA);
+        imshow("Peak line detection", visual_v_disparity);
+    }
+
+}
+
+
+/*Funciton Name: UpdatePeaks()                                                                             */
+/*Description: collect the argmax disparity of every v-disparity row,
+                          refined to sub-pixel by a parabola through the neighbours */
+/*Input: void                                                                                                                      */
+/*Output: void                                                                                                                  */
+
+void PeakGroundFilter::UpdatePeaks(){
+
+    peak_x.clear();
+    peak_y.clear();
+    peak_w.clear();
+
+    Mat counts = histogram.V();
+    if(counts.empty()) return;
+
+    for(int r=max(start_row, 0); r<counts.rows; r++){
+
+        const ushort* row = counts.ptr<ushort>(r);
+        int peak = 0;
+        for(int c=1; c<counts.cols; c++) if(row[c]>row[peak]) peak = c;
+        if(row[peak]<=min_count) continue;
+
+        float x = peak;
+        if(peak>0 && peak<counts.cols-1){
+            float left = row[peak-1], center = row[peak], right = row[peak+1];
+            float curvature = left - 2*center + right;
+            if(curvature<0) x += 0.5f*(left - right)/curvature;
+        }
+
+        peak_x.push_back(x);
+        peak_y.push_back(r);
+        peak_w.push_back(row[peak]);
+
+    }
+
+}
+
+
+/*Funciton Name: FitLine(float& k, float& b)                                                      */
+/*Description: Huber IRLS disparity = a * row + c on the peaks, the peaks
+                          are noisy in disparity only; k = 1 / a, b = - c / a                */
+/*Input: float& k, float& b - fitted line                                                                */
+/*Output: bool success                                                                                                     */
+
+bool PeakGroundFilter::FitLine(float& k, float& b){
+
+    if(peak_x.size()<2) return false;
+
+    double a = 0, c = 0;
+    bool fitted = false;
+    for(int it=0; it<=irls_iterations; it++){
+
+        double sw = 0, sr = 0, sd = 0, srr = 0, srd = 0;
+        for(size_t i=0; i<peak_x.size(); i++){
+            double w = peak_w[i], d = peak_x[i], r = peak_y[i];
+            // Huber weight of the residual of the previous fit
+            if(fitted){
+                double residual = fabs(d - (a*r + c));
+                if(huber_delta>0 && residual>huber_delta) w *= huber_delta/residual;
+            }
+            sw += w;
+            sr += w*r;
+            sd += w*d;
+            srr += w*r*r;
+            srd += w*r*d;
+        }
+
+        double det = sw*srr - sr*sr;
+        if(sw <= 0 || fabs(det) < 1e-9) break;
+
+        double new_a = (sw*srd - sr*sd)/det;
+        double new_c = (sd - new_a*sr)/sw;
+        bool converged = fitted && fabs(new_a - a)<1e-6 && fabs(new_c - c)<1e-3;
+        a = new_a;
+        c = new_c;
+        fitted = true;
+        if(converged) break;
+
+    }
+
+    if(!fitted || a<=0) return false;
+
+    k = float(1/a);
+    b = float(-c/a);
+    return true;
+
+}
+
+
+
+/*****************************************************************
+Class Name: PredictedGroundFilter
+Description: ground line predicted from the camera pose
+*****************************************************************/
+
+/*Funciton Name: PredictedGroundFilter()                                                          */
+/*Description: Default constructor                                                                            */
+/*Input: void                                                                                                                      */
+
+PredictedGroundFilter::PredictedGroundFilter(){
+
+    cam_height = NULL;
+    cam_theta = NULL;
+    valid = false;
+    num_frames = 0;
+    num_skipped = 0;
+    last_skipped = false;
+    last_time = 0;
+
+}
+
+
+/*Funciton Name: PredictedGroundFilter(CameraModel* cm, string config)    */
+/*Description: constructor with camera model and configuration file      */
+/*Input: CameraModel* cm - pointer to a CameraModel
+                string config - path to configuration file                                                */
+
+PredictedGroundFilter::PredictedGroundFilter(CameraModel* cm, string config): PredictedGroundFilter(cm, DetectionConfig::Load(config).ground){}
+
+
+/*Funciton Name: PredictedGroundFilter(CameraModel* cm, const GroundParams& params) */
+/*Description: constructor from parsed configuration                                 */
+/*Input: CameraModel* cm - pointer to a CameraModel
+                const GroundParams& params - ground parameters                                   */
+
+PredictedGroundFilter::PredictedGroundFilter(CameraModel* cm, const GroundParams& params): PredictedGroundFilter(){
+
+    f = cm->F();
+
+    max_age = params.ground_max_age;
+    verify_step = params.ground_verify_step;
+    verify_tolerance = params.ground_verify_tolerance;
+    verify_ratio = params.ground_verify_ratio;
+
+}
+
+
+/*Funciton Name: SetPoseSource(float* cam_height, float* cam_theta)        */
+/*Description: set the pose source, without it every frame is estimated */
+/*Input: float* cam_height - camera height (m)
+                float* cam_theta - camera pitch (degree)                                            */
+/*Output: void                                                                                                                      */
+
+void PredictedGroundFilter::SetPoseSource(float* cam_height, float* cam_theta){
+
+    this->cam_height = cam_height;
+    this->cam_theta = cam_theta;
+
+}
+
+
+/*Funciton Name: Verify(Mat disparity, float k, float b)                                   */
+/*Description: fraction of sampled valid pixels below the horizon that lie
+                          on the ground line                                                                             */
+/*Input: Mat disparity - disparity map
+                float k, float b - ground line                                                                   */
+/*Output: float ratio                                                                                                            */
+
+float PredictedGroundFilter::Verify(Mat disparity, float k, float b){
+
+    if(!(k > 0)) return 0;
+
+    long num_valid = 0, num_ground = 0;
+    for(int r = max(0, (int)ceil(b)); r < disparity.rows; r += verify_step){
+        float ground = (r - b)/k;
+        const uchar* row = disparity.ptr<uchar>(r);
+        for(int c = 0; c < disparity.cols; c += verify_step){
+            if(row[c] == 0) continue;
+            num_valid++;
+            num_ground += fabs(row[c] - ground) <= verify_tolerance;
+        }
+    }
+
+    return num_valid > 0 ? (float)num_ground/num_valid : 0;
+
+}
+
+
+/*Funciton Name: FilterGround(OnlineGroundFilter& filter, Mat& disparity, int min_disparity, int iterations) */
+/*Description: filter ground with the predicted line if it passes the check,
+                          otherwise UpdateGroundPlane and iterated FilterGround of filter                      */
+/*Input: OnlineGroundFilter& filter - online ground filter
+                Mat& disparity - disparity map
+                int min_disparity - minimal disparity kept
+                int iterations - number of filtering passes of a full estimate                                  */
+/*Output: void                                                                                                                                                     */
+
+void PredictedGroundFilter::FilterGround(OnlineGroundFilter& filter, Mat& disparity, int min_disparity, int iterations){
+
+    int64 start = getTickCount();
+    num_frames++;
+    last_skipped = false;
+
+    // Prediction from the pose change since the last estimate
+    if(valid && cam_height && cam_theta && age < max_age){
+
+        float theta = *cam_theta*M_PI/180, theta_ref = ref_theta*M_PI/180;
+        float k = ref_k * (*cam_height/ref_height) * cos(theta_ref)/cos(theta);
+        float b = ref_b + f*(tan(theta) - tan(theta_ref));
+
+        if(Verify(disparity, k, b) >= verify_ratio*ref_ratio){
+            filter.SetGroundPlane(k, b);
+            filter.FilterGround(disparity, min_disparity);
+            last_skipped = true;
+            num_skipped++;
+            age++;
+        }
+
+    }
+
+    // Full estimate
+    if(!last_skipped){
+
+        // the reference is the line of the last filtering pass, checked
+        // against the map before filtering like the predictions
+        disparity.copyTo(unfiltered);
+        filter.UpdateGroundPlane(disparity);
+        filter.FilterGround(disparity, min_disparity, iterations);
+
+        ref_k = filter.GroundK();
+        ref_b = filter.GroundB();
+        ref_ratio = Verify(unfiltered, ref_k, ref_b);
+        if(cam_height && cam_theta){
+            ref_height = *cam_height;
+            ref_theta = *cam_theta;
+        }
+        valid = ref_k > 0 && ref_ratio > 0 && cam_height && ref_height > 0;
+        age = 0;
+
+    }
+
+    last_time = (getTickCount() - start)*1000.0/getTickFrequency();
+
+}
+
+
+/*Funciton Name: SkipRatio()                                                                                   */
+/*Description: fraction of frames without full estimate                              */
+/*Input: void                                                                                                                      */
+/*Output: float ratio                                                                                                           */
+
+float PredictedGroundFilter::SkipRatio(){
+
+    return num_frames > 0 ? (float)num_skipped/num_frames : 0;
+
+}
+
+
+/*Funciton Name: Skipped()                                                                                      */
+/*Description: whether the last frame used the prediction                          */
+/*Input: void                                                                                                                      */
+/*Output: bool skipped                                                                                                      */
+
+bool PredictedGroundFilter::Skipped(){
+
+    return last_skipped;
+
+}
+
+
+/*Funciton Name: EstimationTime()                                                                        */
+/*Description: ground estimation and filtering time of the last frame (ms) */
+/*Input: void                                                                                                                      */
+/*Output: double time                                                                                                         */
 
-float RANSACGroundFilter::ComputeDistance(LineModel line, Point p){
+double PredictedGroundFilter::EstimationTime(){
 
-    return fabs((p.x - line.sx)*line.my - (p.y - line.sy)*line.mx) / sqrt(line.mx*line.mx + line.my*line.my);
+    return last_time;
 
 }
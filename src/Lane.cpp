@@ -189,19 +189,19 @@ vector<vector<int>> CameraLane::Widths(){
 /*Funciton Name: Width(int n)				    	                     	   	 			          */
 /*Description: Return the n-th width in image representation           */
 /*Input: int n - index of way point                                                                   */        
-/*Output: vector<int> width                                                                              */  
+/*Output: const vector<int>& width                                                                   */  
 
-vector<int> CameraLane::Width(int n){
+const vector<int>& CameraLane::Width(int n){
+
+    // Beyond the last way point the lane has no width
+    static const vector<int> no_width(2, 0);
 
     if(n<num_of_waypoints) {
         return img_widths[n];
     }
 
     else{
-        vector<int> temp;
-        temp.push_back(0);
-        temp.push_back(0);
-        return temp;
+        return no_width;
     }
 
 }
@@ -321,19 +321,17 @@ vector<vector<Point2i>> MonoLane::VisAllLines(){
 /*Funciton Name: VisOneLine(int n)			    	              	   	 			            */
 /*Description: Return n-th line in image representation                       */
 /*Input: int n - index of way point                                                                   */        
-/*Output: vector<Point2i> line                                                                         */  
+/*Output: const vector<Point2i>& line                                                              */  
+
+const vector<Point2i>& MonoLane::VisOneLine(int n){
+
+    static const vector<Point2i> no_line(2);
 
-vector<Point2i> MonoLane::VisOneLine(int n){
-        
     if(n<num_of_waypoints) {
         return lines[n];
     }
     else{
-        Point2i p1, p2;
-        vector<Point2i> vec;
-        vec.push_back(p1);
-        vec.push_back(p2);
-        return vec;
+        return no_line;
     }
 }
 
@@ -46,47 +46,36 @@ vector<Object_2D> ObjectDetector::List2D(){
 }
 
 
-/*Funciton Name: CalculateDisparity(Mat img, Rect box)                      */
-/*Description: Calculate the disparity from given box                             
-                              DISPARITY_CALC_TYPE:  0 - median
+/*Funciton Name: UpdateBoxStatistics(Mat img)                                             */
+/*Description: build the box statistics of a new disparity map, the tile
+                          histograms only if DISPARITY_CALC_TYPE needs them           */
+/*Input: Mat img - disparity map                                                                         */
+/*Output: void                                                                                                           */
+
+void ObjectDetector::UpdateBoxStatistics(Mat img){
+
+    box_stats.Update(img, DISPARITY_CALC_TYPE != 1);
+
+}
+
+
+/*Funciton Name: CalculateDisparity(Rect box)                                               */
+/*Description: Calculate the disparity from given box of the disparity map
+                            of UpdateBoxStatistics, bottom-right corner included
+                            DISPARITY_CALC_TYPE:  0 - median
                                                                                  1 - average
                                                                                  2 - max                                          */
-/*Input: Mat img - disparity map
-                  Rect box - calculated area                                                                   */   
-/*Output: int disparity value                                                                                */
-
-int ObjectDetector::CalculateDisparity(Mat img, Rect box){
-
-    int disparity ;
-    if (box.area() != 0) {
-        std::vector<float> vec;
-        for (int r = box.tl().y; r <= box.br().y; r++) {
-            for (int c = box.tl().x; c <= box.br().x; c++) {
-                if (img.at<uint8_t>(r, c) != 0)  vec.push_back(img.at<uint8_t>(r, c));
-            }
-        }
-        // not FP
-        if (vec.size() != 0) {
-            if (DISPARITY_CALC_TYPE == 0) {
-                std::nth_element(vec.begin(), vec.begin() + vec.size() / 2, vec.end());
-                disparity = vec[vec.size() / 2];
-            }
-            else if (DISPARITY_CALC_TYPE == 1) {
-                float sum = 0;
-                for (int k = 0; k < int(vec.size()); k++) sum += vec[k];
-                disparity = int(sum / vec.size());
-            }
-            else {
-                int max = -1;
-                for (int k = 0; k < int(vec.size()); k++) {
-                    if (vec[k] > max) max = vec[k];
-                }
-                disparity = max;
-            }
-        }
-    }
+/*Input: Rect box - calculated area                                                                   */   
+/*Output: int disparity value, 0 if no pixel                                                   */
 
-    return disparity;
+int ObjectDetector::CalculateDisparity(Rect box){
+
+    if(box.area() == 0) return 0;
+
+    Rect inclusive(box.x, box.y, box.width + 1, box.height + 1);
+    if(DISPARITY_CALC_TYPE == 0) return box_stats.Median(inclusive);
+    else if(DISPARITY_CALC_TYPE == 1) return box_stats.Mean(inclusive);
+    else return box_stats.Max(inclusive);
 
 }
 
@@ -120,7 +109,7 @@ void ObjectDetector::RotateObject2D(float angle){
 
 /*****************************************************************
 Class Name: ContourDetector
-Description: Detect object from contour
+Description: Detect object from depth slices of the disparity map
 *****************************************************************/
 
 /*Funciton Name: ContourDetector()                                     			               */
@@ -135,19 +124,26 @@ ContourDetector::ContourDetector(){}
 /*Input: CameraModel* cm - pointer to a CameraModel                        
                   string config - path to configuration file                                                    */
 
-ContourDetector::ContourDetector(CameraModel* cm, string config): ObjectDetector(cm){
+ContourDetector::ContourDetector(CameraModel* cm, string config):
+    ContourDetector(cm, DetectionConfig::Load(config).detector, DetectionConfig::Load(config).filter){}
+
 
-    this->config = config;
-    FileStorage fs(config, FileStorage::READ);
+/*Funciton Name: ContourDetector(CameraModel* cm, const DetectorParams& params, const ObjectFilterParams& filter) */
+/*Description: Constructor from CameraModel and parsed configuration                           */
+/*Input: CameraModel* cm - pointer to a CameraModel
+                  const DetectorParams& params - detector parameters
+                  const ObjectFilterParams& filter - filter parameters                                    */
 
-    fs["min_depth"]>>depth_step;
-    fs["depth_step"]>>depth_step;
-    fs["num_of_waypoints"]>>num_of_waypoints;
-    fs.release();
+ContourDetector::ContourDetector(CameraModel* cm, const DetectorParams& params, const ObjectFilterParams& filter): ObjectDetector(cm){
+
+    min_depth = params.min_depth;
+    depth_step = params.depth_step;
+    num_of_waypoints = params.num_of_waypoints;
 
     for(int i=0; i<num_of_waypoints; i++)   list_depth.push_back(min_depth + i * depth_step);
 
-    InitiateParameter(config);
+    InitiateParameter(params, filter);
+    UpdateSliceTable();
 
 }
 
@@ -158,123 +154,268 @@ ContourDetector::ContourDetector(CameraModel* cm, string config): ObjectDetector
                   Lane* lane - pointer to a Lane                      
                   string config - path to configuration file                                                                            */
 
-ContourDetector::ContourDetector(CameraModel* cm, Lane* lane, string config): ObjectDetector(cm){
+ContourDetector::ContourDetector(CameraModel* cm, Lane* lane, string config):
+    ContourDetector(cm, lane, DetectionConfig::Load(config).detector, DetectionConfig::Load(config).filter){}
+
+
+/*Funciton Name: ContourDetector(CameraModel* cm, Lane* lane, const DetectorParams& params, const ObjectFilterParams& filter) */
+/*Description: Constructor from CameraModel, Lane and parsed configuration                   */
+/*Input: CameraModel* cm - pointer to a CameraModel
+                  Lane* lane - pointer to a Lane
+                  const DetectorParams& params - detector parameters
+                  const ObjectFilterParams& filter - filter parameters                                    */
+
+ContourDetector::ContourDetector(CameraModel* cm, Lane* lane, const DetectorParams& params, const ObjectFilterParams& filter): ObjectDetector(cm){
 
-    this->config = config;
     this->lane = lane;
     depth_step = lane->LaneDepthStep();
     num_of_waypoints = lane->LaneNumWP();
     min_depth = lane->LaneMinDepth();
     list_depth = lane->ListDepth();
 
-    InitiateParameter(config);
+    InitiateParameter(params, filter);
+    UpdateSliceTable();
 
 }
 
 
-/*Funciton Name: InitiateParameter(string config)                                  */
-/*Description: Read parameter from configuration file                          */
-/*Input: string config - path to configuration file                                       */   
+/*Funciton Name: InitiateParameter(const DetectorParams& params, const ObjectFilterParams& filter) */
+/*Description: Set parameters and filters from parsed configuration             */
+/*Input: const DetectorParams& params - detector parameters
+                  const ObjectFilterParams& filter - filter parameters                          */
 /*Output: void                                                                                                           */
 
-void ContourDetector::InitiateParameter(string config){
+void ContourDetector::InitiateParameter(const DetectorParams& params, const ObjectFilterParams& filter){
+
+    DISPARITY_CALC_TYPE = params.DISPARITY_CALC_TYPE;
+    pre_median_kernel = params.od_pre_median_kernel;
+    median_kernel = params.median_kernel;
+    canny_threshold = params.canny_threshold;
 
-    FileStorage fs(config, FileStorage::READ);
-    
-    fs["DISPARITY_CALC_TYPE"]>>DISPARITY_CALC_TYPE; 
-    fs["od_pre_median_kernel"]>>pre_median_kernel;  
-    fs["median_kernel"]>>median_kernel;
-    fs["canny_threshold"]>>canny_threshold;
+    erode_kernel = params.erode_kernel;
+    dilate_kernel = params.dilate_kernel;
+
+    sf = SizeFilter(cm, filter);
+    cf = ConfidenceFilter(filter);
+    nmsf = NMSFilter(filter);
 
 }
 
 
-/*Funciton Name: DetectObject2D(Mat disparity)	                                  */
-/*Description: Detect object from dispariy                                                   */
-/*Input: Mat disparity - disparity map                                                            */   
-/*Output: vector<Object_2D> list_2D                                                             */   
+/*Funciton Name: UpdateSliceTable()                                                                 */
+/*Description: slice code of every disparity from the depth list, slice k
+                          holds disparities in [D(depth[k+1]), D(depth[k])]             */
+/*Input: void                                                                                                               */
+/*Output: void                                                                                                           */
 
-vector<Object_2D> ContourDetector::DetectObject2D(Mat disparity){
+void ContourDetector::UpdateSliceTable(){
 
-    list_2D.clear();
+    slice_table = Mat::zeros(1, 256, CV_8U);
+    num_slices = 0;
 
-    if(pre_median_kernel>0 && pre_median_kernel%2 == 1) medianBlur(disparity, disparity, pre_median_kernel);
+    for(int k=0; k+1<int(list_depth.size()) && num_slices<127; k++){
 
-    Mat canny_output;
-    vector<vector<Point> > contours;
-    vector<Vec4i> hierarchy;
-    Mat masked_disparity, visual_masked_disparity;
-    RNG rng(12345);
+        int delta = cm->Distance_Disparity(list_depth[k]);
+        int delta1 = cm->Distance_Disparity(list_depth[k+1]);
 
-    SizeFilter sf  = SizeFilter(cm, config);
-    ConfidenceFilter cf = ConfidenceFilter(config);
-    NMSFilter nmsf = NMSFilter(config);
+        // Last slice reaches down to disparity 1 once the steps vanish
+        bool last = delta == delta1;
+        if(last) delta1 = 1;
 
-    int delta, delta1;
+        // The bound shared with the previous slice belongs to both
+        num_slices++;
+        for(int d=max(delta1, 0); d<=min(delta, 255); d++){
+            uchar& code = slice_table.at<uchar>(d);
+            code = code ? 2*num_slices - 1 : 2*num_slices;
+        }
 
-    // for(float d=depth_step; isless(d,depth_step*num_of_waypoints)&&delta1!=1; d=d+depth_step){	
-    
-    for(int k=0; k+1<num_of_waypoints && delta1!=1; k++){
+        if(last || delta1 == 1) break;
 
-        // Declear lists of bounding box
-        vector<Rect>  bounding_box_1, bounding_box_2;
+    }
 
-        // Mask disparity through distance step
-        delta = cm->Distance_Disparity(list_depth[k]);
-        delta1 = cm->Distance_Disparity(list_depth[k+1]);
+}
 
-        if(delta == delta1) delta1 = 1;	
 
-        // Add constraints to avoid double detection
-        if(delta!=delta1){
+/*Funciton Name: SplitSlices(Mat disparity)                                                      */
+/*Description: quantize disparity to slices and scatter the pixels to the
+                          packed masks of their slices in one pass                           */
+/*Input: Mat disparity - disparity map                                                            */
+/*Output: void                                                                                                           */
 
-            std::cout<<"Delta range: "<<delta<<" to "<< delta1<<endl;
-            inRange(disparity, delta1, delta , masked_disparity);
-            threshold(masked_disparity, masked_disparity, delta1, 255, THRESH_BINARY);
-            // medianBlur(masked_disparity, masked_disparity, median_kernel);
-            erode(masked_disparity, masked_disparity, getStructuringElement(MORPH_RECT, Size(20,20)));
-            dilate(masked_disparity, masked_disparity, getStructuringElement(MORPH_RECT, Size(30,30)));
+void ContourDetector::SplitSlices(Mat disparity){
 
-            // Visualize masked disparity
-            if(VISUAL_MASKED_DISPARITY)  cvtColor(masked_disparity, visual_masked_disparity, COLOR_GRAY2RGB);
+    LUT(disparity, slice_table, slices);
 
-            Canny( masked_disparity, canny_output, canny_threshold, canny_threshold*2 );
-            findContours(canny_output, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE, Point(0, 0));
-            
-            if(contours.size()>0){
-                vector<vector<Point> > contours_poly(contours.size());
-                vector<Rect> boundRect(contours.size());
+    masks.resize(num_slices);
+    for(int k=0; k<num_slices; k++) masks[k].Create(slices.rows, slices.cols);
 
-                // Find bounding boxes
-                for (int i = 0; i < contours.size(); i++){
-                    approxPolyDP(Mat(contours[i]), contours_poly[i], 3, true);
-                    boundRect[i] = boundingRect(Mat(contours_poly[i]));
-                }
+    // code 2k - slice k, 2k+1 - slices k and k+1
+    for(int r=0; r<slices.rows; r++){
+        const uchar* row = slices.ptr<uchar>(r);
+        for(int c=0; c<slices.cols; c++){
+            int code = row[c];
+            if(code == 0) continue;
+            if(code > 1) masks[code/2 - 1].Set(r, c);
+            if(code & 1) masks[code/2].Set(r, c);
+        }
+    }
 
-                // Loop through bounding boxes
-                for (size_t i = 0; i < contours.size(); i++){
-
-                    // Calculate confidence to eliminate FPs
-                    if(cf.ConfidenceFit(masked_disparity, boundRect[i])) bounding_box_1.push_back(boundRect[i]);
-                
-                    // Visualize bounding box at each step
-                    if(VISUAL_MASKED_DISPARITY){
-                        Scalar color = Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
-                        rectangle(visual_masked_disparity, boundRect[i].tl(), boundRect[i].br(), color, 1, 8, 0);
-                    }           
-                }
+}
+
+
+/*Funciton Name: LabelMask(const BitMask& mask, int slice, SliceScratch& buffers) */
+/*Description: label 8-connected pixels of a packed mask in one pass
+                          over its runs, to buffers.blobs                                                          */
+/*Input: const BitMask& mask - mask of one slice
+                int slice - slice index
+                SliceScratch& buffers - labeling buffers of the worker                      */
+/*Output: void                                                                                                           */
+
+void ContourDetector::LabelMask(const BitMask& mask, int slice, SliceScratch& buffers){
+
+    vector<Range>& row_runs = buffers.row_runs;
+    vector<SliceRun>& runs = buffers.runs;
+    vector<int>& parent = buffers.parent;
+    vector<int>& run_blob = buffers.run_blob;
+    vector<SliceBlob>& blobs = buffers.blobs;
+
+    runs.clear();
+    parent.clear();
+    blobs.clear();
+
+    // Root of a run, the smallest run index of its blob
+    auto find = [&](int i){
+        while(parent[i] != i){
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    // Runs of each row, joined to touching runs in the row above
+    int above_begin = 0, above_end = 0;
+    for(int r=0; r<mask.Rows(); r++){
+
+        row_runs.clear();
+        mask.Runs(r, row_runs);
+        int begin = int(runs.size());
+        int j = above_begin;
+
+        for(size_t i=0; i<row_runs.size(); i++){
+
+            int start = row_runs[i].start, end = row_runs[i].end;
+            int index = int(runs.size());
+            runs.push_back({r, start, end, slice});
+            parent.push_back(index);
+
+            while(j<above_end && runs[j].end < start) j++;
+            for(int k=j; k<above_end && runs[k].start <= end; k++){
+                int a = find(k), b = find(index);
+                if(a != b) parent[max(a, b)] = min(a, b);
             }
 
-            // Visualize masked disparity
-            if(VISUAL_MASKED_DISPARITY) imshow(to_string(list_depth[k]), visual_masked_disparity);
-            
         }
 
-        // Filter and generate objects
-        if(bounding_box_1.size()!=0) {
-            bounding_box_2 = nmsf.FilterObjectBox(bounding_box_1);
-            Generate2DList(disparity, bounding_box_2);
+        above_begin = begin;
+        above_end = int(runs.size());
+
+    }
+
+    // Statistics per root, roots precede their runs
+    run_blob.assign(runs.size(), -1);
+    for(size_t i=0; i<runs.size(); i++){
+
+        int root = find(int(i));
+        const SliceRun& run = runs[i];
+        if(run_blob[root] < 0){
+            run_blob[root] = int(blobs.size());
+            blobs.push_back({run.slice, Rect(run.start, run.row, run.end - run.start, 1), 0});
         }
+        SliceBlob& blob = blobs[run_blob[root]];
+        blob.box |= Rect(run.start, run.row, run.end - run.start, 1);
+        blob.area += run.end - run.start;
+
+    }
+
+}
+
+
+/*Funciton Name: DetectSlice(int k, SliceScratch& buffers, ConfidenceFilter& cf, NMSFilter& nmsf) */
+/*Description: erode, dilate and label the mask of slice k, keep the boxes
+                          above the confidence and filter them by NMS; touches
+                          only the mask and results of slice k                                             */
+/*Input: int k - slice, 0 to num_slices - 1
+                SliceScratch& buffers - labeling buffers of the worker
+                ConfidenceFilter& cf - confidence filter
+                NMSFilter& nmsf - NMS filter                                                                  */
+/*Output: void                                                                                                           */
+
+void ContourDetector::DetectSlice(int k, SliceScratch& buffers, ConfidenceFilter& cf, NMSFilter& nmsf){
+
+    BitMask& mask = masks[k];
+    vector<Rect>& candidates = slice_candidates[k];
+    candidates.clear();
+    slice_boxes[k].clear();
+    if(mask.Count() == 0) return;
+
+    // Filter out noise and join close pixels on the packed mask
+    mask.Erode(Size(erode_kernel, erode_kernel));
+    mask.Dilate(Size(dilate_kernel, dilate_kernel));
+    LabelMask(mask, k + 1, buffers);
+
+    // Calculate confidence to eliminate FPs, boxes are read up to the
+    // bottom-right corner inclusive
+    Rect image(0, 0, mask.Cols() - 1, mask.Rows() - 1);
+    for(size_t i=0; i<buffers.blobs.size(); i++){
+        Rect box = buffers.blobs[i].box & image;
+        if(cf.ConfidenceFit(mask, box)) candidates.push_back(box);
+    }
+
+    if(candidates.size()!=0) slice_boxes[k] = nmsf.FilterObjectBox(candidates);
+
+}
+
+
+/*Funciton Name: DetectObject2D(Mat disparity)	                                  */
+/*Description: Detect object from dispariy                                                   */
+/*Input: Mat disparity - disparity map                                                            */   
+/*Output: vector<Object_2D> list_2D                                                             */   
+
+vector<Object_2D> ContourDetector::DetectObject2D(Mat disparity){
+
+    list_2D.clear();
+
+    if(pre_median_kernel>0 && pre_median_kernel%2 == 1) medianBlur(disparity, disparity, pre_median_kernel);
+
+    // All slices split in one pass
+    SplitSlices(disparity);
+    UpdateBoxStatistics(disparity);
+
+    // Slices are independent until the list, interleaved over the workers
+    // as near slices hold the most pixels
+    slice_candidates.resize(num_slices);
+    slice_boxes.resize(num_slices);
+    int num_stripes = max(1, min(getNumThreads(), num_slices));
+    if(int(scratch.size()) < num_stripes) scratch.resize(num_stripes);
+
+    parallel_for_(Range(0, num_stripes), [&](const Range& range){
+        for(int stripe=range.start; stripe<range.end; stripe++)
+            for(int k=stripe; k<num_slices; k+=num_stripes) DetectSlice(k, scratch[stripe], cf, nmsf);
+    }, num_stripes);
+
+    // Merge in slice order, the list does not depend on the number of workers
+    for(int k=0; k<num_slices; k++)
+        if(slice_boxes[k].size()!=0) Generate2DList(slice_boxes[k]);
+
+    // Visualize depth slices
+    if(VISUAL_MASKED_DISPARITY){
+        Mat visual_slices, visual_masked_disparity;
+        slices.convertTo(visual_slices, CV_8U, 255.0/(2*num_slices + 1));
+        applyColorMap(visual_slices, visual_masked_disparity, COLORMAP_JET);
+        visual_masked_disparity.setTo(0, slices == 0);
+        for(int k=0; k<num_slices; k++)
+            for(size_t i=0; i<slice_candidates[k].size(); i++) rectangle(visual_masked_disparity, slice_candidates[k][i], Scalar(255, 255, 255), 1);
+        imshow("Depth slices", visual_masked_disparity);
     }
 
     sf.UpdateObjectSource(&list_2D);
@@ -286,17 +427,16 @@ vector<Object_2D> ContourDetector::DetectObject2D(Mat disparity){
 }
 
 
-/*Funciton Name: Generate2DList(Mat&src, vector<Rect> boxes)      */
-/*Description: Generate 2D list from dispariy map and boxes              */
-/*Input: Mat src - disparity map                                                            
-                  vector<Rect> boxes - detected boxes                                            */   
+/*Funciton Name: Generate2DList(vector<Rect> boxes)                         */
+/*Description: Generate 2D list from box statistics and boxes            */
+/*Input: vector<Rect> boxes - detected boxes                                            */   
 /*Output: void                                                                                                           */  
 
-void ContourDetector::Generate2DList(Mat&src, vector<Rect> boxes){
+void ContourDetector::Generate2DList(vector<Rect> boxes){
 
 	for(int i =0; i<boxes.size(); i++){
 		Rect box = boxes[i];
-		int disparity = CalculateDisparity(src, box);
+		int disparity = CalculateDisparity(box);
         Object_2D obj;
         obj.tl.x = box.tl().x;
         obj.tl.y = box.tl().y;
@@ -312,25 +452,56 @@ void ContourDetector::Generate2DList(Mat&src, vector<Rect> boxes){
 
 /*****************************************************************
 Class Name: UVDisparityDetector
-Description: Detect object from UV-Disparity (experimental, incomplete)
+Description: Detect object from stixels
 *****************************************************************/
 
 /*Funciton Name: UVDisparityDetector()                             			                 */
 /*Description: Default constructor                                                                    */
 /*Input: void                                                                                                               */ 
 
-UVDisparityDetector::UVDisparityDetector(){}
+UVDisparityDetector::UVDisparityDetector(){
+
+    ground_k = 0;
+    ground_b = 0;
+
+}
 
 
 /*Funciton Name: UVDisparityDetector(string config)                              */
 /*Description: Constructor from configuration                                            */
 /*Input: string config - path to configuration file                                         */
 
-UVDisparityDetector::UVDisparityDetector(string config){
+UVDisparityDetector::UVDisparityDetector(string config): UVDisparityDetector(DetectionConfig::Load(config).detector){}
 
-    FileStorage fs(config, FileStorage::READ);
 
-    fs["uvd_min_count"]>>uvd_min_count;
+/*Funciton Name: UVDisparityDetector(const DetectorParams& params)      */
+/*Description: Constructor from parsed configuration                               */
+/*Input: const DetectorParams& params - detector parameters                 */
+
+UVDisparityDetector::UVDisparityDetector(const DetectorParams& params): UVDisparityDetector(){
+
+    stixel_width = params.stixel_width;
+    stixel_min_count = params.stixel_min_count;
+    stixel_smooth_penalty = params.stixel_smooth_penalty;
+    stixel_jump_penalty = params.stixel_jump_penalty;
+    stixel_group_tolerance = params.stixel_group_tolerance;
+    stixel_min_group = params.stixel_min_group;
+    stixel_max_gap = params.stixel_max_gap;
+    ground_tolerance = params.ground_tolerance;
+
+}
+
+
+/*Funciton Name: SetGroundPlane(float k, float b)                                      */
+/*Description: ground line of the next frames, pixels on the ground are
+                          ignored and stixels end on the ground; k <= 0 disables     */
+/*Input: float k, float b - ground line, row = k * disparity + b              */
+/*Output: void                                                                                                           */
+
+void UVDisparityDetector::SetGroundPlane(float k, float b){
+
+    ground_k = k;
+    ground_b = b;
 
 }
 
@@ -342,14 +513,267 @@ UVDisparityDetector::UVDisparityDetector(string config){
 
 vector<Object_2D> UVDisparityDetector::DetectObject2D(Mat disparity){
 
-    vector<Object_2D>  output;
+    Accumulate(disparity);
+    Segment(disparity);
+    Group();
+
+    // Visualize stixels
+    if(VISUAL_U_V_DISPARITY){
+        Mat visual_stixels;
+        cvtColor(disparity, visual_stixels, COLOR_GRAY2RGB);
+        for(size_t i=0; i<stixels.size(); i++){
+            Stixel s = stixels[i];
+            Scalar color = Scalar(0, min(255, int(s.disparity*4)), 255 - min(255, int(s.disparity*4)));
+            rectangle(visual_stixels, Point(s.column, s.top), Point(s.column + s.width - 1, s.bottom), color, FILLED);
+        }
+        for(size_t i=0; i<list_2D.size(); i++)  rectangle(visual_stixels, list_2D[i].tl, list_2D[i].br, Scalar(255, 255, 255), 1);
+        imshow("Stixels", visual_stixels);
+    }
+
+    return list_2D;
+
+}
+
+
+/*Funciton Name: Accumulate(Mat disparity)                                                  */
+/*Description: u-disparity of every band above the ground line                  */
+/*Input: Mat disparity - disparity map                                                            */
+/*Output: void                                                                                                           */
+
+void UVDisparityDetector::Accumulate(Mat disparity){
+
+    const int D = 256;
+    int rows = disparity.rows, cols = disparity.cols;
+
+    num_bands = (cols + stixel_width - 1)/stixel_width;
+    count.assign(num_bands*D, 0);
+
+    // Last row above the ground for every disparity
+    limit.resize(D);
+    for(int d=0; d<D; d++)  limit[d] = ground_k>0 ? int(ground_k*d + ground_b - ground_tolerance) : rows;
+
+    parallel_for_(Range(0, num_bands), [&](const Range& range){
+        for(int band=range.start; band<range.end; band++){
+            int* band_count = &count[band*D];
+            int start = band*stixel_width, end = min(cols, start + stixel_width);
+            for(int r=0; r<rows; r++){
+                const uchar* row = disparity.ptr<uchar>(r);
+                for(int c=start; c<end; c++){
+                    int d = row[c];
+                    band_count[d] += d > 0 && r <= limit[d];
+                }
+            }
+        }
+    });
+
+}
+
+
+/*Funciton Name: Segment(Mat disparity)                                                          */
+/*Description: choose one disparity per band (0 - free) maximizing the
+                          support minus the steps between bands, and build stixels */
+/*Input: Mat disparity - disparity map                                                            */
+/*Output: void                                                                                                           */
+
+void UVDisparityDetector::Segment(Mat disparity){
+
+    const int D = 256;
+    int rows = disparity.rows, cols = disparity.cols;
+    stixels.clear();
+    if(num_bands == 0) return;
+
+    value.resize(num_bands*D);
+    from.resize(num_bands*D);
+
+    float score[D], best[D];
+    short arg[D];
+
+    for(int i=0; i<num_bands; i++){
+
+        // Support of a disparity, +-1 for sub-pixel spread, 0 is free space
+        const int* band_count = &count[i*D];
+        score[0] = 0;
+        for(int d=1; d<D; d++)  score[d] = band_count[d-1] + band_count[d] + (d+1<D ? band_count[d+1] : 0) - stixel_min_count;
+
+        float* v = &value[i*D];
+        short* f = &from[i*D];
+
+        if(i == 0){
+            for(int d=0; d<D; d++){
+                v[d] = score[d];
+                f[d] = 0;
+            }
+            continue;
+        }
+
+        const float* last = &value[(i-1)*D];
+
+        // Best obstacle predecessor under the linear step penalty, two passes
+        for(int d=1; d<D; d++){
+            best[d] = last[d];
+            arg[d] = d;
+        }
+        for(int d=2; d<D; d++){
+            if(best[d-1] - stixel_smooth_penalty > best[d]){
+                best[d] = best[d-1] - stixel_smooth_penalty;
+                arg[d] = arg[d-1];
+            }
+        }
+        for(int d=D-2; d>=1; d--){
+            if(best[d+1] - stixel_smooth_penalty > best[d]){
+                best[d] = best[d+1] - stixel_smooth_penalty;
+                arg[d] = arg[d+1];
+            }
+        }
+
+        // Any predecessor at the capped penalty
+        int any_obstacle = 1;
+        for(int d=2; d<D; d++)  if(last[d] > last[any_obstacle]) any_obstacle = d;
+        int any = last[0] >= last[any_obstacle] ? 0 : any_obstacle;
+
+        for(int d=1; d<D; d++){
+            float m = best[d];
+            short a = arg[d];
+            if(last[any] - stixel_jump_penalty > m){
+                m = last[any] - stixel_jump_penalty;
+                a = any;
+            }
+            v[d] = score[d] + m;
+            f[d] = a;
+        }
+        if(last[any_obstacle] - stixel_jump_penalty > last[0]){
+            v[0] = last[any_obstacle] - stixel_jump_penalty;
+            f[0] = any_obstacle;
+        }
+        else{
+            v[0] = last[0];
+            f[0] = 0;
+        }
+
+    }
+
+    // Backtrack the best disparity of every band
+    vector<int> band_disparity(num_bands);
+    const float* v = &value[(num_bands-1)*D];
+    int d = int(max_element(v, v + D) - v);
+    for(int i=num_bands-1; i>=0; i--){
+        band_disparity[i] = d;
+        d = from[i*D + d];
+    }
+
+    // Stixels from the bins around the chosen disparity
+    for(int i=0; i<num_bands; i++){
+
+        int d = band_disparity[i];
+        if(d == 0) continue;
 
-    v_disp = ogf.Vdisparity(disparity, 0, 255, uvd_min_count);
-    u_disp = ogf.Udisparity(disparity, 0, 255, uvd_min_count);
+        int n = 0;
+        float sum = 0;
+        for(int x=max(1, d-1); x<=min(D-1, d+1); x++){
+            n += count[i*D + x];
+            sum += x*count[i*D + x];
+        }
+        if(n == 0) continue;
 
-    imshow("vd", v_disp);
-    imshow("ud", u_disp);
+        Stixel s;
+        s.column = i*stixel_width;
+        s.width = min(stixel_width, cols - s.column);
+        s.disparity = sum/n;
+        if(!Extent(disparity, s, d)) continue;
+        // stand on the ground
+        if(ground_k>0)  s.bottom = max(s.bottom, min(rows - 1, int(ground_k*s.disparity + ground_b)));
+        stixels.push_back(s);
 
-    return output;
+    }
 
-}
\ No newline at end of file
+}
+
+
+/*Funciton Name: Extent(Mat disparity, Stixel& stixel, int d)                             */
+/*Description: rows of the stixel, the run of rows at disparity d +-1 with
+                          the most pixels, gaps up to stixel_max_gap rows are bridged */
+/*Input: Mat disparity - disparity map
+                Stixel& stixel - stixel with column and width, top and bottom set
+                int d - disparity of the band                                                                    */
+/*Output: bool found                                                                                                 */
+
+bool UVDisparityDetector::Extent(Mat disparity, Stixel& stixel, int d){
+
+    // a row counts if half of the band is at the disparity
+    int min_hits = max(1, stixel.width/2);
+    int best = 0, hits = 0, start = -1, last = -1;
+
+    for(int r=0; r<disparity.rows; r++){
+
+        const uchar* row = disparity.ptr<uchar>(r) + stixel.column;
+        int row_hits = 0;
+        for(int c=0; c<stixel.width; c++)    row_hits += row[c] > 0 && abs(row[c] - d) <= 1 && r <= limit[row[c]];
+        if(row_hits < min_hits) continue;
+
+        if(start < 0 || r - last > stixel_max_gap + 1){
+            start = r;
+            hits = 0;
+        }
+        hits += row_hits;
+        last = r;
+        if(hits > best){
+            best = hits;
+            stixel.top = start;
+            stixel.bottom = r;
+        }
+
+    }
+
+    return best > 0;
+
+}
+
+
+/*Funciton Name: Group()                                                                                  */
+/*Description: group neighbouring stixels of similar disparity to objects */
+/*Input: void                                                                                                               */
+/*Output: void                                                                                                           */
+
+void UVDisparityDetector::Group(){
+
+    list_2D.clear();
+
+    size_t start = 0;
+    for(size_t i=1; i<=stixels.size(); i++){
+
+        bool split = i == stixels.size()
+            || stixels[i].column != stixels[i-1].column + stixels[i-1].width
+            || fabs(stixels[i].disparity - stixels[i-1].disparity) > stixel_group_tolerance;
+        if(!split) continue;
+
+        if(int(i - start) >= stixel_min_group){
+            Object_2D obj;
+            float top = FLT_MAX, bottom = 0, sum = 0, width = 0;
+            for(size_t j=start; j<i; j++){
+                top = min(top, (float)stixels[j].top);
+                bottom = max(bottom, (float)stixels[j].bottom);
+                sum += stixels[j].disparity*stixels[j].width;
+                width += stixels[j].width;
+            }
+            obj.tl = Point2f(stixels[start].column, top);
+            obj.br = Point2f(stixels[i-1].column + stixels[i-1].width - 1, bottom);
+            obj.disparity = sum/width;
+            list_2D.push_back(obj);
+        }
+        start = i;
+
+    }
+
+}
+
+
+/*Funciton Name: Stixels()                                                                                */
+/*Description: Return the stixels of the last frame                                 */
+/*Input: void                                                                                                               */
+/*Output: vector<Stixel> stixels                                                                       */
+
+vector<Stixel> UVDisparityDetector::Stixels(){
+
+    return stixels;
+
+}
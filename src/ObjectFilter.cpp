@@ -44,6 +44,40 @@ void ObjectFilter2D::UpdateObjectSource(vector<Object_2D>* source){
 }
 
 
+/*Funciton Name: Fit(const Object_2D& obj)                                                     */
+/*Description: Return whether an object is kept, the predicate of the filter */
+/*Input: const Object_2D& obj - 2D object                                                         */
+/*Output: bool result - 1: keep                                                                            */
+
+bool ObjectFilter2D::Fit(const Object_2D& obj){
+
+    return true;
+
+}
+
+
+/*Funciton Name:FilterObjectList()                                                                  */
+/*Description: Keep the objects that fit, compacted in place in one pass,
+                          the order is kept and the list never reallocates              */
+/*Input: void                                                                                                               */
+/*Output: void                                                                                                           */
+
+void ObjectFilter2D::FilterObjectList(){
+
+    vector<Object_2D>& list = *source_2D;
+    size_t kept = 0;
+
+    for(size_t i=0; i<list.size(); i++){
+        if(!Fit(list[i])) continue;
+        if(kept!=i) list[kept] = list[i];
+        kept++;
+    }
+
+    list.resize(kept);
+
+}
+
+
 
 /*****************************************************************
 Class Name: NMSFilter
@@ -61,86 +95,130 @@ NMSFilter::NMSFilter(){}
 /*Description: Constructor from configuration                                           */
 /*Input: string config - path to configuration file                                        */  
 
-NMSFilter::NMSFilter(string config){
+NMSFilter::NMSFilter(string config): NMSFilter(DetectionConfig::Load(config).filter){}
 
-    FileStorage fs(config, FileStorage::READ);
-    fs["NMS_threshold"]>>NMS_threshold;    
+
+/*Funciton Name: NMSFilter(const ObjectFilterParams& params)          */
+/*Description: Constructor from parsed configuration                             */
+/*Input: const ObjectFilterParams& params - filter parameters              */
+
+NMSFilter::NMSFilter(const ObjectFilterParams& params){
+
+    NMS_threshold = params.NMS_threshold;
 
 }
 
 
-/*Funciton Name:FilterObjectList()                                                                  */                            
-/*Description: Filter object using NMS                                                            */
-/*Input: void                                                                                                               */    
-/*Output: void                                                                                                           */
+/*Funciton Name: Overlap(const Rect& a, const Rect& b)                                   */
+/*Description: intersection over union of two boxes, computed as
+                          dnn::NMSBoxes does so that ties at the threshold agree    */
+/*Input: const Rect& a, const Rect& b - boxes                                                       */
+/*Output: float overlap                                                                                                    */
 
-void NMSFilter::FilterObjectList(){
+static inline float Overlap(const Rect& a, const Rect& b){
 
-    vector<float> confidences;
-	vector<int> indices;
-    vector<Rect> boxes;
-    vector<Object_2D> temp;
+    int area_a = a.area(), area_b = b.area();
+    if(area_a + area_b <= 0) return 1.f;
+    double area_ab = (a & b).area();
+    return 1.f - static_cast<float>(1.0 - area_ab/(area_a + area_b - area_ab));
 
-    int size = (*source_2D).size();
+}
 
-	if (size!=0) {
-        
-        // Loop through original list, box of larger disparity has greater priority
-		for (int i = 0; i<size; i++) {
-            Object_2D obj = (*source_2D)[i];
-			confidences.push_back(obj.disparity/1000.0);
-            boxes.push_back(Rect(obj.tl, obj.br));
-		}
-        
-        // NMS filter
-		dnn::NMSBoxes(boxes, confidences, 0.0, NMS_threshold, indices);
-		int range = int(indices.size());
-
-        // Loop through filtered indices and copy obj to temp
-		for (size_t i = 0; i < range; ++i){
-			int idx = indices[i];
-			temp.push_back((*source_2D)[idx]);
-		}
-        
-        // Clear original list
-        (*source_2D).clear();
 
-        // Copy back to list
-         if(temp.size()>0){
+/*Funciton Name: Suppress(const vector<Rect>& boxes, const vector<float>& scores,
+                                            vector<int>& order, vector<uchar>& keep)                    */
+/*Description: greedy NMS: boxes visited by descending score (ties by index)
+                          are kept unless they overlap a kept box above NMS_threshold;
+                          boxes of score 0 are dropped, as by dnn::NMSBoxes           */
+/*Input: const vector<Rect>& boxes - boxes
+                const vector<float>& scores - score of each box
+                vector<int>& order - scratch of the visiting order
+                vector<uchar>& keep - 1: box kept                                                          */
+/*Output: void                                                                                                               */
+
+void NMSFilter::Suppress(const vector<Rect>& boxes, const vector<float>& scores, vector<int>& order, vector<uchar>& keep) const{
+
+    int size = boxes.size();
+    order.clear();
+    keep.assign(size, 0);
+
+    for(int i=0; i<size; i++)
+        if(scores[i]>0) order.push_back(i);
+
+    // Same visiting order as a stable sort, without its buffer
+    sort(order.begin(), order.end(), [&](int a, int b){
+        return scores[a]>scores[b] || (scores[a]==scores[b] && a<b);
+    });
+
+    // Kept boxes are the front of the order, compacted while visiting
+    int num_kept = 0;
+    for(size_t i=0; i<order.size(); i++){
+        int idx = order[i];
+        bool suppressed = false;
+        for(int j=0; j<num_kept && !suppressed; j++)
+            suppressed = Overlap(boxes[idx], boxes[order[j]]) > NMS_threshold;
+        if(suppressed) continue;
+        keep[idx] = 1;
+        order[num_kept++] = idx;
+    }
 
-            for(int i=0; i<temp.size(); i++)    (*source_2D).push_back(temp[i]);
+}
 
-        }
 
+/*Funciton Name:FilterObjectList()                                                                  */                            
+/*Description: Filter object using NMS, larger disparity has priority, the
+                          list is compacted in place in its original order            */
+/*Input: void                                                                                                               */    
+/*Output: void                                                                                                           */
 
-	}
+void NMSFilter::FilterObjectList(){
+
+    vector<Object_2D>& list = *source_2D;
+    int size = list.size();
+    if(size==0) return;
+
+    boxes.resize(size);
+    scores.resize(size);
+    for(int i=0; i<size; i++){
+        boxes[i] = Rect(list[i].tl, list[i].br);
+        scores[i] = list[i].disparity;
+    }
+
+    Suppress(boxes, scores, order, keep);
+
+    int kept = 0;
+    for(int i=0; i<size; i++){
+        if(!keep[i]) continue;
+        if(kept!=i) list[kept] = list[i];
+        kept++;
+    }
+    list.resize(kept);
 
 }
 
 
 /*Funciton Name:FilterObjectBox(vector<Rect> boxes)                         */                            
-/*Description: Filter list of boxes using NMS                                                */
+/*Description: Filter list of boxes using NMS, larger area has priority,
+                          the order is kept; safe to call from several threads      */
 /*Input: vector<Rect> boxes - list of original boxes                                   */    
 /*Output: vector<Rect> filtered boxes                                                            */
 
 vector<Rect> NMSFilter::FilterObjectBox(vector<Rect> boxes){
 
-	vector<float> confidences;
-	vector<int> indices;
-	vector<Rect> filtered_boxes;
+    int size = boxes.size();
+    vector<float> areas(size);
+    vector<int> order;
+    vector<uchar> keep;
 
-	if (boxes.size()!=0) {
-		for (int i = 0; i<boxes.size(); i++) {
-			confidences.push_back(boxes[i].area()/1000.0);
-		}
-		dnn::NMSBoxes(boxes, confidences, 0.0, NMS_threshold, indices);
-		int range = int(indices.size());
-		for (size_t i = 0; i < range; ++i){
-			int idx = indices[i];
-			filtered_boxes.push_back(boxes[idx]);
-		}
-	}
-	return filtered_boxes;
+    for(int i=0; i<size; i++) areas[i] = boxes[i].area();
+    Suppress(boxes, areas, order, keep);
+
+    int kept = 0;
+    for(int i=0; i<size; i++)
+        if(keep[i]) boxes[kept++] = boxes[i];
+    boxes.resize(kept);
+
+    return boxes;
 
 }
 
@@ -162,10 +240,16 @@ ConfidenceFilter::ConfidenceFilter(){}
 /*Description: Constructor from configuration                                           */
 /*Input: string config - path to configuration file                                        */  
 
-ConfidenceFilter::ConfidenceFilter(string config){
+ConfidenceFilter::ConfidenceFilter(string config): ConfidenceFilter(DetectionConfig::Load(config).filter){}
 
-    FileStorage fs(config, FileStorage::READ);
-    fs["confidence_threshold"]>>confidence_threshold;    
+
+/*Funciton Name: ConfidenceFilter(const ObjectFilterParams& params)  */
+/*Description: Constructor from parsed configuration                             */
+/*Input: const ObjectFilterParams& params - filter parameters              */
+
+ConfidenceFilter::ConfidenceFilter(const ObjectFilterParams& params){
+
+    confidence_threshold = params.confidence_threshold;
 
 }
 
@@ -213,6 +297,24 @@ bool ConfidenceFilter::ConfidenceFit(Mat disparity, Rect box){
 }
 
 
+/*Funciton Name: ConfidenceFit(const BitMask& mask, Rect box)                                         */
+/*Description: Return whether confidence of the box is above confidence_threshold, set
+                          pixels of a packed mask counted by popcount                                                  */
+/*Input: const BitMask& mask - packed mask
+                 Rect box - area to be calculated                                                                                               */
+/*Output: bool result - 1: above threshold                                                                                           */
+
+bool ConfidenceFilter::ConfidenceFit(const BitMask& mask, Rect box){
+
+    // as CalculateConfidence: pixels up to br() inclusive over the box area
+    int count = mask.Count(Rect(box.x, box.y, box.width + 1, box.height + 1));
+    float conf = float(count)/box.area();
+
+    return isgreater(conf, confidence_threshold);
+
+}
+
+
 /*Funciton Name: FilterObjectList()   	                                                            */
 /*Description: Filter object list by confidence, not implemented       */
 /*Input: void                                                                                                               */  
@@ -238,15 +340,7 @@ SizeFilter::SizeFilter(){}
 /*Description: Constructor from configuration                                           */
 /*Input: string config - path to configuration file                                        */  
 
-SizeFilter::SizeFilter(string config){
-
-    FileStorage fs(config, FileStorage::READ);
-    fs["min_width"]>>min_width;
-    fs["min_height"]>>min_height;
-    fs["max_width"]>>max_width;
-    fs["max_height"]>>max_height;
-
-}
+SizeFilter::SizeFilter(string config): SizeFilter(NULL, DetectionConfig::Load(config).filter){}
 
 
 /*Funciton Name: SizeFilter(CameraModel* cm, string config)              */
@@ -254,64 +348,44 @@ SizeFilter::SizeFilter(string config){
 /*Input: CameraModel* cm - pointer to a CameraModel
                   string config - path to configuration file                                         */  
 
-SizeFilter::SizeFilter(CameraModel* cm, string config){
-
-    this->cm = cm;
-
-    FileStorage fs(config, FileStorage::READ);
-    fs["min_width"]>>min_width;
-    fs["min_height"]>>min_height;
-    fs["max_width"]>>max_width;
-    fs["max_height"]>>max_height;
-
-}
-
+SizeFilter::SizeFilter(CameraModel* cm, string config): SizeFilter(cm, DetectionConfig::Load(config).filter){}
 
-/*Funciton Name:FilterObjectList()                                                                  */                            
-/*Description: Filter object by size                                                                    */
-/*Input: void                                                                                                               */    
-/*Output: void                                                                                                           */
-
-void SizeFilter::FilterObjectList(){
 
-    int size = (*source_2D).size();
-    vector<Object_2D> temp;
-
-    if(size>0){
-
-        // Loop through original list
-        for(int i=0; i<size; i++){
+/*Funciton Name: SizeFilter(CameraModel* cm, const ObjectFilterParams& params) */
+/*Description: Constructor from cameramodel and parsed configuration        */
+/*Input: CameraModel* cm - pointer to a CameraModel
+                const ObjectFilterParams& params - filter parameters                */
 
-            Object_2D obj = (*source_2D)[i];
+SizeFilter::SizeFilter(CameraModel* cm, const ObjectFilterParams& params){
 
-            bool criterium = SizeFit(obj);
+    this->cm = cm;
 
-            // Save fit candidates to temp    
-            if(criterium) temp.push_back(obj);
+    min_width = params.min_width;
+    min_height = params.min_height;
+    max_width = params.max_width;
+    max_height = params.max_height;
 
-        }
+}
 
-        // Clear original list
-        (*source_2D).clear();
-        
-        // Copy to original list
-        if(temp.size()>0){
 
-            for(int i=0; i<temp.size(); i++)    (*source_2D).push_back(temp[i]);
+/*Funciton Name: Fit(const Object_2D& obj)                                                     */
+/*Description: Keep objects of relevant size                                                   */
+/*Input: const Object_2D& obj - 2D object                                                         */
+/*Output: bool result - 1: keep                                                                            */
 
-        }
+bool SizeFilter::Fit(const Object_2D& obj){
 
-    }
+    return SizeFit(obj);
 
 }
 
 
-/*Funciton Name: SizeFit(Object_2D obj)   	                                                     */
+/*Funciton Name: SizeFit(const Object_2D& obj)   	                                          */
 /*Description: Return whether size of 2D object is relevant                       */
-/*Input: Object_2D obj - 2D object                                                                        */  
+/*Input: const Object_2D& obj - 2D object                                                         */
 /*Output: bool result - 1: size is relevant                                                            */
 
-bool SizeFilter::SizeFit(Object_2D obj){
+bool SizeFilter::SizeFit(const Object_2D& obj){
 
     int w_pix = abs(obj.br.x - obj.tl.x);
     int h_pix = abs(obj. br.y - obj.tl.y);
@@ -352,13 +426,13 @@ LaneFilter::LaneFilter(CameraLane* clane){
 }
 
 
-/*Funciton Name: IsOverlay(Object_2D obj, vector<int> line)                  */
+/*Funciton Name: IsOverlay(const Object_2D& obj, const vector<int>& line)   */
 /*Description: Return whether a 2D overlays with a line(2 points)         */
-/*Input: Object_2D obj - 2D object
-                  vector<int> line - lane representation                                               */  
+/*Input: const Object_2D& obj - 2D object
+                  const vector<int>& line - lane representation                                 */
 /*Output: bool result - 1: is overlay with line                                                    */
 
-bool LaneFilter::IsOverlay(Object_2D obj, vector<int> line){
+bool LaneFilter::IsOverlay(const Object_2D& obj, const vector<int>& line){
 
     bool overlay = true;
 
@@ -369,35 +443,18 @@ bool LaneFilter::IsOverlay(Object_2D obj, vector<int> line){
 }
 
 
-/*Funciton Name:FilterObjectList()                                                                  */                            
-/*Description: Filter object by lane                                                                    */
-/*Input: void                                                                                                               */    
-/*Output: void                                                                                                           */
-
-void LaneFilter::FilterObjectList(){
-
-    vector<Object_2D> temp; 
-    int size = (*source_2D).size();
+/*Funciton Name: Fit(const Object_2D& obj)                                                     */
+/*Description: Keep objects overlaying the lane at their depth                */
+/*Input: const Object_2D& obj - 2D object                                                         */
+/*Output: bool result - 1: keep                                                                            */
 
-	// loop through objects
-	for(int i=0; i<size; i++){
-		Object_2D obj = (*source_2D)[i];
-        float distance = (*clane->CamModel()).Disparity_Distance(obj.disparity);
-	    int sec = int(distance/clane->LaneDepthStep());
-		if(sec<=clane->LaneNumWP() && sec>=0){
-            vector<int> line = clane->Width(sec);
-			bool overlay = IsOverlay(obj, line);
-			if (overlay) temp.push_back(obj);
-		}
-	}
+bool LaneFilter::Fit(const Object_2D& obj){
 
-	// Clear original list
-	(*source_2D).clear();
+    float distance = (*clane->CamModel()).Disparity_Distance(obj.disparity);
+    int sec = int(distance/clane->LaneDepthStep());
+    if(sec>clane->LaneNumWP() || sec<0) return false;
 
-    // Copy back to original list
-	for(int i=0; i<temp.size(); i++){
-	    (*source_2D).push_back(temp[i]);
-	}
+    return IsOverlay(obj, clane->Width(sec));
 
 }
 
@@ -426,13 +483,13 @@ MonoLaneFilter::MonoLaneFilter(MonoLane* mlane){
 }
 
 
-/*Funciton Name: :IsOnGround(Object_2D obj, int ground_u)                                        */
+/*Funciton Name: :IsOnGround(const Object_2D& obj, int ground_u)                        */
 /*Description: Return whether a 2D object floats above max_pos_from_ground   */
-/*Input: Object_2D obj - 2D object
+/*Input: const Object_2D& obj - 2D object
                   int ground_u - ground line at the depth of the object                                        */  
 /*Output: bool result - 1: is on the ground                                                                                 */
 
-bool MonoLaneFilter::IsOnGround(Object_2D obj, int ground_u){
+bool MonoLaneFilter::IsOnGround(const Object_2D& obj, int ground_u){
 
     int disp = obj.disparity;
     int bottom = obj.br.y;
@@ -449,42 +506,107 @@ bool MonoLaneFilter::IsOnGround(Object_2D obj, int ground_u){
 }
 
 
-/*Funciton Name:FilterObjectList()                                                                  */                            
-/*Description: Filter object by lane                                                                    */
-/*Input: void                                                                                                               */    
-/*Output: void                                                                                                           */
+/*Funciton Name: Fit(const Object_2D& obj)                                                     */
+/*Description: Keep objects overlaying the lane and standing on the ground */
+/*Input: const Object_2D& obj - 2D object                                                         */
+/*Output: bool result - 1: keep                                                                            */
 
-void MonoLaneFilter::FilterObjectList(){
-
-    vector<Object_2D> temp; 
-    int size = (*source_2D).size();
-
-	// loop through objects
-	for(int i=0; i<size; i++){
-		Object_2D obj = (*source_2D)[i];
-        
-        float distance = (*mlane->CamModel()).Disparity_Distance(obj.disparity);
-	    int sec = int(distance/mlane->LaneDepthStep());
-		if(sec<=mlane->LaneNumWP() && sec>=0){
-            vector<int> line = mlane->Width(sec);
-            int ground_u = mlane->VisOneLine(sec)[0].y;
-            bool on_ground = IsOnGround(obj, ground_u);
-			bool overlay = IsOverlay(obj, line);
-			if (overlay&&on_ground) temp.push_back(obj);
-		}
-	}
+bool MonoLaneFilter::Fit(const Object_2D& obj){
 
-	// Clear original list
-	(*source_2D).clear();
+    float distance = (*mlane->CamModel()).Disparity_Distance(obj.disparity);
+    int sec = int(distance/mlane->LaneDepthStep());
+    if(sec>mlane->LaneNumWP() || sec<0) return false;
 
-    // Copy back to original list
-	for(int i=0; i<temp.size(); i++){
-	    (*source_2D).push_back(temp[i]);
-	}
+    int ground_u = mlane->VisOneLine(sec)[0].y;
+
+    return IsOverlay(obj, mlane->Width(sec)) && IsOnGround(obj, ground_u);
+
+}
+
+
+
+/*****************************************************************
+Class Name: FilterChain
+Description: Composition of object filters: the predicates of all filters
+                         in one compaction pass over the list, then NMS over the
+                         survivors; the filters are not owned
+*****************************************************************/
 
+/*Funciton Name: FilterChain()                                                                              */
+/*Description: Default constructor, empty chain                                            */
+/*Input: void                                                                                                               */
+
+FilterChain::FilterChain(){
+
+    nmsf = NULL;
+
+}
+
+
+/*Funciton Name: Add(ObjectFilter2D* filter)                                                    */
+/*Description: Append the predicate of a filter                                              */
+/*Input: ObjectFilter2D* filter - pointer to a filter                                          */
+/*Output: void                                                                                                               */
+
+void FilterChain::Add(ObjectFilter2D* filter){
+
+    filters.push_back(filter);
+
+}
+
+
+/*Funciton Name: SetNMS(NMSFilter* nmsf)                                                        */
+/*Description: NMS applied after the predicates                                           */
+/*Input: NMSFilter* nmsf - pointer to a NMSFilter, NULL for none                 */
+/*Output: void                                                                                                               */
+
+void FilterChain::SetNMS(NMSFilter* nmsf){
+
+    this->nmsf = nmsf;
+
+}
+
+
+/*Funciton Name: Clear()                                                                                          */
+/*Description: Remove all filters, the capacity is kept                               */
+/*Input: void                                                                                                               */
+/*Output: void                                                                                                               */
+
+void FilterChain::Clear(){
+
+    filters.clear();
+    nmsf = NULL;
+
+}
+
+
+/*Funciton Name: Fit(const Object_2D& obj)                                                     */
+/*Description: Keep objects that fit all filters, in order of addition       */
+/*Input: const Object_2D& obj - 2D object                                                         */
+/*Output: bool result - 1: keep                                                                            */
+
+bool FilterChain::Fit(const Object_2D& obj){
+
+    for(size_t i=0; i<filters.size(); i++)
+        if(!filters[i]->Fit(obj)) return false;
+
+    return true;
 
 }
 
 
+/*Funciton Name:FilterObjectList()                                                                  */
+/*Description: Compact the list with all predicates, then NMS                   */
+/*Input: void                                                                                                               */
+/*Output: void                                                                                                           */
+
+void FilterChain::FilterObjectList(){
+
+    ObjectFilter2D::FilterObjectList();
 
+    if(nmsf){
+        nmsf->UpdateObjectSource(source_2D);
+        nmsf->FilterObjectList();
+    }
 
+}
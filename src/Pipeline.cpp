@@ -0,0 +1,142 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        Pipeline
+*****************************************************************/
+
+#include "Pipeline.h"
+
+
+/*****************************************************************
+Class Name: RuntimeDisparity
+Description: disparity engine chosen by the configuration: a scheduler, or
+                         a single engine
+*****************************************************************/
+
+/*Funciton Name: RuntimeDisparity()                                                                  */
+/*Description: Default constructor                                                                    */
+/*Input: void                                                                                                               */
+
+RuntimeDisparity::RuntimeDisparity(){}
+
+
+/*Funciton Name: RuntimeDisparity(Ptr<Disparity> matcher, Ptr<DisparityScheduler> scheduler) */
+/*Description: constructor from the engines, the scheduler is used if set                          */
+/*Input: Ptr<Disparity> matcher - disparity engine
+                Ptr<DisparityScheduler> scheduler - disparity scheduler                                          */
+
+RuntimeDisparity::RuntimeDisparity(Ptr<Disparity> matcher, Ptr<DisparityScheduler> scheduler){
+
+    this->matcher = matcher;
+    this->scheduler = scheduler;
+
+}
+
+
+/*Funciton Name: CalculateDispMap(Mat img_l, Mat img_r)                  */
+/*Description: calculate disparity map                                                             */
+/*Input: Mat img_l - left image
+                Mat img_r - right image                                                                         */
+/*Output: Mat disparity                                                                                             */
+
+Mat RuntimeDisparity::CalculateDispMap(Mat img_l, Mat img_r){
+
+    if(scheduler) return scheduler->CalculateDispMap(img_l, img_r);
+
+    return matcher->CalculateDispMap(img_l, img_r);
+
+}
+
+
+/*Funciton Name: UpdateFrameTime(float frame_ms)                              */
+/*Description: report the end-to-end latency of the last frame            */
+/*Input: float frame_ms - latency of the whole frame [ms]                    */
+/*Output: void                                                                                                            */
+
+void RuntimeDisparity::UpdateFrameTime(float frame_ms){
+
+    if(scheduler) scheduler->UpdateFrameTime(frame_ms);
+
+}
+
+
+
+/*****************************************************************
+Class Name: RuntimeGround
+Description: ground model chosen by the configuration: mono, online with or
+                         without prediction, or background only
+*****************************************************************/
+
+/*Funciton Name: RuntimeGround()                                                                      */
+/*Description: Default constructor, background only                                  */
+/*Input: void                                                                                                               */
+
+RuntimeGround::RuntimeGround(){
+
+    iterations = 1;
+
+}
+
+
+/*Funciton Name: RuntimeGround(Ptr<MonoGroundFilter> mono, Ptr<OnlineGroundFilter> online, Ptr<PredictedGroundFilter> prediction, int iterations) */
+/*Description: constructor from the selected filters, mono before online, the
+                          prediction only with online                                                                                                                         */
+/*Input: Ptr<MonoGroundFilter> mono - mono ground filter
+                Ptr<OnlineGroundFilter> online - online ground filter
+                Ptr<PredictedGroundFilter> prediction - ground prediction
+                int iterations - number of filtering passes of online                                                                                  */
+
+RuntimeGround::RuntimeGround(Ptr<MonoGroundFilter> mono, Ptr<OnlineGroundFilter> online, Ptr<PredictedGroundFilter> prediction, int iterations){
+
+    this->mono = mono;
+    this->online = online;
+    this->prediction = prediction;
+    this->iterations = iterations;
+
+}
+
+
+/*Funciton Name: FilterGround(Mat& disparity, int min_disparity)               */
+/*Description: filter ground and background with the selected filter       */
+/*Input: Mat& disparity - disparity map
+                int min_disparity - minimal disparity kept                                           */
+/*Output: void                                                                                                                */
+
+void RuntimeGround::FilterGround(Mat& disparity, int min_disparity){
+
+    if(mono){
+
+        mono->UpdateGroundPlane();
+        mono->FilterGround(disparity, min_disparity);
+
+    }
+    else if(online){
+
+        // Ground and background removal share the last pass
+        if(prediction) prediction->FilterGround(*online, disparity, min_disparity, iterations);
+        else{
+            online->UpdateGroundPlane(disparity);
+            online->FilterGround(disparity, min_disparity, iterations);
+        }
+
+    }
+    else GroundFilter::FilterBackground(disparity, min_disparity);
+
+}
+
+
+/*Funciton Name: GroundLine(float& k, float& b)                                              */
+/*Description: current ground line                                                                        */
+/*Input: float& k, float& b - ground line, row = k * disparity + b           */
+/*Output: bool valid - 0: no ground line                                                          */
+
+bool RuntimeGround::GroundLine(float& k, float& b){
+
+    VDisparityGroundFilter* ground = mono ? (VDisparityGroundFilter*)mono.get() : (VDisparityGroundFilter*)online.get();
+    if(!ground) return false;
+
+    k = ground->GroundK();
+    b = ground->GroundB();
+    return true;
+
+}
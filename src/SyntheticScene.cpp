@@ -0,0 +1,339 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        SyntheticScene
+*****************************************************************/
+
+#include "SyntheticScene.h"
+
+
+/*Funciton Name: Hash(int i, int j, unsigned salt)                                                 */
+/*Description: integer hash of a lattice point                                                       */
+/*Input: int i, int j - lattice point
+                unsigned salt - surface index                                                                            */
+/*Output: float value in [0, 1)                                                                                            */
+
+static inline float Hash(int i, int j, unsigned salt){
+
+    uint32_t h = (uint32_t)i*0x8da6b343u ^ (uint32_t)j*0xd8163841u ^ (salt + 1)*0xcb1ab31fu;
+    h ^= h>>13;
+    h *= 0x5bd1e995u;
+    h ^= h>>15;
+    return (h & 0xffffff)/16777216.f;
+
+}
+
+
+/*Funciton Name: ValueNoise(float a, float b, float cell, unsigned salt)             */
+/*Description: bilinear interpolation of hashed lattice values                          */
+/*Input: float a, float b - coordinates (m)
+                float cell - lattice size (m)
+                unsigned salt - surface index                                                                            */
+/*Output: float value in [0, 1)                                                                                            */
+
+static inline float ValueNoise(float a, float b, float cell, unsigned salt){
+
+    a /= cell;
+    b /= cell;
+    int i = (int)floor(a), j = (int)floor(b);
+    float fa = a - i, fb = b - j;
+    float top = Hash(i, j, salt)*(1 - fa) + Hash(i + 1, j, salt)*fa;
+    float bottom = Hash(i, j + 1, salt)*(1 - fa) + Hash(i + 1, j + 1, salt)*fa;
+    return top*(1 - fb) + bottom*fb;
+
+}
+
+
+/*Funciton Name: SyntheticScene()                                                                           */
+/*Description: Default constructor                                                                            */
+/*Input: void                                                                                                                      */
+
+SyntheticScene::SyntheticScene(){}
+
+
+/*Funciton Name: SyntheticScene(CameraModel* cm, string montage)      */
+/*Description: Constructor with camera model, the camera height is
+                          abs_init_y of the montage file                                                    */
+/*Input: CameraModel* cm - pointer to a CameraModel
+                string montage - path to montage file                                                  */
+
+SyntheticScene::SyntheticScene(CameraModel* cm, string montage){
+
+    width = cm->OutWidth();
+    height = cm->OutHeight();
+    f = cm->F();
+    cx = cm->OutCx();
+    cy = cm->OutCy();
+    baseline = cm->Baseline();
+
+    FileStorage fs(montage, FileStorage::READ);
+    fs["abs_init_y"]>>cam_height;
+    fs.release();
+
+    cam_theta = 0;
+    far_distance = 30;
+    travelled = 0;
+
+}
+
+
+/*Funciton Name: SetPitch(float theta)                                                                   */
+/*Description: set camera pitch, same convention as MonoCameraModel   */
+/*Input: float theta - pitch in degree                                                                    */
+/*Output: void                                                                                                                     */
+
+void SyntheticScene::SetPitch(float theta){
+
+    cam_theta = theta;
+
+}
+
+
+/*Funciton Name: AddBox(SyntheticBox box)                                                        */
+/*Description: add a box obstacle                                                                            */
+/*Input: SyntheticBox box - box in the level frame                                         */
+/*Output: void                                                                                                                     */
+
+void SyntheticScene::AddBox(SyntheticBox box){
+
+    boxes.push_back(box);
+
+}
+
+
+/*Funciton Name: RandomBoxes(int num, unsigned seed, float min_z, float max_z) */
+/*Description: replace the obstacles with reproducible random boxes      */
+/*Input: int num - number of boxes
+                unsigned seed - random seed
+                float min_z, float max_z - range of distance (m)                           */
+/*Output: void                                                                                                                     */
+
+void SyntheticScene::RandomBoxes(int num, unsigned seed, float min_z, float max_z){
+
+    RNG rng(seed);
+    boxes.clear();
+    for(int i = 0; i < num; i++){
+        SyntheticBox box;
+        box.z = rng.uniform(min_z, max_z);
+        // keep the box inside the horizontal field of view
+        float half_fov = (width/2.f)/f*box.z;
+        box.width = rng.uniform(0.2f, 0.8f);
+        box.height = rng.uniform(0.2f, min(1.2f, cam_height*1.5f));
+        box.x = rng.uniform(-half_fov*0.8f, half_fov*0.8f);
+        boxes.push_back(box);
+    }
+
+}
+
+
+/*Funciton Name: Step(float distance)                                                                 */
+/*Description: move the camera forward, boxes behind it are dropped  */
+/*Input: float distance - forward motion (m)                                                  */
+/*Output: void                                                                                                                     */
+
+void SyntheticScene::Step(float distance){
+
+    travelled += distance;
+    for(size_t i = 0; i < boxes.size(); i++) boxes[i].z -= distance;
+    boxes.erase(remove_if(boxes.begin(), boxes.end(), [](const SyntheticBox& box){ return box.z <= 0.1f; }), boxes.end());
+
+}
+
+
+/*Funciton Name: Texture(float a, float b, unsigned salt)                                    */
+/*Description: two octaves of value noise on surface coordinates             */
+/*Input: float a, float b - surface coordinates (m)
+                unsigned salt - surface index                                                                      */
+/*Output: uchar intensity                                                                                                    */
+
+uchar SyntheticScene::Texture(float a, float b, unsigned salt){
+
+    float value = 0.6f*ValueNoise(a, b, 0.05f, salt) + 0.4f*ValueNoise(a, b, 0.015f, salt + 7919);
+    // surfaces differ in brightness as well
+    float offset = 40 + Hash(salt, 0, 0)*60;
+    return saturate_cast<uchar>(offset + value*150);
+
+}
+
+
+/*Funciton Name: Cast(float u, float v, float offset, float& depth, int& surface)  */
+/*Description: intersect the ray of pixel (u, v) of a camera shifted by offset
+                          along x with the scene                                                                   */
+/*Input: float u, float v - pixel
+                float offset - camera position along x (m)
+                float& depth - depth along the optical axis (m)
+                int& surface - 0 background, 1 ground, 2+ box index                   */
+/*Output: uchar intensity                                                                                                    */
+
+uchar SyntheticScene::Cast(float u, float v, float offset, float& depth, int& surface){
+
+    float c = cos(cam_theta*M_PI/180), s = sin(cam_theta*M_PI/180);
+
+    // Ray with unit depth, rotated into the level frame (y down to the ground)
+    float xr = (u - cx)/f, yr = (v - cy)/f;
+    float dx = xr;
+    float dy = yr*c - s;
+    float dz = yr*s + c;
+
+    depth = FLT_MAX;
+    surface = 0;
+    uchar intensity = 0;
+
+    // Background wall
+    if(dz > 1e-6){
+        depth = far_distance/dz;
+        intensity = Texture(offset + depth*dx, depth*dy, 1);
+    }
+
+    // Ground plane
+    if(dy > 1e-6 && cam_height/dy < depth){
+        depth = cam_height/dy;
+        surface = 1;
+        intensity = Texture(offset + depth*dx, depth*dz + travelled, 0);
+    }
+
+    // Front faces of the boxes
+    if(dz > 1e-6){
+        for(size_t i = 0; i < boxes.size(); i++){
+            const SyntheticBox& box = boxes[i];
+            float t = box.z/dz;
+            if(t >= depth) continue;
+            float x = offset + t*dx - box.x, y = t*dy;
+            if(fabs(x) > box.width/2 || y > cam_height || y < cam_height - box.height) continue;
+            depth = t;
+            surface = i + 2;
+            intensity = Texture(x, y, i + 2);
+        }
+    }
+
+    return intensity;
+
+}
+
+
+/*Funciton Name: Render(Mat& left, Mat& right)                                               */
+/*Description: render a rectified pair (CV_8U) and update the ground truth */
+/*Input: Mat& left - left image
+                Mat& right - right image                                                                             */
+/*Output: void                                                                                                                     */
+
+void SyntheticScene::Render(Mat& left, Mat& right){
+
+    left.create(height, width, CV_8U);
+    right.create(height, width, CV_8U);
+    disparity_gt.create(height, width, CV_32F);
+    surface_gt.create(height, width, CV_8U);
+
+    float fb = f*baseline;
+
+    parallel_for_(Range(0, height), [&](const Range& range){
+        for(int v = range.start; v < range.end; v++){
+            uchar* l = left.ptr<uchar>(v);
+            uchar* r = right.ptr<uchar>(v);
+            float* gt = disparity_gt.ptr<float>(v);
+            uchar* label = surface_gt.ptr<uchar>(v);
+            for(int u = 0; u < width; u++){
+                float depth;
+                int surface;
+                l[u] = Cast(u, v, 0, depth, surface);
+                gt[u] = depth < FLT_MAX ? fb/depth : 0;
+                label[u] = (uchar)min(surface, 255);
+                r[u] = Cast(u, v, baseline, depth, surface);
+            }
+        }
+    });
+
+}
+
+
+/*Funciton Name: GroundTruth()                                                                             */
+/*Description: disparity of the last rendered left image (CV_32F, pixel) */
+/*Input: void                                                                                                                      */
+/*Output: Mat disparity_gt                                                                                             */
+
+Mat SyntheticScene::GroundTruth(){
+
+    return disparity_gt;
+
+}
+
+
+/*Funciton Name: Labels()                                                                                           */
+/*Description: surface of the last rendered left image (CV_8U), 0 background,
+                          1 ground, 2+ box index                                                                         */
+/*Input: void                                                                                                                      */
+/*Output: Mat surface_gt                                                                                                */
+
+Mat SyntheticScene::Labels(){
+
+    return surface_gt;
+
+}
+
+
+/*Funciton Name: GroundK(), GroundB()                                                              */
+/*Description: ground line in v-disparity, row = k * disparity + b         */
+/*Input: void                                                                                                                      */
+/*Output: float k, float b                                                                                                 */
+
+float SyntheticScene::GroundK(){
+
+    return cam_height/(baseline*cos(cam_theta*M_PI/180));
+
+}
+
+float SyntheticScene::GroundB(){
+
+    return cy + f*tan(cam_theta*M_PI/180);
+
+}
+
+
+/*Funciton Name: Objects()                                                                                     */
+/*Description: image boxes of the visible obstacles, in front of the
+                          camera and inside the image, occlusion is not considered */
+/*Input: void                                                                                                                      */
+/*Output: vector<Object_2D> list                                                                             */
+
+vector<Object_2D> SyntheticScene::Objects(){
+
+    float c = cos(cam_theta*M_PI/180), s = sin(cam_theta*M_PI/180);
+    vector<Object_2D> list;
+
+    for(size_t i = 0; i < boxes.size(); i++){
+
+        const SyntheticBox& box = boxes[i];
+        float min_u = FLT_MAX, min_v = FLT_MAX, max_u = -FLT_MAX, max_v = -FLT_MAX;
+        bool in_front = true;
+
+        // Project the corners of the front face (level frame back to camera frame)
+        for(int k = 0; k < 4; k++){
+            float x = box.x + (k&1 ? box.width/2 : -box.width/2);
+            float y = k&2 ? cam_height : cam_height - box.height;
+            float z = -y*s + box.z*c;
+            if(z <= 0.1f){
+                in_front = false;
+                break;
+            }
+            float u = cx + f*x/z, v = cy + f*(y*c + box.z*s)/z;
+            min_u = min(min_u, u);
+            max_u = max(max_u, u);
+            min_v = min(min_v, v);
+            max_v = max(max_v, v);
+        }
+        if(!in_front) continue;
+
+        Object_2D object;
+        object.tl = Point2f(max(min_u, 0.f), max(min_v, 0.f));
+        object.br = Point2f(min(max_u, width - 1.f), min(max_v, height - 1.f));
+        if(object.br.x <= object.tl.x || object.br.y <= object.tl.y) continue;
+
+        float center_y = cam_height - box.height/2;
+        object.disparity = f*baseline/(-center_y*s + box.z*c);
+        list.push_back(object);
+
+    }
+
+    return list;
+
+}
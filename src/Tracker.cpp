@@ -0,0 +1,519 @@
+/*****************************************************************
+Author:                 J. Gong
+Date:                      2026-10-18
+Description:        Tracker
+*****************************************************************/
+
+#include "Tracker.h"
+
+
+/*Funciton Name: IoU(Object_2D a, Object_2D b)                                                       */
+/*Description: intersection over union of two image boxes                            */
+/*Input: Object_2D a, Object_2D b - objects                                                          */
+/*Output: float iou                                                                                                                  */
+
+static float IoU(Object_2D a, Object_2D b){
+
+    float w = min(a.br.x, b.br.x) - max(a.tl.x, b.tl.x);
+    float h = min(a.br.y, b.br.y) - max(a.tl.y, b.tl.y);
+    if(w <= 0 || h <= 0) return 0;
+    float area_a = (a.br.x - a.tl.x)*(a.br.y - a.tl.y);
+    float area_b = (b.br.x - b.tl.x)*(b.br.y - b.tl.y);
+    return w*h/(area_a + area_b - w*h);
+
+}
+
+
+/*****************************************************************
+Class Name: Tracker
+Description: multi-object tracker
+*****************************************************************/
+
+/*Funciton Name: Tracker()                                                                                     */
+/*Description: Default constructor                                                                     */
+/*Input: void                                                                                                               */
+
+Tracker::Tracker(){
+
+    offset_x = 0;
+    offset_y = 0;
+    detect_interval = 1;
+    iou_threshold = 0.3;
+    max_misses = 3;
+    min_hits = 1;
+    process_noise = 2;
+    sigma_pixel = 2;
+    sigma_disparity = 1;
+    verify_confidence = 0.3;
+    verify_tolerance = 2;
+
+    ego = NULL;
+    last_yaw = 0;
+    next_id = 0;
+
+    last_tick = 0;
+    since_detection = 0;
+    verify_failed = false;
+
+    num_frames = 0;
+    num_detections = 0;
+    total_time = 0;
+    last_time = 0;
+
+}
+
+
+/*Funciton Name: Tracker(Mat Q, int offset_x, int offset_y, string config)  */
+/*Description: Constructor with the reprojection of the disparity map  */
+/*Input: Mat Q - reprojection matrix
+                int offset_x, int offset_y - offset of the disparity map in the image
+                string config - path to configuration file                                           */
+
+Tracker::Tracker(Mat Q, int offset_x, int offset_y, string config): Tracker(Q, offset_x, offset_y, DetectionConfig::Load(config).tracker){}
+
+
+/*Funciton Name: Tracker(Mat Q, int offset_x, int offset_y, const TrackerParams& params) */
+/*Description: Constructor with the reprojection of the disparity map and
+                          parsed configuration                                                                  */
+/*Input: Mat Q - reprojection matrix
+                int offset_x, int offset_y - offset of the disparity map in the image
+                const TrackerParams& params - tracker parameters                            */
+
+Tracker::Tracker(Mat Q, int offset_x, int offset_y, const TrackerParams& params): Tracker(){
+
+    Mat q64;
+    Q.convertTo(q64, CV_64F);
+    q = Matx44d(q64.ptr<double>());
+    q_inv = q.inv();
+    this->offset_x = offset_x;
+    this->offset_y = offset_y;
+
+    detect_interval = params.track_detect_interval;
+    iou_threshold = params.track_iou_threshold;
+    max_misses = params.track_max_misses;
+    min_hits = params.track_min_hits;
+    process_noise = params.track_process_noise;
+    sigma_pixel = params.track_sigma_pixel;
+    sigma_disparity = params.track_sigma_disparity;
+    verify_confidence = params.track_verify_confidence;
+    verify_tolerance = params.track_verify_tolerance;
+
+}
+
+
+/*Funciton Name: SetDetectInterval(int interval)                                             */
+/*Description: frames between full detections                                          */
+/*Input: int interval - frames, 1: detect every frame                                    */
+/*Output: void                                                                                                               */
+
+void Tracker::SetDetectInterval(int interval){
+
+    detect_interval = max(interval, 1);
+
+}
+
+
+/*Funciton Name: SetEgoSource(Motion* ego)                                                      */
+/*Description: absolute T265 motion (x right, y up, z backward, yaw in
+                          degree positive to the right) to compensate the tracks */
+/*Input: Motion* ego - pointer to the motion, NULL for a static camera      */
+/*Output: void                                                                                                               */
+
+void Tracker::SetEgoSource(Motion* ego){
+
+    this->ego = ego;
+    if(ego){
+        last_position = ego->position;
+        last_yaw = ego->rotation.yaw;
+    }
+
+}
+
+
+/*Funciton Name: ToCamera(float u, float v, float d)                                        */
+/*Description: reproject an image point with disparity                             */
+/*Input: float u, float v - pixel of the disparity map
+                float d - disparity                                                                                     */
+/*Output: Point3f point in the camera frame                                                    */
+
+Point3f Tracker::ToCamera(float u, float v, float d){
+
+    Vec4d h = q*Vec4d(u + offset_x, v + offset_y, d, 1);
+    return Point3f(h[0]/h[3], h[1]/h[3], h[2]/h[3]);
+
+}
+
+
+/*Funciton Name: ToImage(Point3f p)                                                                   */
+/*Description: project a point of the camera frame                                   */
+/*Input: Point3f p - point in the camera frame                                             */
+/*Output: Point3f (u, v, d) on the disparity map                                             */
+
+Point3f Tracker::ToImage(Point3f p){
+
+    Vec4d h = q_inv*Vec4d(p.x, p.y, p.z, 1);
+    return Point3f(h[0]/h[3] - offset_x, h[1]/h[3] - offset_y, h[2]/h[3]);
+
+}
+
+
+/*Funciton Name: UpdateBox(Track& track)                                                      */
+/*Description: image box of the state of a track                                       */
+/*Input: Track& track - track                                                                              */
+/*Output: void                                                                                                               */
+
+void Tracker::UpdateBox(Track& track){
+
+    const float* s = track.kf.statePost.ptr<float>();
+    Point3f tl = ToImage(Point3f(s[0] - track.size.x/2, s[1] - track.size.y/2, s[2]));
+    Point3f br = ToImage(Point3f(s[0] + track.size.x/2, s[1] + track.size.y/2, s[2]));
+    track.box.tl = Point2f(tl.x, tl.y);
+    track.box.br = Point2f(br.x, br.y);
+    track.box.disparity = tl.z;
+
+}
+
+
+/*Funciton Name: Measure(Track& track, Point3f center)                                   */
+/*Description: Kalman correction with a measured center, the error grows
+                          with the depth as for the disparity                                 */
+/*Input: Track& track - track
+                Point3f center - measured center (m)                                                    */
+/*Output: void                                                                                                               */
+
+void Tracker::Measure(Track& track, Point3f center){
+
+    // Lateral error from the box, depth error from the disparity: dZ = Z/d * dd
+    float d = max(ToImage(center).z, 1.f);
+    float sigma_xy = center.z*sigma_pixel/float(q(2, 3));
+    float sigma_z = center.z/d*sigma_disparity;
+    setIdentity(track.kf.measurementNoiseCov, Scalar::all(sigma_xy*sigma_xy));
+    track.kf.measurementNoiseCov.at<float>(2, 2) = sigma_z*sigma_z;
+
+    Mat measurement = (Mat_<float>(3, 1)<<center.x, center.y, center.z);
+    track.kf.correct(measurement);
+
+}
+
+
+/*Funciton Name: Predict()                                                                                     */
+/*Description: move all tracks to the current frame: ego-motion since the
+                          last frame, then constant velocity                                          */
+/*Input: void                                                                                                               */
+/*Output: void                                                                                                               */
+
+void Tracker::Predict(){
+
+    int64 start = getTickCount();
+    float dt = last_tick ? float((start - last_tick)/getTickFrequency()) : 0;
+    last_tick = start;
+    num_frames++;
+    since_detection++;
+
+    // Ego-motion in the camera frame of the last heading, then the turn
+    Point3f t(0, 0, 0);
+    float turn = 0;
+    if(ego){
+        Point3f d = ego->position - last_position;
+        float yaw = last_yaw*CV_PI/180;
+        float right = d.x, forward = -d.z;
+        t = Point3f(cos(yaw)*right - sin(yaw)*forward, -d.y, sin(yaw)*right + cos(yaw)*forward);
+        turn = (ego->rotation.yaw - last_yaw)*CV_PI/180;
+        last_position = ego->position;
+        last_yaw = ego->rotation.yaw;
+    }
+    float c = cos(turn), s = sin(turn);
+    Mat rotation = Mat::eye(6, 6, CV_32F);
+    for(int k=0; k<6; k+=3){
+        rotation.at<float>(k, k) = c;
+        rotation.at<float>(k, k + 2) = -s;
+        rotation.at<float>(k + 2, k) = s;
+        rotation.at<float>(k + 2, k + 2) = c;
+    }
+
+    // Constant velocity with white acceleration noise
+    float q2 = process_noise*process_noise;
+    float dt2 = dt*dt;
+    for(size_t i=0; i<tracks.size(); i++){
+
+        KalmanFilter& kf = tracks[i].kf;
+        float* x = kf.statePost.ptr<float>();
+        x[0] -= t.x;
+        x[1] -= t.y;
+        x[2] -= t.z;
+        kf.statePost = Mat(rotation*kf.statePost);
+        kf.errorCovPost = Mat(rotation*kf.errorCovPost*rotation.t());
+
+        setIdentity(kf.transitionMatrix);
+        kf.processNoiseCov = Mat::zeros(6, 6, CV_32F);
+        for(int k=0; k<3; k++){
+            kf.transitionMatrix.at<float>(k, k + 3) = dt;
+            kf.processNoiseCov.at<float>(k, k) = q2*dt2*dt2/4;
+            kf.processNoiseCov.at<float>(k, k + 3) = q2*dt2*dt/2;
+            kf.processNoiseCov.at<float>(k + 3, k) = q2*dt2*dt/2;
+            kf.processNoiseCov.at<float>(k + 3, k + 3) = q2*dt2;
+        }
+        kf.predict();
+        UpdateBox(tracks[i]);
+
+    }
+
+    last_time = (getTickCount() - start)*1000.0/getTickFrequency();
+    total_time += last_time;
+
+}
+
+
+/*Funciton Name: NeedDetection()                                                                      */
+/*Description: whether the current frame needs a full detection: every
+                          detect_interval frames or after a failed verification     */
+/*Input: void                                                                                                               */
+/*Output: bool result - 1: detect                                                                           */
+
+bool Tracker::NeedDetection(){
+
+    return num_detections == 0 || verify_failed || since_detection >= detect_interval;
+
+}
+
+
+/*Funciton Name: Correct(const vector<Object_2D>& list)                                   */
+/*Description: associate a detection list to the predicted tracks, start
+                          tracks for new objects and drop lost ones                          */
+/*Input: const vector<Object_2D>& list - detected objects                                */
+/*Output: void                                                                                                               */
+
+void Tracker::Correct(const vector<Object_2D>& list){
+
+    int64 start = getTickCount();
+    num_detections++;
+    since_detection = 0;
+    verify_failed = false;
+
+    // Detections in the camera frame
+    vector<Point3f> centers(list.size());
+    vector<Point2f> sizes(list.size());
+    for(size_t j=0; j<list.size(); j++){
+        Point3f a = ToCamera(list[j].tl.x, list[j].tl.y, list[j].disparity);
+        Point3f b = ToCamera(list[j].br.x, list[j].br.y, list[j].disparity);
+        centers[j] = (a + b)*0.5;
+        sizes[j] = Point2f(fabs(b.x - a.x), fabs(b.y - a.y));
+    }
+
+    // Association by IoU of the predicted boxes
+    vector<vector<float>> cost(tracks.size(), vector<float>(list.size()));
+    for(size_t i=0; i<tracks.size(); i++)
+        for(size_t j=0; j<list.size(); j++) cost[i][j] = 1 - IoU(tracks[i].box, list[j]);
+    vector<int> assignment = Hungarian(cost);
+
+    vector<bool> matched(list.size(), false);
+    for(size_t i=0; i<tracks.size(); i++){
+        int j = assignment[i];
+        if(j < 0 || 1 - cost[i][j] < iou_threshold){
+            tracks[i].misses++;
+            continue;
+        }
+        Measure(tracks[i], centers[j]);
+        tracks[i].size = tracks[i].size*0.7 + sizes[j]*0.3;
+        tracks[i].hits++;
+        tracks[i].misses = 0;
+        matched[j] = true;
+    }
+
+    // New objects, velocity unknown
+    for(size_t j=0; j<list.size(); j++){
+
+        if(matched[j]) continue;
+
+        Track track;
+        track.id = next_id++;
+        track.kf.init(6, 3, 0, CV_32F);
+        setIdentity(track.kf.measurementMatrix);
+        Mat state = (Mat_<float>(6, 1)<<centers[j].x, centers[j].y, centers[j].z, 0, 0, 0);
+        state.copyTo(track.kf.statePost);
+        setIdentity(track.kf.errorCovPost, Scalar::all(1));
+        float d = max(list[j].disparity, 1.f);
+        float sigma_xy = centers[j].z*sigma_pixel/float(q(2, 3)), sigma_z = centers[j].z/d*sigma_disparity;
+        for(int k=0; k<2; k++) track.kf.errorCovPost.at<float>(k, k) = sigma_xy*sigma_xy;
+        track.kf.errorCovPost.at<float>(2, 2) = sigma_z*sigma_z;
+        track.size = sizes[j];
+        track.hits = 1;
+        track.misses = 0;
+        tracks.push_back(track);
+
+    }
+
+    tracks.erase(remove_if(tracks.begin(), tracks.end(), [&](const Track& track){ return track.misses > max_misses; }), tracks.end());
+    for(size_t i=0; i<tracks.size(); i++) UpdateBox(tracks[i]);
+
+    double time = (getTickCount() - start)*1000.0/getTickFrequency();
+    last_time += time;
+    total_time += time;
+
+}
+
+
+/*Funciton Name: Verify(Mat disparity)                                                                */
+/*Description: check the predicted boxes on the disparity map instead of a
+                          detection: enough pixels and median disparity close to the
+                          prediction correct the depth, otherwise detection is due */
+/*Input: Mat disparity - disparity map, ground removed                             */
+/*Output: void                                                                                                               */
+
+void Tracker::Verify(Mat disparity){
+
+    int64 start = getTickCount();
+    stats.Update(disparity, true);
+    Rect image(0, 0, disparity.cols, disparity.rows);
+
+    for(size_t i=0; i<tracks.size(); i++){
+
+        Track& track = tracks[i];
+        Rect box = Rect(Point(cvRound(track.box.tl.x), cvRound(track.box.tl.y)), Point(cvRound(track.box.br.x) + 1, cvRound(track.box.br.y) + 1)) & image;
+
+        // Left the view
+        if(box.area() == 0){
+            track.misses = max_misses + 1;
+            continue;
+        }
+
+        int median = stats.Median(box);
+        if(stats.Confidence(box) >= verify_confidence && fabs(median - track.box.disparity) <= verify_tolerance){
+            Measure(track, ToCamera(box.x + box.width/2.f, box.y + box.height/2.f, median));
+            track.misses = 0;
+        }
+        else{
+            track.misses++;
+            verify_failed = true;
+        }
+
+    }
+
+    tracks.erase(remove_if(tracks.begin(), tracks.end(), [&](const Track& track){ return track.misses > max_misses; }), tracks.end());
+    for(size_t i=0; i<tracks.size(); i++) UpdateBox(tracks[i]);
+
+    double time = (getTickCount() - start)*1000.0/getTickFrequency();
+    last_time += time;
+    total_time += time;
+
+}
+
+
+/*Funciton Name: Hungarian(const vector<vector<float>>& cost)                        */
+/*Description: minimal cost assignment of a rectangular matrix             */
+/*Input: const vector<vector<float>>& cost - rows x cols                                */
+/*Output: vector<int> column of each row, -1 if none                                  */
+
+vector<int> Tracker::Hungarian(const vector<vector<float>>& cost){
+
+    int rows = int(cost.size()), cols = rows ? int(cost[0].size()) : 0;
+    vector<int> assignment(rows, -1);
+    if(rows == 0 || cols == 0) return assignment;
+
+    // Square matrix, padded with a constant cost; potentials u, v and
+    // matching p (column to row), 1-based with column 0 as the root
+    int n = max(rows, cols);
+    auto a = [&](int i, int j){ return i <= rows && j <= cols ? double(cost[i-1][j-1]) : 1.0; };
+    vector<double> u(n + 1, 0), v(n + 1, 0);
+    vector<int> p(n + 1, 0), way(n + 1, 0);
+
+    for(int i=1; i<=n; i++){
+
+        p[0] = i;
+        int j0 = 0;
+        vector<double> minv(n + 1, DBL_MAX);
+        vector<bool> used(n + 1, false);
+
+        do{
+            used[j0] = true;
+            int i0 = p[j0], j1 = 0;
+            double delta = DBL_MAX;
+            for(int j=1; j<=n; j++){
+                if(used[j]) continue;
+                double current = a(i0, j) - u[i0] - v[j];
+                if(current < minv[j]){
+                    minv[j] = current;
+                    way[j] = j0;
+                }
+                if(minv[j] < delta){
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for(int j=0; j<=n; j++){
+                if(used[j]){
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                }
+                else minv[j] -= delta;
+            }
+            j0 = j1;
+        }while(p[j0] != 0);
+
+        do{
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        }while(j0);
+
+    }
+
+    for(int j=1; j<=cols; j++)   if(p[j] >= 1 && p[j] <= rows) assignment[p[j] - 1] = j - 1;
+    return assignment;
+
+}
+
+
+/*Funciton Name: List2D(), IDs()                                                                           */
+/*Description: boxes and IDs of the confirmed tracks supported in this frame */
+/*Input: void                                                                                                               */
+/*Output: vector<Object_2D> list, vector<int> ids                                            */
+
+vector<Object_2D> Tracker::List2D(){
+
+    vector<Object_2D> list;
+    for(size_t i=0; i<tracks.size(); i++)
+        if(tracks[i].hits >= min_hits && tracks[i].misses == 0) list.push_back(tracks[i].box);
+    return list;
+
+}
+
+vector<int> Tracker::IDs(){
+
+    vector<int> ids;
+    for(size_t i=0; i<tracks.size(); i++)
+        if(tracks[i].hits >= min_hits && tracks[i].misses == 0) ids.push_back(tracks[i].id);
+    return ids;
+
+}
+
+
+/*Funciton Name: DutyCycle()                                                                                */
+/*Description: fraction of frames with full detection                                  */
+/*Input: void                                                                                                               */
+/*Output: float ratio                                                                                                       */
+
+float Tracker::DutyCycle(){
+
+    return num_frames ? float(num_detections)/num_frames : 1;
+
+}
+
+
+/*Funciton Name: TrackTime(), MeanTrackTime()                                               */
+/*Description: tracking time of the last frame and mean per frame (ms),
+                          detection itself excluded                                                           */
+/*Input: void                                                                                                               */
+/*Output: double time                                                                                                    */
+
+double Tracker::TrackTime(){
+
+    return last_time;
+
+}
+
+double Tracker::MeanTrackTime(){
+
+    return num_frames ? total_time/num_frames : 0;
+
+}
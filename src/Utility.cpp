@@ -194,13 +194,25 @@ MedianFilter::MedianFilter(int n):ValueFilter(n){}
 
 int MedianFilter:: Filter(int input){
 
+    return int(Filter(float(input)));
+
+}
+
+
+/*Funciton Name: Filter(float input)                                  								    */
+/*Description: Perform median filter on float values                              */
+/*Input: float input - input value                                                                       */   
+/*Output: float output_value                                                                             */
+
+float MedianFilter:: Filter(float input){
+
     if(history.size()==N){
 
         history.pop();
         history.push(input);
 
-        queue<int> temp(history);
-        vector<int> vec;
+        queue<float> temp(history);
+        vector<float> vec;
 
         while(temp.size()!=0){
             vec.push_back(temp.front());
@@ -208,7 +220,7 @@ int MedianFilter:: Filter(int input){
         }
 
         std::nth_element(vec.begin(), vec.begin() + vec.size() / 2, vec.end());
-        int output = vec[vec.size() / 2];
+        float output = vec[vec.size() / 2];
 
         return output;
 
@@ -220,8 +232,469 @@ int MedianFilter:: Filter(int input){
         
     }
 
+}
+
+
+
+/*****************************************************************
+Class Name: BitMask
+Description: binary mask packed 64 pixels per word
+*****************************************************************/
+
+/*Funciton Name: BitMask()                                                                                 */
+/*Description: Default constructor, empty mask                                          */
+/*Input: void                                                                                                               */
+
+BitMask::BitMask(){
+
+    rows = 0;
+    cols = 0;
+    words = 0;
+
+}
+
+
+/*Funciton Name: BitMask(int rows, int cols)                                                   */
+/*Description: Constructor of a cleared mask                                             */
+/*Input: int rows, int cols - mask size                                                                */
+
+BitMask::BitMask(int rows, int cols): BitMask(){
+
+    Create(rows, cols);
+
+}
+
+
+/*Funciton Name: Create(int rows, int cols)                                                     */
+/*Description: clear the mask, reallocate only if the size changes           */
+/*Input: int rows, int cols - mask size                                                                */
+/*Output: void                                                                                                                */
+
+void BitMask::Create(int rows, int cols){
+
+    this->rows = rows;
+    this->cols = cols;
+    words = (cols + 63)/64;
+    bits.assign(size_t(rows)*words, 0);
+
+}
+
+
+/*Funciton Name: Extract(const uint64_t* row, int length, int position, bool fill) */
+/*Description: 64 bits of a row starting at a bit position, bits outside
+                          the row are fill                                                                                   */
+/*Input: const uint64_t* row - packed row
+                int length - bits of the row
+                int position - first bit, may be negative
+                bool fill - value outside the row                                                          */
+/*Output: uint64_t word                                                                                                     */
+
+uint64_t BitMask::Extract(const uint64_t* row, int length, int position, bool fill){
+
+    int n = (length + 63)/64;
+    uint64_t outside = fill ? ~uint64_t(0) : 0;
+    // bits of the last word beyond length
+    uint64_t tail = length%64 ? ~uint64_t(0) << (length%64) : 0;
+
+    auto word = [&](int i){
+        if(i < 0 || i >= n) return outside;
+        return i == n - 1 ? (row[i] & ~tail) | (outside & tail) : row[i];
+    };
+
+    int q = position >= 0 ? position/64 : -((63 - position)/64);
+    int s = position - 64*q;
+    uint64_t low = word(q);
+    return s == 0 ? low : (low >> s) | (word(q + 1) << (64 - s));
+
+}
+
+
+/*Funciton Name: Horizontal(int k, bool erode)                                               */
+/*Description: AND (erode) or OR (dilate) of k neighbours along the rows,
+                          by doubling the window, log2(k) word passes                     */
+/*Input: int k - kernel width
+                bool erode - 1: AND, 0: OR                                                                */
+/*Output: void                                                                                                                */
+
+void BitMask::Horizontal(int k, bool erode){
+
+    int anchor = k/2;
+    // padded row, bit j is column j - anchor
+    int length = cols + k;
+    int padded_words = (length + 63)/64;
+    uint64_t tail = cols%64 ? ~(~uint64_t(0) << (cols%64)) : ~uint64_t(0);
+
+    parallel_for_(Range(0, rows), [&](const Range& range){
+
+        vector<uint64_t> window(padded_words), next(padded_words), result(words);
+
+        for(int r=range.start; r<range.end; r++){
+
+            uint64_t* row = &bits[size_t(r)*words];
+
+            // window of 1 column
+            for(int w=0; w<padded_words; w++) window[w] = Extract(row, cols, 64*w - anchor, erode);
+            for(int w=0; w<words; w++) result[w] = erode ? ~uint64_t(0) : 0;
+
+            // result[x] = op of window bits [x, x + k), k in binary
+            int offset = 0;
+            for(int m=1, rest=k; rest; m*=2, rest>>=1){
+                if(rest & 1){
+                    for(int w=0; w<words; w++){
+                        uint64_t v = Extract(window.data(), length, 64*w + offset, erode);
+                        result[w] = erode ? result[w] & v : result[w] | v;
+                    }
+                    offset += m;
+                }
+                if(rest > 1){
+                    for(int w=0; w<padded_words; w++){
+                        uint64_t v = Extract(window.data(), length, 64*w + m, erode);
+                        next[w] = erode ? window[w] & v : window[w] | v;
+                    }
+                    window.swap(next);
+                }
+            }
+
+            for(int w=0; w<words; w++) row[w] = result[w];
+            row[words-1] &= tail;
+
+        }
+
+    });
+
+}
+
+
+/*Funciton Name: Vertical(int k, bool erode)                                                      */
+/*Description: AND (erode) or OR (dilate) of k neighbours along the columns,
+                          van Herk/Gil-Werman on whole rows of words                     */
+/*Input: int k - kernel height
+                bool erode - 1: AND, 0: OR                                                                */
+/*Output: void                                                                                                                */
+
+void BitMask::Vertical(int k, bool erode){
+
+    int anchor = k/2, length = rows + k - 1;
+    vector<uint64_t>& g = forward;
+    vector<uint64_t>& h = backward;
+    g.resize(size_t(length)*words);
+    h.resize(size_t(length)*words);
+    pad_row.assign(words, erode ? ~uint64_t(0) : 0);
+
+    auto row = [&](int j){ return j<anchor || j-anchor>=rows ? pad_row.data() : &bits[size_t(j-anchor)*words]; };
+    auto op = [erode](uint64_t a, uint64_t b){ return erode ? a & b : a | b; };
+
+    for(int j=0; j<length; j++){
+        const uint64_t* p = row(j);
+        uint64_t* gj = &g[size_t(j)*words];
+        for(int w=0; w<words; w++) gj[w] = j%k == 0 ? p[w] : op(gj[w - words], p[w]);
+    }
+    for(int j=length-1; j>=0; j--){
+        const uint64_t* p = row(j);
+        uint64_t* hj = &h[size_t(j)*words];
+        for(int w=0; w<words; w++) hj[w] = j%k == k-1 || j == length-1 ? p[w] : op(hj[w + words], p[w]);
+    }
+    for(int i=0; i<rows; i++){
+        const uint64_t* hi = &h[size_t(i)*words];
+        const uint64_t* gi = &g[size_t(i+k-1)*words];
+        uint64_t* d = &bits[size_t(i)*words];
+        for(int w=0; w<words; w++) d[w] = op(hi[w], gi[w]);
+    }
+
+}
+
+
+/*Funciton Name: Erode(Size kernel), Dilate(Size kernel)                              */
+/*Description: rectangular erosion/dilation, anchor at the kernel center and
+                          pixels outside the mask ignored, as cv::erode/cv::dilate   */
+/*Input: Size kernel - kernel size                                                                        */
+/*Output: void                                                                                                                */
+
+void BitMask::Erode(Size kernel){
+
+    if(rows == 0 || cols == 0) return;
+    if(kernel.width > 1) Horizontal(kernel.width, true);
+    if(kernel.height > 1) Vertical(kernel.height, true);
+
+}
+
+void BitMask::Dilate(Size kernel){
+
+    if(rows == 0 || cols == 0) return;
+    if(kernel.width > 1) Horizontal(kernel.width, false);
+    if(kernel.height > 1) Vertical(kernel.height, false);
 
+}
+
+
+/*Funciton Name: Count(), Count(Rect box)                                                     */
+/*Description: set pixels of the mask or of a box, by popcount                  */
+/*Input: Rect box - area to be counted                                                             */
+/*Output: int count                                                                                                        */
+
+int BitMask::Count() const{
+
+    int count = 0;
+    for(size_t i=0; i<bits.size(); i++) count += __builtin_popcountll(bits[i]);
+    return count;
 
 }
 
+int BitMask::Count(Rect box) const{
+
+    box &= Rect(0, 0, cols, rows);
+    if(box.area() == 0) return 0;
+
+    int first = box.x/64, last = (box.x + box.width - 1)/64;
+    uint64_t head = ~uint64_t(0) << (box.x%64);
+    uint64_t end = (box.x + box.width)%64 ? ~(~uint64_t(0) << ((box.x + box.width)%64)) : ~uint64_t(0);
+
+    int count = 0;
+    for(int r=box.y; r<box.y + box.height; r++){
+        const uint64_t* row = &bits[size_t(r)*words];
+        for(int w=first; w<=last; w++){
+            uint64_t v = row[w];
+            if(w == first) v &= head;
+            if(w == last) v &= end;
+            count += __builtin_popcountll(v);
+        }
+    }
+    return count;
 
+}
+
+
+/*Funciton Name: Runs(int r, vector<Range>& runs)                                          */
+/*Description: append the runs of set pixels of a row, end exclusive       */
+/*Input: int r - row
+                vector<Range>& runs - output runs                                                         */
+/*Output: void                                                                                                                */
+
+void BitMask::Runs(int r, vector<Range>& runs) const{
+
+    const uint64_t* row = &bits[size_t(r)*words];
+    int start = -1;
+
+    for(int w=0; w<words; w++){
+
+        uint64_t v = row[w];
+        int base = 64*w;
+
+        // run open from the previous word
+        if(start >= 0){
+            if(v == ~uint64_t(0)) continue;
+            int end = __builtin_ctzll(~v);
+            runs.push_back(Range(start, base + end));
+            start = -1;
+            v &= ~uint64_t(0) << end;
+        }
+
+        while(v){
+            int begin = __builtin_ctzll(v);
+            uint64_t zeros = ~v & (~uint64_t(0) << begin);
+            if(!zeros){
+                start = base + begin;
+                break;
+            }
+            int end = __builtin_ctzll(zeros);
+            runs.push_back(Range(base + begin, base + end));
+            v &= ~uint64_t(0) << end;
+        }
+
+    }
+
+    if(start >= 0) runs.push_back(Range(start, cols));
+
+}
+
+
+/*Funciton Name: ToMat()                                                                                      */
+/*Description: unpack to a CV_8U mask (0/255)                                          */
+/*Input: void                                                                                                               */
+/*Output: Mat mask                                                                                                         */
+
+Mat BitMask::ToMat() const{
+
+    Mat mask(rows, cols, CV_8U);
+    for(int r=0; r<rows; r++){
+        const uint64_t* row = &bits[size_t(r)*words];
+        uchar* m = mask.ptr<uchar>(r);
+        for(int c=0; c<cols; c++) m[c] = (row[c>>6] >> (c&63)) & 1 ? 255 : 0;
+    }
+    return mask;
+
+}
+
+
+
+/*****************************************************************
+Class Name: BoxStatistics
+Description: per-frame statistics of the non-zero pixels in any box
+*****************************************************************/
+
+/*Funciton Name: BoxStatistics(int tile)                                                             */
+/*Description: Constructor with the tile size of the histogram              */
+/*Input: int tile - tile size (pixel)                                                                      */
+
+BoxStatistics::BoxStatistics(int tile){
+
+    this->tile = max(tile, 1);
+    tiles_x = 0;
+    tiles_y = 0;
+    has_histogram = false;
+
+}
+
+
+/*Funciton Name: Update(const Mat& disparity, bool histogram)                  */
+/*Description: build the integral images of a new map                             */
+/*Input: const Mat& disparity - CV_8U map, 0 is no value
+                bool histogram - also build the tile histograms for
+                                          Median and Max                                                         */
+/*Output: void                                                                                                                */
+
+void BoxStatistics::Update(const Mat& disparity, bool histogram){
+
+    CV_Assert(disparity.type() == CV_8U);
+    source = disparity;
+
+    Mat binary;
+    threshold(disparity, binary, 0, 1, THRESH_BINARY);
+    integral(binary, count_integral, CV_32S);
+    integral(disparity, sum_integral, CV_32S);
+
+    has_histogram = histogram;
+    if(!histogram) return;
+
+    tiles_x = (disparity.cols + tile - 1)/tile;
+    tiles_y = (disparity.rows + tile - 1)/tile;
+    int stride = (tiles_x + 1)*256;
+    this->histogram.assign(size_t(tiles_y + 1)*stride, 0);
+
+    // Histogram of each tile at (ty+1, tx+1)
+    for(int r=0; r<disparity.rows; r++){
+        const uchar* row = disparity.ptr<uchar>(r);
+        int* line = &this->histogram[size_t(r/tile + 1)*stride];
+        for(int c=0; c<disparity.cols; c++)   if(row[c]) line[(c/tile + 1)*256 + row[c]]++;
+    }
+
+    // Integral over tiles
+    for(int ty=1; ty<=tiles_y; ty++){
+        for(int tx=1; tx<=tiles_x; tx++){
+            int* h = &this->histogram[size_t(ty)*stride + tx*256];
+            const int* left = h - 256;
+            const int* up = h - stride;
+            const int* corner = up - 256;
+            for(int b=0; b<256; b++) h[b] += left[b] + up[b] - corner[b];
+        }
+    }
+
+}
+
+
+/*Funciton Name: Count(Rect box), Confidence(Rect box)                              */
+/*Description: non-zero pixels of a box and their ratio to its area, O(1) */
+/*Input: Rect box - box, clipped to the map                                                   */
+/*Output: int count, float confidence                                                                    */
+
+int BoxStatistics::Count(Rect box) const{
+
+    box &= Rect(0, 0, source.cols, source.rows);
+    if(box.area() == 0) return 0;
+    return count_integral.at<int>(box.y + box.height, box.x + box.width) - count_integral.at<int>(box.y, box.x + box.width)
+            - count_integral.at<int>(box.y + box.height, box.x) + count_integral.at<int>(box.y, box.x);
+
+}
+
+float BoxStatistics::Confidence(Rect box) const{
+
+    return box.area() > 0 ? float(Count(box))/box.area() : 0;
+
+}
+
+
+/*Funciton Name: Mean(Rect box), Median(Rect box), Max(Rect box)          */
+/*Description: statistics of the non-zero values of a box, 0 if none;
+                          Median is the value at index count/2 of the sorted values */
+/*Input: Rect box - box, clipped to the map                                                   */
+/*Output: int value                                                                                                         */
+
+int BoxStatistics::Mean(Rect box) const{
+
+    box &= Rect(0, 0, source.cols, source.rows);
+    int count = Count(box);
+    if(count == 0) return 0;
+    int sum = sum_integral.at<int>(box.y + box.height, box.x + box.width) - sum_integral.at<int>(box.y, box.x + box.width)
+            - sum_integral.at<int>(box.y + box.height, box.x) + sum_integral.at<int>(box.y, box.x);
+    return sum/count;
+
+}
+
+int BoxStatistics::Median(Rect box) const{
+
+    box &= Rect(0, 0, source.cols, source.rows);
+    int count = Count(box);
+    if(count == 0) return 0;
+
+    int hist[256];
+    Histogram(box, hist);
+    for(int b=1, cumulative=0; b<256; b++){
+        cumulative += hist[b];
+        if(cumulative > count/2) return b;
+    }
+    return 0;
+
+}
+
+int BoxStatistics::Max(Rect box) const{
+
+    box &= Rect(0, 0, source.cols, source.rows);
+    if(Count(box) == 0) return 0;
+
+    int hist[256];
+    Histogram(box, hist);
+    for(int b=255; b>0; b--)   if(hist[b]) return b;
+    return 0;
+
+}
+
+
+/*Funciton Name: Histogram(Rect box, int* hist)                                               */
+/*Description: histogram of the non-zero values in a box, full tiles from
+                          the integral histogram, border pixels scanned                */
+/*Input: Rect box - box inside the map
+                int* hist - 256 bins                                                                                 */
+/*Output: void                                                                                                                */
+
+void BoxStatistics::Histogram(Rect box, int* hist) const{
+
+    CV_Assert(has_histogram);
+    memset(hist, 0, 256*sizeof(int));
+
+    int x1 = box.x + box.width, y1 = box.y + box.height;
+
+    // Full tiles inside the box, the last tile may be cut by the map border
+    int tx0 = (box.x + tile - 1)/tile, tx1 = x1 == source.cols ? tiles_x : x1/tile;
+    int ty0 = (box.y + tile - 1)/tile, ty1 = y1 == source.rows ? tiles_y : y1/tile;
+    Rect inner;
+    if(tx0 < tx1 && ty0 < ty1){
+        int stride = (tiles_x + 1)*256;
+        const int* a = &histogram[size_t(ty1)*stride + tx1*256];
+        const int* b = &histogram[size_t(ty0)*stride + tx1*256];
+        const int* c = &histogram[size_t(ty1)*stride + tx0*256];
+        const int* d = &histogram[size_t(ty0)*stride + tx0*256];
+        for(int i=0; i<256; i++) hist[i] = a[i] - b[i] - c[i] + d[i];
+        inner = Rect(tx0*tile, ty0*tile, min(tx1*tile, source.cols) - tx0*tile, min(ty1*tile, source.rows) - ty0*tile);
+    }
+
+    // Border pixels outside the full tiles
+    for(int r=box.y; r<y1; r++){
+        const uchar* row = source.ptr<uchar>(r);
+        bool middle = inner.area() > 0 && r >= inner.y && r < inner.y + inner.height;
+        int skip_from = middle ? inner.x : x1, skip_to = middle ? inner.x + inner.width : x1;
+        for(int c=box.x; c<skip_from; c++) hist[row[c]]++;
+        for(int c=skip_to; c<x1; c++) hist[row[c]]++;
+    }
+    hist[0] = 0;
+
+}